@@ -5,7 +5,6 @@
 #define PING_REQ_PERIOD 0.5
 #define SUSPECT_TIMEOUT 20
 
-#define MAXIMUM_MEMBERS_IN_AN_UPDATE 4
 #define FAILURE_DETECTION_GROUP 3
 #define GOSSIP_FANOUT 4
 
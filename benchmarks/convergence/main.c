@@ -1,5 +1,6 @@
 #include "configuration.h"
 #include "encode.h"
+#include "loop.h"
 #include "member.h"
 #include "message.h"
 #include "microswim.h"
@@ -8,160 +9,137 @@
 #include "ping_req.h"
 #include "update.h"
 #include "utils.h"
-#include <fcntl.h>
 #include <hiredis/hiredis.h>
-#include <pthread.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 // Globals for tracking total number of messages and amount of data
 // until convergence.
 int messages = 0;
 size_t total_message_size = 0;
-pthread_mutex_t mutex;
 
-void* listener(void* params) {
-    microswim_t* ms = (microswim_t*)params;
-
-    for (;;) {
-        pthread_mutex_lock(&mutex);
-        microswim_ping_reqs_check(ms);
-        microswim_pings_check(ms);
-        microswim_members_check_suspects(ms);
-
-        unsigned char buffer[BUFFER_SIZE] = { 0 };
-        struct sockaddr_in from;
-        socklen_t len = sizeof(from);
-
-        ssize_t bytes = recvfrom(ms->socket, buffer, sizeof(buffer) - 1, 0, (struct sockaddr*)&from, &len);
+void log_statistics(microswim_t* ms) {
+    MICROSWIM_LOG_DEBUG("ms->ping_count: %zu", ms->ping_count);
+    MICROSWIM_LOG_DEBUG("ms->ping_req_count: %zu", ms->ping_req_count);
+    MICROSWIM_LOG_DEBUG("ms->update_count: %zu", ms->update_count);
+    MICROSWIM_LOG_DEBUG("ms->member_count: %zu", ms->member_count);
+    MICROSWIM_LOG_DEBUG("ms->confirmed_count: %zu", ms->confirmed_count);
+    printf("[DEBUG] ms->indices: [");
+    for (int i = 0; i < ms->member_count; i++) {
+        if (i < ms->member_count - 1) {
+            printf("%zu ", ms->indices[i]);
+        } else {
+            printf("%zu]\n", ms->indices[i]);
+        }
+    }
+}
 
-        if (bytes > 0) {
-            buffer[bytes] = '\0';
-            messages++;
-            total_message_size += bytes;
-            microswim_message_handle(ms, buffer, bytes, NULL);
+typedef struct {
+    redisContext* ctx;
+    size_t rounds;
+    bool inserted;
+    struct timeval before;
+    struct timeval elapsed; // NOTE: Until the members converged
+    int port;               // NOTE: Identifies which member the results belong to
+} convergence_t;
+
+// NOTE: Account for the protocol period before the tick starts it.
+void on_round(microswim_t* ms, void* context) {
+    convergence_t* convergence = context;
+
+    if (ms->member_count < MAXIMUM_MEMBERS) {
+        convergence->rounds++;
+    } else {
+        if (!convergence->inserted) {
+            struct timeval after;
+            gettimeofday(&after, NULL);
+            timersub(&after, &convergence->before, &convergence->elapsed);
+
+            char query[1024];
+            snprintf(
+                query, 1024, "%d,%d,%d,%d,%zu,%d,%lu,%ld.%06ld", convergence->port, GOSSIP_FANOUT,
+                MAXIMUM_MEMBERS, BUFFER_SIZE, convergence->rounds, messages,
+                total_message_size, (long int)convergence->elapsed.tv_sec,
+                (long int)convergence->elapsed.tv_usec);
+
+            redisReply* reply =
+                redisCommand(convergence->ctx, "SET result:%d %s", convergence->port, query);
+            if (reply == NULL) {
+                MICROSWIM_LOG_ERROR("SET command failed.");
+                redisFree(convergence->ctx);
+                exit(-2);
+            }
+            convergence->inserted = true;
         }
 
-        pthread_mutex_unlock(&mutex);
-        usleep(100 * 10);
+        MICROSWIM_LOG_INFO(
+            "Gossip rounds to reach %d members: %zu, and it took %ld.%06ld", MAXIMUM_MEMBERS,
+            convergence->rounds, (long int)convergence->elapsed.tv_sec,
+            (long int)convergence->elapsed.tv_usec);
     }
+
+    log_statistics(ms);
 }
 
-void* failure_detection(void* params) {
-    microswim_t* ms = (microswim_t*)params;
-    size_t rounds = 0;
-    bool inserted = false;
+// NOTE: Counts every datagram received, none of them is dropped.
+bool on_datagram(microswim_t* ms, const microswim_datagram_t* datagram, void* context) {
+    (void)ms;
+    (void)context;
+    messages++;
+    total_message_size += datagram->length;
+    return true;
+}
+
+void event_loop(microswim_t* ms) {
+    convergence_t convergence = { 0 };
 
     // Redis to store all the convergence related results.
-    redisReply* reply;
-    redisContext* ctx = redisConnect("127.0.0.1", 6379);
-    if (ctx->err) {
-        MICROSWIM_LOG_ERROR("Redis error: %s", ctx->errstr);
+    convergence.ctx = redisConnect("127.0.0.1", 6379);
+    if (convergence.ctx->err) {
+        MICROSWIM_LOG_ERROR("Redis error: %s", convergence.ctx->errstr);
         exit(-1);
     } else {
         MICROSWIM_LOG_INFO("Successfully connected to Redis!");
         MICROSWIM_LOG_INFO(
-            "MAXIMUM_MEMBERS: %d, GOSSIP_FANOUT: %d, MAXIMUM_MEMBERS_IN_AN_UPDATE: %d",
-            MAXIMUM_MEMBERS, GOSSIP_FANOUT, MAXIMUM_MEMBERS_IN_AN_UPDATE);
+            "MAXIMUM_MEMBERS: %d, GOSSIP_FANOUT: %d, BUFFER_SIZE: %d",
+            MAXIMUM_MEMBERS, GOSSIP_FANOUT, BUFFER_SIZE);
     }
 
-    // Timestamps.
-    struct timeval tval_before, tval_after, tval_result;
-    gettimeofday(&tval_before, NULL);
-
-    // Identifier to which member the results belong.
-    int port = ntohs(ms->self.addr.sin_port);
+    gettimeofday(&convergence.before, NULL);
+    convergence.port = ntohs(ms->self.addr.sin_port);
 
-    for (;;) {
-        if (ms->member_count < MAXIMUM_MEMBERS) {
-            rounds++;
-        } else {
-            if (!inserted) {
-                gettimeofday(&tval_after, NULL);
-                timersub(&tval_after, &tval_before, &tval_result);
-
-                char query[1024];
-                snprintf(
-                    query, 1024, "%d,%d,%d,%d,%zu,%d,%lu,%ld.%06ld", port, GOSSIP_FANOUT,
-                    MAXIMUM_MEMBERS, MAXIMUM_MEMBERS_IN_AN_UPDATE, rounds, messages,
-                    total_message_size, (long int)tval_result.tv_sec, (long int)tval_result.tv_usec);
-
-                redisReply* reply = redisCommand(ctx, "SET result:%d %s", port, query);
-                if (reply == NULL) {
-                    MICROSWIM_LOG_ERROR("SET command failed.");
-                    redisFree(ctx);
-                    exit(-2);
-                }
-                inserted = true;
-            }
-
-            MICROSWIM_LOG_INFO(
-                "Gossip rounds to reach %d members: %zu, and it took %ld.%06ld", MAXIMUM_MEMBERS,
-                rounds, (long int)tval_result.tv_sec, (long int)tval_result.tv_usec);
-        }
-
-        pthread_mutex_lock(&mutex);
-
-        for (int i = 0; i < GOSSIP_FANOUT; i++) {
-            microswim_member_t* member = microswim_member_retrieve(ms);
-            if (member != NULL) {
-                unsigned char buffer[BUFFER_SIZE] = { 0 };
-                microswim_message_t message = { 0 };
-                microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-                size_t update_count = microswim_updates_retrieve(ms, updates);
-                microswim_message_construct(ms, &message, PING_MESSAGE, updates, update_count);
-                size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-
-                microswim_message_send(ms, member, (const char*)buffer, length);
-                microswim_ping_add(ms, member);
-            }
-        }
-
-        MICROSWIM_LOG_DEBUG("ms->ping_count: %zu", ms->ping_count);
-        MICROSWIM_LOG_DEBUG("ms->ping_req_count: %zu", ms->ping_req_count);
-        MICROSWIM_LOG_DEBUG("ms->update_count: %zu", ms->update_count);
-        MICROSWIM_LOG_DEBUG("ms->member_count: %zu", ms->member_count);
-        MICROSWIM_LOG_DEBUG("ms->confirmed_count: %zu", ms->confirmed_count);
-        printf("[DEBUG] ms->indices: [");
-        for (int i = 0; i < ms->member_count; i++) {
-            if (i < ms->member_count - 1) {
-                printf("%zu ", ms->indices[i]);
-            } else {
-                printf("%zu]\n", ms->indices[i]);
-            }
-        }
-
-        pthread_mutex_unlock(&mutex);
-        usleep(PROTOCOL_PERIOD * 1000000);
+    microswim_loop_t loop;
+    microswim_loop_hooks_t hooks = { .round = on_round, .admit = on_datagram, .context = &convergence };
+    if (!microswim_loop_init(&loop, ms, &hooks)) {
+        exit(-1);
     }
+
+    microswim_loop_run(&loop);
+    microswim_loop_deinit(&loop);
 }
 
 int main(int argc, char** argv) {
     srand(time(NULL));
 
     microswim_t ms;
-    memset(&ms, 0, sizeof(ms));
-    microswim_socket_setup(&ms, argv[1], atoi(argv[2]));
-
-    int flags = fcntl(ms.socket, F_GETFL, 0);
-    if (fcntl(ms.socket, F_SETFL, flags | O_NONBLOCK) < 0) {
-        perror("Failed to set non-blocking");
-        close(ms.socket);
+    if (!microswim_init(&ms, NULL)) {
+        return 1;
     }
 
-    char uuid[UUID_SIZE];
-    microswim_uuid_generate(uuid);
-    strncpy((char*)ms.self.uuid, uuid, UUID_SIZE);
+    microswim_socket_setup(&ms, argv[1], atoi(argv[2]));
+
+    microswim_uuid_generate(&ms.self.uuid);
 
-    microswim_member_t* self = microswim_member_add(&ms, ms.self);
+    microswim_member_t* self = microswim_member_add(&ms, ms.self, microswim_milliseconds());
     if (self) {
         microswim_index_add(&ms);
         microswim_update_add(&ms, self);
     }
 
     microswim_member_t member;
-    member.uuid[0] = '\0';
+    memset(&member.uuid, 0, sizeof(member.uuid));
     member.addr.sin_family = AF_INET;
     member.addr.sin_port = htons(atoi(argv[4]));
     member.status = ALIVE;
@@ -172,21 +150,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    microswim_member_t* remote = microswim_member_add(&ms, member);
+    microswim_member_t* remote = microswim_member_add(&ms, member, microswim_milliseconds());
     if (remote) {
         microswim_index_add(&ms);
         microswim_update_add(&ms, remote);
     }
 
-    pthread_t fd_thread, pl_thread;
-    pthread_create(&fd_thread, NULL, failure_detection, (void*)&ms);
-    pthread_create(&pl_thread, NULL, listener, (void*)&ms);
-
-    pthread_join(fd_thread, NULL);
-    pthread_join(pl_thread, NULL);
+    event_loop(&ms);
 
     close(ms.socket);
-    pthread_mutex_destroy(&mutex);
+    microswim_deinit(&ms);
 
     return 0;
 }
@@ -10,14 +10,12 @@ size_t microswim_random() {
 
 uint64_t microswim_milliseconds() {
     struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)(ts.tv_sec) * 1000 + (ts.tv_nsec) / 1000000;
 }
 
-void microswim_uuid_generate(char* uuid) {
-    uuid_t uuid_binary;
-    uuid_generate_random(uuid_binary);
-    uuid_unparse(uuid_binary, uuid);
+void microswim_uuid_generate(microswim_id_t* uuid) {
+    uuid_generate_random(uuid->bytes);
 }
 
 void microswim_sockaddr_to_uri(struct sockaddr_in* addr, char* buffer, size_t buffer_size) {
@@ -0,0 +1,18 @@
+#ifndef MICROSWIM_CUSTOM_CONFIGURATION_H
+#define MICROSWIM_CUSTOM_CONFIGURATION_H
+
+#define PROTOCOL_PERIOD 5
+#define PING_REQ_PERIOD 2.5
+#define SUSPECT_TIMEOUT 20
+
+#define FAILURE_DETECTION_GROUP 3
+#define GOSSIP_FANOUT 1
+
+#define MAXIMUM_MEMBERS 10000
+#define MAXIMUM_UPDATES 10000
+#define MAXIMUM_PINGS 10000
+#define MAXIMUM_EVENTS 10
+
+#define BUFFER_SIZE 1024
+
+#endif
@@ -0,0 +1,415 @@
+#include "codec.h"
+#include "configuration.h"
+#include "io.h"
+#include "message.h"
+#include "microswim.h"
+#include "record.h"
+#include "utils.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// NOTE: Datagrams handled or sent per iteration, few enough for the socket buffers to hold.
+#define DATAGRAMS 128
+
+// NOTE: Updates piggybacked on the gossiping ACKs, few enough for any codec to fit them.
+#define GOSSIP_UPDATES 6
+
+/**
+ * Binds a UDP socket to an ephemeral loopback port with room for every datagram of an iteration.
+ */
+static int microswim_loopback_socket(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+
+    socklen_t len = sizeof(*addr);
+    getsockname(fd, (struct sockaddr*)addr, &len);
+
+    int size = 1 << 22;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return fd;
+}
+
+/**
+ * Builds an instance listening on a loopback port, which has been sent nothing yet.
+ */
+static microswim_t* microswim_loopback_instance(void) {
+    microswim_t* ms = (microswim_t*)calloc(1, sizeof(microswim_t));
+    microswim_init(ms, NULL);
+    microswim_socket_setup(ms, (char*)"127.0.0.1", 0);
+    microswim_io_reserve(ms);
+    microswim_uuid_generate(&ms->self.uuid);
+
+    socklen_t len = sizeof(ms->self.addr);
+    getsockname(ms->socket, (struct sockaddr*)&ms->self.addr, &len);
+
+    int size = 1 << 22;
+    setsockopt(ms->socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return ms;
+}
+
+static void microswim_loopback_release(microswim_t* ms) {
+    close(ms->socket);
+    microswim_deinit(ms);
+    free(ms);
+}
+
+/**
+ * Encodes an ACK from a peer at `from`.
+ */
+static size_t microswim_loopback_ack(
+    microswim_t* ms, const struct sockaddr_in* from, unsigned char* buffer, size_t size) {
+    microswim_message_t message = {};
+    message.type = ACK_MESSAGE;
+    microswim_member_t sender = {};
+    microswim_uuid_generate(&sender.uuid);
+    sender.addr = *from;
+    sender.status = ALIVE;
+    microswim_record_from_member(&message.sender, &sender);
+
+    return microswim_codec_select(ms, NULL)->encode(&message, buffer, size);
+}
+
+/**
+ * Encodes an ACK from a peer at `from` which piggybacks GOSSIP_UPDATES updates about other
+ * members, as the ACKs of a cluster which is still converging do.
+ */
+static size_t microswim_loopback_gossip(
+    microswim_t* ms, const struct sockaddr_in* from, unsigned char* buffer, size_t size) {
+    microswim_message_t message = {};
+    message.type = ACK_MESSAGE;
+    microswim_member_t member = {};
+    microswim_uuid_generate(&member.uuid);
+    member.addr = *from;
+    member.status = ALIVE;
+    microswim_record_from_member(&message.sender, &member);
+
+    for (size_t i = 0; i < GOSSIP_UPDATES; i++) {
+        microswim_uuid_generate(&member.uuid);
+        member.incarnation = i;
+        microswim_record_from_member(&message.mu[i], &member);
+    }
+    message.update_count = GOSSIP_UPDATES;
+
+    return microswim_codec_select(ms, NULL)->encode(&message, buffer, size);
+}
+
+/**
+ * Sends DATAGRAMS copies of an ACK from a peer at `from` to the instance, as a busy cluster would.
+ */
+static void microswim_loopback_flood(microswim_t* ms, int peer, const struct sockaddr_in* from) {
+    unsigned char buffer[BUFFER_SIZE];
+    size_t length = microswim_loopback_ack(ms, from, buffer, sizeof(buffer));
+
+    for (size_t i = 0; i < DATAGRAMS; i++) {
+        sendto(peer, buffer, length, 0, (struct sockaddr*)&ms->self.addr, sizeof(ms->self.addr));
+    }
+}
+
+static size_t microswim_loopback_drain(int fd) {
+    unsigned char buffer[BUFFER_SIZE];
+    size_t count = 0;
+    while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Receives and handles the datagrams one `recvfrom` at a time, as the hosts used to.
+ */
+static void BENCHMARK_microswim_io_recvfrom(benchmark::State& state) {
+    microswim_t* ms = microswim_loopback_instance();
+    struct sockaddr_in from;
+    int peer = microswim_loopback_socket(&from);
+    size_t system_calls = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        microswim_loopback_flood(ms, peer, &from);
+        state.ResumeTiming();
+
+        size_t handled = 0;
+        uint64_t now = microswim_milliseconds();
+        unsigned char buffer[BUFFER_SIZE];
+        for (;;) {
+            system_calls++;
+            ssize_t bytes = recvfrom(ms->socket, buffer, BUFFER_SIZE - 1, MSG_DONTWAIT, NULL, NULL);
+            if (bytes <= 0) {
+                break;
+            }
+
+            buffer[bytes] = '\0';
+            microswim_message_handle(ms, buffer, bytes, now, NULL);
+            handled++;
+        }
+
+        if (handled != DATAGRAMS) {
+            state.SkipWithError("Datagrams were lost on the loopback interface");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * DATAGRAMS);
+    state.counters["syscalls"] = benchmark::Counter(
+        (double)system_calls / DATAGRAMS, benchmark::Counter::kAvgIterations);
+
+    close(peer);
+    microswim_loopback_release(ms);
+}
+
+/**
+ * @brief Receives and handles the datagrams through `microswim_io_receive`, in batches of
+ * `recvmmsg` or, if `ring`, from an io_uring.
+ */
+static void microswim_io_batch_receive(benchmark::State& state, bool ring) {
+    microswim_t* ms = microswim_loopback_instance();
+    struct sockaddr_in from;
+    int peer = microswim_loopback_socket(&from);
+
+    if (ring && !microswim_io_uring_setup(ms)) {
+        state.SkipWithError("io_uring is unavailable");
+    }
+
+    size_t system_calls = microswim_io_system_calls(ms);
+    for (auto _ : state) {
+        state.PauseTiming();
+        microswim_loopback_flood(ms, peer, &from);
+        state.ResumeTiming();
+
+        if (microswim_io_receive(ms, microswim_milliseconds(), NULL, NULL, NULL) != DATAGRAMS) {
+            state.SkipWithError("Datagrams were lost on the loopback interface");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * DATAGRAMS);
+    state.counters["batch"] = IO_BATCH;
+    state.counters["syscalls"] = benchmark::Counter(
+        (double)(microswim_io_system_calls(ms) - system_calls) / DATAGRAMS,
+        benchmark::Counter::kAvgIterations);
+
+    close(peer);
+    microswim_loopback_release(ms);
+}
+
+static void BENCHMARK_microswim_io_receive(benchmark::State& state) {
+    microswim_io_batch_receive(state, false);
+}
+
+static void BENCHMARK_microswim_io_uring_receive(benchmark::State& state) {
+    microswim_io_batch_receive(state, true);
+}
+
+/**
+ * @brief Receives and handles DATAGRAMS gossiping ACKs from `peers` peers through
+ * `microswim_io_receive`, decoded on the instance's thread or, if `workers` is not 0, by as
+ * many receive workers.
+ *
+ * Only the time the instance's thread takes is measured, the workers decode the datagrams as
+ * they arrive while the timer is paused.
+ */
+static void microswim_io_gossip_receive(benchmark::State& state, size_t workers, size_t peers) {
+    microswim_t* ms = microswim_loopback_instance();
+    std::vector<int> sockets(peers);
+    std::vector<std::vector<unsigned char>> acks(peers, std::vector<unsigned char>(BUFFER_SIZE));
+    std::vector<size_t> lengths(peers);
+    for (size_t i = 0; i < peers; i++) {
+        struct sockaddr_in from;
+        sockets[i] = microswim_loopback_socket(&from);
+        lengths[i] = microswim_loopback_gossip(ms, &from, acks[i].data(), BUFFER_SIZE);
+    }
+
+    if (workers > 0 && !microswim_io_shard_setup(ms, workers)) {
+        state.SkipWithError("The receive workers are unavailable");
+    }
+
+    // NOTE: the workers' sockets get the instance's receive buffer size, so no datagram is lost.
+    struct pollfd fd = { .fd = microswim_io_descriptor(ms), .events = POLLIN };
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < DATAGRAMS; i++) {
+            size_t peer = i % peers;
+            sendto(sockets[peer], acks[peer].data(), lengths[peer], 0, (struct sockaddr*)&ms->self.addr,
+                   sizeof(ms->self.addr));
+        }
+        state.ResumeTiming();
+
+        size_t handled = 0;
+        while (handled < DATAGRAMS) {
+            if (poll(&fd, 1, 1000) <= 0) {
+                break;
+            }
+            handled += microswim_io_receive(ms, microswim_milliseconds(), NULL, NULL, NULL);
+        }
+
+        if (handled != DATAGRAMS) {
+            state.SkipWithError("Datagrams were lost on the loopback interface");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * DATAGRAMS);
+    state.counters["workers"] = (double)workers;
+    state.counters["dropped"] = (double)microswim_io_dropped(ms);
+
+    for (int socket : sockets) {
+        close(socket);
+    }
+    microswim_loopback_release(ms);
+}
+
+static void BENCHMARK_microswim_io_gossip_receive(benchmark::State& state) {
+    microswim_io_gossip_receive(state, 0, 8);
+}
+
+static void BENCHMARK_microswim_io_shard_receive(benchmark::State& state) {
+    microswim_io_gossip_receive(state, (size_t)state.range(0), 8);
+}
+
+/**
+ * @brief Sends DATAGRAMS messages to a peer, held back and flushed together if `corked`, on an
+ * io_uring if `ring`.
+ */
+static void microswim_io_send(benchmark::State& state, bool corked, bool ring) {
+    microswim_t* ms = microswim_loopback_instance();
+    microswim_member_t member = {};
+    microswim_uuid_generate(&member.uuid);
+    int peer = microswim_loopback_socket(&member.addr);
+    member.status = ALIVE;
+
+    microswim_message_t message = {};
+    microswim_message_construct(
+        ms, microswim_codec_select(ms, &member), &message, PING_MESSAGE, MESSAGE_BUDGET);
+
+    if (ring && !microswim_io_uring_setup(ms)) {
+        state.SkipWithError("io_uring is unavailable");
+    }
+
+    // NOTE: messages sent outside of a corked section take one `sendmsg` each.
+    size_t system_calls = microswim_io_system_calls(ms);
+    for (auto _ : state) {
+        if (corked) {
+            microswim_io_cork(ms);
+        }
+        for (size_t i = 0; i < DATAGRAMS; i++) {
+            microswim_message_send(ms, &member, &message);
+        }
+        if (corked) {
+            microswim_io_uncork(ms);
+        }
+
+        state.PauseTiming();
+        if (microswim_loopback_drain(peer) != DATAGRAMS) {
+            state.SkipWithError("Datagrams were lost on the loopback interface");
+            break;
+        }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * DATAGRAMS);
+    double calls = corked ? (double)(microswim_io_system_calls(ms) - system_calls) :
+                            (double)state.iterations() * DATAGRAMS;
+    state.counters["syscalls"] =
+        benchmark::Counter(calls / DATAGRAMS, benchmark::Counter::kAvgIterations);
+
+    close(peer);
+    microswim_loopback_release(ms);
+}
+
+static void BENCHMARK_microswim_io_sendmsg(benchmark::State& state) {
+    microswim_io_send(state, false, false);
+}
+
+static void BENCHMARK_microswim_io_sendmmsg(benchmark::State& state) {
+    microswim_io_send(state, true, false);
+    state.counters["batch"] = IO_BATCH;
+}
+
+static void BENCHMARK_microswim_io_uring_send(benchmark::State& state) {
+    microswim_io_send(state, true, true);
+    state.counters["batch"] = IO_BATCH;
+}
+
+/**
+ * @brief Times single ACKs from the moment the peer sends them until the instance has handled
+ * them, received with `recvfrom` or, if `ring`, from an io_uring, and reports percentiles.
+ */
+static void microswim_io_latency(benchmark::State& state, bool ring) {
+    microswim_t* ms = microswim_loopback_instance();
+    struct sockaddr_in from;
+    int peer = microswim_loopback_socket(&from);
+
+    if (ring && !microswim_io_uring_setup(ms)) {
+        state.SkipWithError("io_uring is unavailable");
+    }
+
+    unsigned char ack[BUFFER_SIZE];
+    size_t length = microswim_loopback_ack(ms, &from, ack, sizeof(ack));
+    std::vector<double> samples;
+
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        sendto(peer, ack, length, 0, (struct sockaddr*)&ms->self.addr, sizeof(ms->self.addr));
+
+        size_t handled = 0;
+        while (handled == 0) {
+            if (ring) {
+                handled = microswim_io_receive(ms, microswim_milliseconds(), NULL, NULL, NULL);
+                continue;
+            }
+
+            unsigned char buffer[BUFFER_SIZE];
+            ssize_t bytes = recvfrom(ms->socket, buffer, BUFFER_SIZE - 1, MSG_DONTWAIT, NULL, NULL);
+            if (bytes > 0) {
+                buffer[bytes] = '\0';
+                microswim_message_handle(ms, buffer, bytes, microswim_milliseconds(), NULL);
+                handled++;
+            }
+        }
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        samples.push_back(elapsed.count());
+    }
+
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        state.counters["p50_ns"] = samples[samples.size() / 2];
+        state.counters["p99_ns"] = samples[(samples.size() * 99) / 100];
+    }
+
+    close(peer);
+    microswim_loopback_release(ms);
+}
+
+static void BENCHMARK_microswim_io_recvfrom_latency(benchmark::State& state) {
+    microswim_io_latency(state, false);
+}
+
+static void BENCHMARK_microswim_io_uring_latency(benchmark::State& state) {
+    microswim_io_latency(state, true);
+}
+
+BENCHMARK(BENCHMARK_microswim_io_recvfrom);
+BENCHMARK(BENCHMARK_microswim_io_receive);
+BENCHMARK(BENCHMARK_microswim_io_uring_receive);
+BENCHMARK(BENCHMARK_microswim_io_gossip_receive);
+BENCHMARK(BENCHMARK_microswim_io_shard_receive)->Arg(1)->Arg(2)->Arg(4);
+BENCHMARK(BENCHMARK_microswim_io_sendmsg);
+BENCHMARK(BENCHMARK_microswim_io_sendmmsg);
+BENCHMARK(BENCHMARK_microswim_io_uring_send);
+BENCHMARK(BENCHMARK_microswim_io_recvfrom_latency);
+BENCHMARK(BENCHMARK_microswim_io_uring_latency);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,310 @@
+#include "codec.h"
+#include "configuration.h"
+#include "fragment.h"
+#include "member.h"
+#include "message.h"
+#include "microswim.h"
+#include "ping.h"
+#include "ping_req.h"
+#include "record.h"
+#include "update.h"
+#include "utils.h"
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * Builds an instance with `count` members, each of them referenced by an update,
+ * and returns copies of the members as they would arrive in decoded messages.
+ */
+static microswim_t* microswim_populate(size_t count, std::vector<microswim_member_t>& members) {
+    microswim_t* ms = (microswim_t*)calloc(1, sizeof(microswim_t));
+    microswim_init(ms, NULL);
+
+    uint64_t now = microswim_milliseconds();
+    for (size_t i = 0; i < count; i++) {
+        microswim_member_t member = {};
+        microswim_uuid_generate(&member.uuid);
+        member.addr.sin_family = AF_INET;
+        member.addr.sin_port = htons((uint16_t)(10000 + i));
+        member.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        member.status = ALIVE;
+
+        microswim_member_t* added = microswim_member_add(ms, member, now);
+        if (added != NULL) {
+            microswim_index_add(ms);
+            microswim_update_add(ms, added);
+            members.push_back(member);
+        }
+    }
+
+    return ms;
+}
+
+static void BENCHMARK_microswim_member_find(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(microswim_member_find(ms, &members[i]));
+        i = (i + 7919) % members.size();
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_member_confirmed_find(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    size_t i = 0;
+
+    // NOTE: none of the members are confirmed, so every lookup is a miss.
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(microswim_member_confirmed_find(ms, &members[i]));
+        i = (i + 7919) % members.size();
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_update_find(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    size_t i = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(microswim_update_find(ms, &members[i]));
+        i = (i + 7919) % members.size();
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_members_check(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    size_t i = 0;
+
+    std::vector<microswim_update_record_t> records(members.size());
+    for (size_t j = 0; j < members.size(); j++) {
+        microswim_record_from_member(&records[j], &members[j]);
+    }
+
+    // NOTE: the members are already known, which is the steady state of a piggybacked update.
+    uint64_t now = microswim_milliseconds();
+    for (auto _ : state) {
+        microswim_members_check(ms, &records[i], now);
+        i = (i + 7919) % members.size();
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_uuid_strncmp(benchmark::State& state) {
+    microswim_id_t uuid;
+    microswim_uuid_generate(&uuid);
+    char a[UUID_SIZE], b[UUID_SIZE];
+    microswim_id_format(&uuid, a);
+    microswim_id_format(&uuid, b);
+
+    // NOTE: equal UUIDs are the worst case, as every character has to be compared.
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(b);
+        benchmark::DoNotOptimize(strncmp(a, b, UUID_SIZE));
+    }
+
+    state.counters["bytes"] = UUID_SIZE;
+}
+
+static void BENCHMARK_microswim_id_equal(benchmark::State& state) {
+    microswim_id_t a, b;
+    microswim_uuid_generate(&a);
+    b = a;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(b);
+        benchmark::DoNotOptimize(microswim_id_equal(&a, &b));
+    }
+
+    state.counters["bytes"] = ID_SIZE;
+}
+
+static void BENCHMARK_microswim_member_add(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(0, members);
+    size_t count = state.range(0);
+    size_t i = 0;
+    uint64_t now = microswim_milliseconds();
+
+    // NOTE: the tables start with room for INITIAL_MEMBERS, so this includes their growth.
+    for (auto _ : state) {
+        microswim_member_t member = {};
+        microswim_uuid_generate(&member.uuid);
+        member.addr.sin_family = AF_INET;
+        member.addr.sin_port = htons((uint16_t)(10000 + i));
+        member.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        member.status = ALIVE;
+        benchmark::DoNotOptimize(microswim_member_add(ms, member, now));
+
+        if (++i == count) {
+            state.PauseTiming();
+            microswim_deinit(ms);
+            microswim_init(ms, NULL);
+            i = 0;
+            state.ResumeTiming();
+        }
+    }
+
+    state.counters["member_capacity"] = ms->member_capacity;
+    state.counters["hash_capacity"] = ms->hash_capacity;
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_pings_check(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+
+    // NOTE: every member is being pinged, but none of the deadlines are due.
+    uint64_t now = microswim_milliseconds();
+    for (size_t i = 0; i < ms->member_count && i < ms->config.maximum_pings; i++) {
+        microswim_ping_add(ms, &ms->members[i], now);
+    }
+
+    for (auto _ : state) {
+        microswim_pings_check(ms);
+        microswim_ping_reqs_check(ms);
+        microswim_members_check_suspects(ms);
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_message_pack(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_message_t* message = (microswim_message_t*)calloc(1, sizeof(microswim_message_t));
+    const microswim_codec_t* codec = microswim_codec_select(ms, NULL);
+    microswim_message_construct(ms, codec, message, PING_MESSAGE, MESSAGE_BUDGET);
+
+    for (auto _ : state) {
+        microswim_message_pack(ms, codec, message, MESSAGE_BUDGET);
+        benchmark::DoNotOptimize(message->update_count);
+
+        // NOTE: once most of the updates are retired, every member is queued again.
+        if (ms->update_count < MESSAGE_UPDATES) {
+            state.PauseTiming();
+            for (size_t i = 0; i < ms->member_count; i++) {
+                microswim_update_add(ms, &ms->members[i]);
+            }
+            state.ResumeTiming();
+        }
+    }
+
+    state.counters["updates"] = message->update_count;
+
+    free(message);
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_message_encode(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(64, members);
+    microswim_message_t* message = (microswim_message_t*)calloc(1, sizeof(microswim_message_t));
+    const microswim_codec_t* codec = microswim_codec_select(ms, NULL);
+    microswim_message_construct(ms, codec, message, PING_MESSAGE, MESSAGE_BUDGET);
+    unsigned char buffer[BUFFER_SIZE];
+    size_t length = 0;
+
+    for (auto _ : state) {
+        length = codec->encode(message, buffer, BUFFER_SIZE);
+        benchmark::DoNotOptimize(buffer);
+    }
+
+    state.counters["message_size"] = length;
+
+    free(message);
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_message_splice(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(64, members);
+    microswim_message_t* message = (microswim_message_t*)calloc(1, sizeof(microswim_message_t));
+    const microswim_codec_t* codec = microswim_codec_select(ms, NULL);
+    microswim_message_construct(ms, codec, message, PING_MESSAGE, MESSAGE_BUDGET);
+    microswim_splice_t splice;
+
+    // NOTE: the fragments were cached while packing, as they are before every send.
+    for (auto _ : state) {
+        microswim_fragment_splice(ms, codec, message, &splice);
+        benchmark::DoNotOptimize(splice.parts);
+    }
+
+    state.counters["message_size"] = splice.length;
+    state.counters["parts"] = splice.count;
+
+    free(message);
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_member_remove(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    size_t i = 0;
+    uint64_t now = microswim_milliseconds();
+
+    // NOTE: every removed member is added back, so that the number of members stays the same.
+    for (auto _ : state) {
+        microswim_member_t* member = microswim_member_find(ms, &members[i]);
+        microswim_member_remove(ms, member);
+
+        microswim_member_t* added = microswim_member_add(ms, members[i], now);
+        microswim_index_add(ms);
+        microswim_update_add(ms, added);
+        i = (i + 7919) % members.size();
+    }
+
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_sizes(benchmark::State& state) {
+    for (auto _ : state) {
+    }
+
+    state.counters["microswim_t"] = sizeof(microswim_t);
+    state.counters["microswim_member_t"] = sizeof(microswim_member_t);
+    state.counters["microswim_update_record_t"] = sizeof(microswim_update_record_t);
+    state.counters["microswim_message_t"] = sizeof(microswim_message_t);
+    state.counters["microswim_hash_entry_t"] = sizeof(microswim_hash_entry_t);
+}
+
+BENCHMARK(BENCHMARK_microswim_uuid_strncmp);
+BENCHMARK(BENCHMARK_microswim_id_equal);
+BENCHMARK(BENCHMARK_microswim_sizes);
+BENCHMARK(BENCHMARK_microswim_member_find)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_member_confirmed_find)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_update_find)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_message_pack)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_message_encode);
+BENCHMARK(BENCHMARK_microswim_message_splice);
+BENCHMARK(BENCHMARK_microswim_members_check)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_pings_check)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_member_remove)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+BENCHMARK(BENCHMARK_microswim_member_add)->Arg(8)->Arg(64)->Arg(512)->Arg(4096)->Arg(10000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,103 @@
+#ifndef MICROSWIM_MESSAGES_GOLDEN_H
+#define MICROSWIM_MESSAGES_GOLDEN_H
+
+#include "microswim.h"
+#include <stdio.h>
+#include <string.h>
+
+// NOTE: The golden encodings are of the message built by `microswim_golden_message`, captured
+// from the encoders the codecs have to stay compatible with. Only the incarnation of the last
+// update differs between them, the CBOR encoder of the time only carried 8 bits of it.
+
+typedef size_t (*microswim_golden_encode_t)(microswim_message_t*, unsigned char*, size_t);
+typedef bool (*microswim_golden_decode_t)(microswim_message_t*, const char*, ssize_t);
+
+static void microswim_golden_record(
+    microswim_update_record_t* record, const uint8_t uuid[ID_SIZE], const uint8_t address[4],
+    uint16_t port, uint8_t status, size_t incarnation) {
+    memcpy(record->uuid.bytes, uuid, ID_SIZE);
+    memcpy(record->address, address, 4);
+    record->port = port;
+    record->status = status;
+    record->incarnation = incarnation;
+}
+
+/**
+ * @brief Fills the message with a PING_REQ from a sender which has not named itself yet, with
+ * three updates whose incarnations take one and two bytes in either codec.
+ */
+static void microswim_golden_message(microswim_message_t* message, size_t incarnation) {
+    static const uint8_t nil[ID_SIZE] = { 0 };
+    static const uint8_t first[ID_SIZE] = { 0x2d, 0x6d, 0x02, 0x31, 0x6d, 0x91, 0x44, 0x6d,
+                                            0x86, 0xdd, 0x88, 0xdb, 0x79, 0xea, 0x5e, 0xdf };
+    static const uint8_t second[ID_SIZE] = { 0x06, 0x66, 0xcf, 0x8d, 0x4b, 0xfb, 0x48, 0xe4,
+                                             0x92, 0x22, 0xbe, 0xfc, 0x4a, 0xe7, 0xab, 0xe0 };
+    static const uint8_t third[ID_SIZE] = { 0xf4, 0x7a, 0xc1, 0x0b, 0x58, 0xcc, 0x43, 0x72,
+                                            0xa5, 0x67, 0x0e, 0x02, 0xb2, 0xc3, 0xd4, 0x79 };
+
+    static const uint8_t sender[4] = { 10, 0, 0, 1 };
+    static const uint8_t addresses[3][4] = {
+        { 10, 0, 0, 2 },
+        { 10, 0, 0, 3 },
+        { 192, 168, 100, 200 },
+    };
+
+    memset(message, 0, sizeof(*message));
+    message->type = PING_REQ_MESSAGE;
+    microswim_golden_record(&message->sender, nil, sender, 7946, ALIVE, 0);
+    microswim_golden_record(&message->mu[0], first, addresses[0], 7946, ALIVE, 1);
+    microswim_golden_record(&message->mu[1], second, addresses[1], 8000, SUSPECT, 24);
+    microswim_golden_record(&message->mu[2], third, addresses[2], 65535, CONFIRMED, incarnation);
+    message->update_count = 3;
+}
+
+static bool microswim_golden_record_equal(
+    const microswim_update_record_t* a, const microswim_update_record_t* b) {
+    return memcmp(a->uuid.bytes, b->uuid.bytes, ID_SIZE) == 0 &&
+           memcmp(a->address, b->address, 4) == 0 && a->port == b->port &&
+           a->status == b->status && a->incarnation == b->incarnation;
+}
+
+/**
+ * @brief Checks that the codec encodes the golden message into exactly the golden bytes, and
+ * decodes them back into the same message.
+ *
+ * @return true if it does, false after printing what differs.
+ */
+static bool microswim_golden_check(
+    const char* codec, microswim_golden_encode_t encode, microswim_golden_decode_t decode,
+    const uint8_t* golden, size_t length, size_t incarnation) {
+    static microswim_message_t expected, decoded;
+    unsigned char buffer[BUFFER_SIZE] = { 0 };
+    microswim_golden_message(&expected, incarnation);
+
+    size_t len = encode(&expected, buffer, sizeof(buffer));
+    if (len != length || memcmp(buffer, golden, length) != 0) {
+        size_t at = 0;
+        while (at < len && at < length && buffer[at] == golden[at]) {
+            at++;
+        }
+        fprintf(
+            stderr, "%s: encoded %zu bytes instead of the %zu golden ones, differing at byte %zu\n",
+            codec, len, length, at);
+        return false;
+    }
+
+    if (!decode(&decoded, (const char*)golden, (ssize_t)length) || decoded.type != expected.type ||
+        decoded.update_count != expected.update_count ||
+        !microswim_golden_record_equal(&decoded.sender, &expected.sender)) {
+        fprintf(stderr, "%s: the golden message does not decode into the one it encodes\n", codec);
+        return false;
+    }
+
+    for (size_t i = 0; i < expected.update_count; i++) {
+        if (!microswim_golden_record_equal(&decoded.mu[i], &expected.mu[i])) {
+            fprintf(stderr, "%s: update %zu of the golden message decodes differently\n", codec, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif // MICROSWIM_MESSAGES_GOLDEN_H
@@ -0,0 +1,143 @@
+#include "decode.h"
+#include "encode.h"
+#include "golden.h"
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+static const uint8_t BINARY_UUID[] = { 0x2d, 0x6d, 0x02, 0x31, 0x6d, 0x91, 0x44, 0x6d,
+                                       0x86, 0xdd, 0x88, 0xdb, 0x79, 0xea, 0x5e, 0xdf };
+
+static const uint8_t BINARY_UPDATE_UUID[] = { 0x06, 0x66, 0xcf, 0x8d, 0x4b, 0xfb, 0x48, 0xe4,
+                                              0x92, 0x22, 0xbe, 0xfc, 0x4a, 0xe7, 0xab, 0xe0 };
+
+// NOTE: `microswim_golden_message` in the layout of BINARY_VERSION 2, as encoded when it was
+// introduced: the header, then the sender and every update as status, ID, address, port and
+// the incarnation as a LEB128 varint.
+static const uint8_t BINARY_GOLDEN[] = {
+    0x02, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x01,
+    0x1f, 0x0a, 0x00, 0x00, 0x2d, 0x6d, 0x02, 0x31, 0x6d, 0x91, 0x44, 0x6d,
+    0x86, 0xdd, 0x88, 0xdb, 0x79, 0xea, 0x5e, 0xdf, 0x0a, 0x00, 0x00, 0x02,
+    0x1f, 0x0a, 0x01, 0x01, 0x06, 0x66, 0xcf, 0x8d, 0x4b, 0xfb, 0x48, 0xe4,
+    0x92, 0x22, 0xbe, 0xfc, 0x4a, 0xe7, 0xab, 0xe0, 0x0a, 0x00, 0x00, 0x03,
+    0x1f, 0x40, 0x18, 0x02, 0xf4, 0x7a, 0xc1, 0x0b, 0x58, 0xcc, 0x43, 0x72,
+    0xa5, 0x67, 0x0e, 0x02, 0xb2, 0xc3, 0xd4, 0x79, 0xc0, 0xa8, 0x64, 0xc8,
+    0xff, 0xff, 0xac, 0x02,
+};
+
+/**
+ * @brief Fills the message with the same contents as the CBOR and JSON benchmarks use.
+ */
+static void microswim_binary_message(microswim_message_t* message, int update_count) {
+    memset(message, 0, sizeof(*message));
+    message->type = ACK_MESSAGE;
+    const uint8_t localhost[] = { 127, 0, 0, 1 };
+    memcpy(message->sender.uuid.bytes, BINARY_UUID, sizeof(BINARY_UUID));
+    memcpy(message->sender.address, localhost, sizeof(localhost));
+    message->sender.port = 8000;
+
+    message->update_count = update_count;
+    for (int i = 0; i < update_count; i++) {
+        microswim_update_record_t* record = &message->mu[i];
+        memcpy(record->uuid.bytes, BINARY_UPDATE_UUID, sizeof(BINARY_UPDATE_UUID));
+        memcpy(record->address, localhost, sizeof(localhost));
+        record->port = 9000;
+    }
+}
+
+static void BENCHMARK_microswim_binary_decoding(benchmark::State& state) {
+    microswim_message_t message;
+    microswim_binary_message(&message, state.range(0));
+    uint8_t buffer[BUFFER_SIZE] = { 0 };
+    size_t len = microswim_encode_binary_message(&message, buffer, BUFFER_SIZE);
+
+    for (auto _ : state) {
+        microswim_decode_binary_message(&message, (const char*)buffer, len);
+        state.counters["message_size"] = len;
+    }
+}
+
+/**
+ * @brief Indexes the message and decodes its members one at a time, as the receive path does.
+ */
+static void BENCHMARK_microswim_binary_view(benchmark::State& state) {
+    microswim_message_t message;
+    microswim_binary_message(&message, state.range(0));
+    uint8_t buffer[BUFFER_SIZE] = { 0 };
+    size_t len = microswim_encode_binary_message(&message, buffer, BUFFER_SIZE);
+
+    for (auto _ : state) {
+        microswim_message_view_t view;
+        microswim_update_record_t member;
+        if (microswim_decode_binary_view(&view, buffer, len)) {
+            size_t position = view.sender;
+            microswim_decode_binary_member(&view, &position, &member);
+            position = view.updates;
+            for (size_t i = 0; i < view.update_count; i++) {
+                microswim_decode_binary_member(&view, &position, &member);
+                benchmark::DoNotOptimize(member);
+            }
+        }
+    }
+    state.counters["message_size"] = len;
+}
+
+static void BENCHMARK_microswim_binary_encoding(benchmark::State& state) {
+    microswim_message_t message;
+    microswim_binary_message(&message, state.range(0));
+
+    for (auto _ : state) {
+        unsigned char buffer[BUFFER_SIZE] = { 0 };
+        size_t len = microswim_encode_binary_message(&message, buffer, BUFFER_SIZE);
+        state.counters["message_size"] = len;
+    }
+}
+
+BENCHMARK(BENCHMARK_microswim_binary_decoding)
+    ->Args({ 1 })
+    ->Args({ 2 })
+    ->Args({ 3 })
+    ->Args({ 4 })
+    ->Args({ 5 })
+    ->Args({ 6 })
+    ->Args({ 7 })
+    ->Args({ 8 })
+    ->Args({ 9 });
+
+BENCHMARK(BENCHMARK_microswim_binary_view)
+    ->Args({ 1 })
+    ->Args({ 2 })
+    ->Args({ 3 })
+    ->Args({ 4 })
+    ->Args({ 5 })
+    ->Args({ 6 })
+    ->Args({ 7 })
+    ->Args({ 8 })
+    ->Args({ 9 });
+
+BENCHMARK(BENCHMARK_microswim_binary_encoding)
+    ->Args({ 1 })
+    ->Args({ 2 })
+    ->Args({ 3 })
+    ->Args({ 4 })
+    ->Args({ 5 })
+    ->Args({ 6 })
+    ->Args({ 7 })
+    ->Args({ 8 })
+    ->Args({ 9 });
+
+int main(int argc, char** argv) {
+    if (!microswim_golden_check(
+            "binary", microswim_encode_binary_message, microswim_decode_binary_message,
+            BINARY_GOLDEN, sizeof(BINARY_GOLDEN), 300)) {
+        return 1;
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -1,8 +1,35 @@
 #include "decode.h"
 #include "encode.h"
+#include "golden.h"
+#include <atomic>
 #include <benchmark/benchmark.h>
 #include <string.h>
 
+// NOTE: the allocator entry points are wrapped so that the benchmarks can report how many
+// heap allocations a single encoding or decoding makes.
+static std::atomic<size_t> allocations{ 0 };
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+
+void* malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+
 static uint8_t CBOR_STRING[] = {
     0xa4, 0x67, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x02, 0x64, 0x75, 0x75, 0x69, 0x64, 0x78,
     0x24, 0x32, 0x44, 0x36, 0x44, 0x30, 0x32, 0x33, 0x31, 0x2d, 0x36, 0x44, 0x39, 0x31, 0x2d, 0x34,
@@ -20,6 +47,38 @@ static uint8_t CBOR_SINGLE_UPDATE[] = {
     0x00, 0x6b, 0x69, 0x6e, 0x63, 0x61, 0x72, 0x6e, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x00
 };
 
+// NOTE: `microswim_golden_message` as encoded by libcbor 0.8, before the CBOR encoder wrote the
+// items itself: a map of 6 pairs with a null UUID and an array of 3 maps of 4 pairs.
+static const uint8_t CBOR_GOLDEN[] = {
+    0xa6, 0x67, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x01, 0x64, 0x75,
+    0x75, 0x69, 0x64, 0xf6, 0x63, 0x75, 0x72, 0x69, 0x6d, 0x31, 0x30, 0x2e,
+    0x30, 0x2e, 0x30, 0x2e, 0x31, 0x3a, 0x37, 0x39, 0x34, 0x36, 0x66, 0x73,
+    0x74, 0x61, 0x74, 0x75, 0x73, 0x00, 0x6b, 0x69, 0x6e, 0x63, 0x61, 0x72,
+    0x6e, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x00, 0x67, 0x75, 0x70, 0x64, 0x61,
+    0x74, 0x65, 0x73, 0x83, 0xa4, 0x64, 0x75, 0x75, 0x69, 0x64, 0x78, 0x24,
+    0x32, 0x64, 0x36, 0x64, 0x30, 0x32, 0x33, 0x31, 0x2d, 0x36, 0x64, 0x39,
+    0x31, 0x2d, 0x34, 0x34, 0x36, 0x64, 0x2d, 0x38, 0x36, 0x64, 0x64, 0x2d,
+    0x38, 0x38, 0x64, 0x62, 0x37, 0x39, 0x65, 0x61, 0x35, 0x65, 0x64, 0x66,
+    0x63, 0x75, 0x72, 0x69, 0x6d, 0x31, 0x30, 0x2e, 0x30, 0x2e, 0x30, 0x2e,
+    0x32, 0x3a, 0x37, 0x39, 0x34, 0x36, 0x66, 0x73, 0x74, 0x61, 0x74, 0x75,
+    0x73, 0x00, 0x6b, 0x69, 0x6e, 0x63, 0x61, 0x72, 0x6e, 0x61, 0x74, 0x69,
+    0x6f, 0x6e, 0x01, 0xa4, 0x64, 0x75, 0x75, 0x69, 0x64, 0x78, 0x24, 0x30,
+    0x36, 0x36, 0x36, 0x63, 0x66, 0x38, 0x64, 0x2d, 0x34, 0x62, 0x66, 0x62,
+    0x2d, 0x34, 0x38, 0x65, 0x34, 0x2d, 0x39, 0x32, 0x32, 0x32, 0x2d, 0x62,
+    0x65, 0x66, 0x63, 0x34, 0x61, 0x65, 0x37, 0x61, 0x62, 0x65, 0x30, 0x63,
+    0x75, 0x72, 0x69, 0x6d, 0x31, 0x30, 0x2e, 0x30, 0x2e, 0x30, 0x2e, 0x33,
+    0x3a, 0x38, 0x30, 0x30, 0x30, 0x66, 0x73, 0x74, 0x61, 0x74, 0x75, 0x73,
+    0x01, 0x6b, 0x69, 0x6e, 0x63, 0x61, 0x72, 0x6e, 0x61, 0x74, 0x69, 0x6f,
+    0x6e, 0x18, 0x18, 0xa4, 0x64, 0x75, 0x75, 0x69, 0x64, 0x78, 0x24, 0x66,
+    0x34, 0x37, 0x61, 0x63, 0x31, 0x30, 0x62, 0x2d, 0x35, 0x38, 0x63, 0x63,
+    0x2d, 0x34, 0x33, 0x37, 0x32, 0x2d, 0x61, 0x35, 0x36, 0x37, 0x2d, 0x30,
+    0x65, 0x30, 0x32, 0x62, 0x32, 0x63, 0x33, 0x64, 0x34, 0x37, 0x39, 0x63,
+    0x75, 0x72, 0x69, 0x75, 0x31, 0x39, 0x32, 0x2e, 0x31, 0x36, 0x38, 0x2e,
+    0x31, 0x30, 0x30, 0x2e, 0x32, 0x30, 0x30, 0x3a, 0x36, 0x35, 0x35, 0x33,
+    0x35, 0x66, 0x73, 0x74, 0x61, 0x74, 0x75, 0x73, 0x02, 0x6b, 0x69, 0x6e,
+    0x63, 0x61, 0x72, 0x6e, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x18, 0xff,
+};
+
 static void BENCHMARK_microswim_cbor_decoding(benchmark::State& state) {
     microswim_message_t message;
     uint8_t buffer[BUFFER_SIZE] = { 0 };
@@ -32,10 +91,49 @@ static void BENCHMARK_microswim_cbor_decoding(benchmark::State& state) {
         offset += sizeof(CBOR_SINGLE_UPDATE);
     }
 
+    size_t made = 0;
     for (auto _ : state) {
-        microswim_decode_message(&message, (const char*)buffer, sizeof(buffer));
+        size_t before = allocations.load(std::memory_order_relaxed);
+        microswim_decode_cbor_message(&message, (const char*)buffer, sizeof(buffer));
+        made += allocations.load(std::memory_order_relaxed) - before;
         state.counters["message_size"] = offset;
     }
+
+    state.counters["allocations"] = benchmark::Counter(made, benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * @brief Indexes the message and decodes its members one at a time, as the receive path does.
+ */
+static void BENCHMARK_microswim_cbor_view(benchmark::State& state) {
+    uint8_t buffer[BUFFER_SIZE] = { 0 };
+    int offset = 0;
+    memcpy(buffer, CBOR_STRING, sizeof(CBOR_STRING));
+    offset += sizeof(CBOR_STRING);
+    buffer[offset++] = (unsigned char)state.range(1);
+    for (int i = 0; i < state.range(0); i++) {
+        memcpy(buffer + offset, CBOR_SINGLE_UPDATE, sizeof(CBOR_SINGLE_UPDATE));
+        offset += sizeof(CBOR_SINGLE_UPDATE);
+    }
+
+    size_t made = 0;
+    for (auto _ : state) {
+        microswim_message_view_t view;
+        microswim_update_record_t member;
+        size_t before = allocations.load(std::memory_order_relaxed);
+        if (microswim_decode_cbor_view(&view, buffer, sizeof(buffer))) {
+            size_t position = view.sender;
+            microswim_decode_cbor_member(&view, &position, &member);
+            position = view.updates;
+            for (size_t i = 0; i < view.update_count; i++) {
+                microswim_decode_cbor_member(&view, &position, &member);
+                benchmark::DoNotOptimize(member);
+            }
+        }
+        made += allocations.load(std::memory_order_relaxed) - before;
+    }
+    state.counters["message_size"] = offset;
+    state.counters["allocations"] = benchmark::Counter(made, benchmark::Counter::kAvgIterations);
 }
 
 static void BENCHMARK_microswim_cbor_encoding(benchmark::State& state) {
@@ -49,13 +147,18 @@ static void BENCHMARK_microswim_cbor_encoding(benchmark::State& state) {
         memcpy(buffer + offset, CBOR_SINGLE_UPDATE, sizeof(CBOR_SINGLE_UPDATE));
         offset += sizeof(CBOR_SINGLE_UPDATE);
     }
-    microswim_decode_message(&message, (const char*)buffer, sizeof(buffer));
+    microswim_decode_cbor_message(&message, (const char*)buffer, sizeof(buffer));
 
+    size_t made = 0;
     for (auto _ : state) {
         unsigned char buffer[BUFFER_SIZE] = { 0 };
-        size_t len = microswim_encode_message(&message, buffer, BUFFER_SIZE);
+        size_t before = allocations.load(std::memory_order_relaxed);
+        size_t len = microswim_encode_cbor_message(&message, buffer, BUFFER_SIZE);
+        made += allocations.load(std::memory_order_relaxed) - before;
         state.counters["message_size"] = len;
     }
+
+    state.counters["allocations"] = benchmark::Counter(made, benchmark::Counter::kAvgIterations);
 }
 
 BENCHMARK(BENCHMARK_microswim_cbor_decoding)
@@ -69,6 +172,17 @@ BENCHMARK(BENCHMARK_microswim_cbor_decoding)
     ->Args({ 8, 0x88 })
     ->Args({ 9, 0x89 });
 
+BENCHMARK(BENCHMARK_microswim_cbor_view)
+    ->Args({ 1, 0x81 })
+    ->Args({ 2, 0x82 })
+    ->Args({ 3, 0x83 })
+    ->Args({ 4, 0x84 })
+    ->Args({ 5, 0x85 })
+    ->Args({ 6, 0x86 })
+    ->Args({ 7, 0x87 })
+    ->Args({ 8, 0x88 })
+    ->Args({ 9, 0x89 });
+
 BENCHMARK(BENCHMARK_microswim_cbor_encoding)
     ->Args({ 1, 0x81 })
     ->Args({ 2, 0x82 })
@@ -80,4 +194,18 @@ BENCHMARK(BENCHMARK_microswim_cbor_encoding)
     ->Args({ 8, 0x88 })
     ->Args({ 9, 0x89 });
 
-BENCHMARK_MAIN();
+int main(int argc, char** argv) {
+    if (!microswim_golden_check(
+            "cbor", microswim_encode_cbor_message, microswim_decode_cbor_message, CBOR_GOLDEN,
+            sizeof(CBOR_GOLDEN), 255)) {
+        return 1;
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
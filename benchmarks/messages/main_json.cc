@@ -30,7 +30,38 @@ static void BENCHMARK_microswim_json_decoding(benchmark::State& state) {
     strncat(buffer, "]}", 2);
 
     for (auto _ : state) {
-        microswim_decode_message(&message, buffer, strlen(buffer));
+        microswim_decode_json_message(&message, buffer, strlen(buffer));
+    }
+}
+
+/**
+ * @brief Indexes the message and decodes its members one at a time, as the receive path does.
+ */
+static void BENCHMARK_microswim_json_view(benchmark::State& state) {
+    char buffer[BENCHMARK_BUFFER_SIZE] = { 0 };
+    strncpy(buffer, JSON_STRING, strlen(JSON_STRING));
+    for (int i = 0; i < state.range(0); i++) {
+        strncat(buffer, JSON_SINGLE_UPDATE, strlen(JSON_SINGLE_UPDATE));
+        if (i < state.range(0) - 1) {
+            strncat(buffer, ",", 1);
+        }
+    }
+
+    strncat(buffer, "]}", 2);
+    size_t len = strlen(buffer);
+
+    for (auto _ : state) {
+        microswim_message_view_t view;
+        microswim_update_record_t member;
+        if (microswim_decode_json_view(&view, (const unsigned char*)buffer, len)) {
+            size_t position = view.sender;
+            microswim_decode_json_member(&view, &position, &member);
+            position = view.updates;
+            for (size_t i = 0; i < view.update_count; i++) {
+                microswim_decode_json_member(&view, &position, &member);
+                benchmark::DoNotOptimize(member);
+            }
+        }
     }
 }
 
@@ -48,10 +79,11 @@ static void BENCHMARK_microswim_json_encoding(benchmark::State& state) {
     }
 
     strncat(buffer, "]}", 2);
-    microswim_decode_message(&message, buffer, strlen(buffer));
+    microswim_decode_json_message(&message, buffer, strlen(buffer));
 
     for (auto _ : state) {
-        size_t len = microswim_encode_message(&message, (unsigned char*)buffer, BENCHMARK_BUFFER_SIZE);
+        size_t len =
+            microswim_encode_json_message(&message, (unsigned char*)buffer, BENCHMARK_BUFFER_SIZE);
         state.counters["message_size"] = len;
     }
 }
@@ -78,4 +110,15 @@ BENCHMARK(BENCHMARK_microswim_json_decoding)
     ->Args({ 8 })
     ->Args({ 9 });
 
+BENCHMARK(BENCHMARK_microswim_json_view)
+    ->Args({ 1 })
+    ->Args({ 2 })
+    ->Args({ 3 })
+    ->Args({ 4 })
+    ->Args({ 5 })
+    ->Args({ 6 })
+    ->Args({ 7 })
+    ->Args({ 8 })
+    ->Args({ 9 });
+
 BENCHMARK_MAIN();
@@ -0,0 +1,19 @@
+#ifndef MICROSWIM_CUSTOM_CONFIGURATION_H
+#define MICROSWIM_CUSTOM_CONFIGURATION_H
+
+// NOTE: Long enough for no ping, ping-req or suspicion to come due while a benchmark runs.
+#define PROTOCOL_PERIOD 3600
+#define PING_REQ_PERIOD 1800
+#define SUSPECT_TIMEOUT 3600
+
+#define FAILURE_DETECTION_GROUP 3
+#define GOSSIP_FANOUT 1
+
+#define MAXIMUM_MEMBERS 16384
+#define MAXIMUM_UPDATES 16384
+#define MAXIMUM_PINGS 16384
+#define MAXIMUM_EVENTS 10
+
+#define BUFFER_SIZE 1024
+
+#endif
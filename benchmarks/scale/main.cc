@@ -0,0 +1,382 @@
+#include "codec.h"
+#include "configuration.h"
+#include "member.h"
+#include "message.h"
+#include "microswim.h"
+#include "ping.h"
+#include "record.h"
+#include "update.h"
+#include "utils.h"
+#include <benchmark/benchmark.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NOTE: Distinct datagrams `microswim_message_handle` cycles through, so that the senders and
+// the updates it looks up are not always the same.
+#define DATAGRAMS 64
+// NOTE: Updates piggybacked on every one of those datagrams.
+#define DATAGRAM_UPDATES 6
+
+#define PERF_COUNTERS 2
+
+/**
+ * Hardware counters of the benchmark's thread, read around its timed loop.
+ *
+ * Only user space is counted, which is all an unprivileged process may count with the default
+ * `perf_event_paranoid`. Counters which cannot be opened, in containers and most VMs, are left
+ * out of the results.
+ */
+typedef struct {
+    int fds[PERF_COUNTERS]; // NOTE: -1 where the counter could not be opened
+} microswim_perf_t;
+
+static const char* microswim_perf_names[PERF_COUNTERS] = { "cycles", "cache_misses" };
+
+static void microswim_perf_start(microswim_perf_t* perf) {
+#ifdef __linux__
+    static const uint64_t events[PERF_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES,
+                                                    PERF_COUNT_HW_CACHE_MISSES };
+    static bool reported = false;
+
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        struct perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        perf->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf->fds[i] < 0 && !reported) {
+            fprintf(stderr, "perf_event_open(%s): %s, the counter is left out\n",
+                    microswim_perf_names[i], strerror(errno));
+            reported = true;
+        }
+    }
+
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        perf->fds[i] = -1;
+    }
+#endif
+}
+
+/**
+ * Stops the counters and reports them per iteration.
+ */
+static void microswim_perf_stop(microswim_perf_t* perf, benchmark::State& state) {
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (perf->fds[i] < 0) {
+            continue;
+        }
+
+        uint64_t value = 0;
+        if (read(perf->fds[i], &value, sizeof(value)) == sizeof(value)) {
+            state.counters[microswim_perf_names[i]] =
+                benchmark::Counter((double)value, benchmark::Counter::kAvgIterations);
+        }
+        close(perf->fds[i]);
+    }
+#else
+    (void)perf;
+    (void)state;
+#endif
+}
+
+static size_t microswim_scale_sent = 0;
+
+static void microswim_scale_transport(
+    void* ms, const struct sockaddr_in* addr, const unsigned char* buffer, size_t length,
+    void* context) {
+    (void)ms;
+    (void)addr;
+    (void)buffer;
+    (void)context;
+    microswim_scale_sent += length;
+}
+
+static struct sockaddr_in microswim_scale_address(size_t i) {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(7946);
+    addr.sin_addr.s_addr = htonl(0x0a000000 + (uint32_t)i + 1);
+    return addr;
+}
+
+/**
+ * Builds an instance which knows `count` members, itself included, each of them referenced by
+ * an update, and returns copies of the other members as they would arrive in decoded messages.
+ *
+ * Messages are handed to a transport which only counts their bytes, so nothing touches a socket.
+ */
+static microswim_t* microswim_populate(size_t count, std::vector<microswim_member_t>& members) {
+    microswim_t* ms = (microswim_t*)calloc(1, sizeof(microswim_t));
+    microswim_init(ms, NULL);
+
+    struct sockaddr_in addr = microswim_scale_address(0);
+    microswim_transport_setup(ms, microswim_scale_transport, NULL, &addr);
+    microswim_uuid_generate(&ms->self.uuid);
+    ms->self.status = ALIVE;
+
+    microswim_member_t* self = microswim_member_add(ms, ms->self, microswim_milliseconds());
+    if (self != NULL) {
+        microswim_index_add(ms);
+        microswim_update_add(ms, self);
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        microswim_member_t member = {};
+        microswim_uuid_generate(&member.uuid);
+        member.addr = microswim_scale_address(i);
+        member.status = ALIVE;
+
+        microswim_member_t* added = microswim_member_add(ms, member, microswim_milliseconds());
+        if (added != NULL) {
+            microswim_index_add(ms);
+            microswim_update_add(ms, added);
+            members.push_back(member);
+        }
+    }
+
+    return ms;
+}
+
+static void microswim_release(microswim_t* ms) {
+    microswim_deinit(ms);
+    free(ms);
+}
+
+static void BENCHMARK_microswim_member_find(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+    size_t i = 0;
+
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(microswim_member_find(ms, &members[i]));
+        i = (i + 7919) % members.size();
+    }
+    microswim_perf_stop(&perf, state);
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_members_check(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+    size_t i = 0;
+
+    std::vector<microswim_update_record_t> records(members.size());
+    for (size_t j = 0; j < members.size(); j++) {
+        microswim_record_from_member(&records[j], &members[j]);
+    }
+
+    // NOTE: the members are known already and the updates bring nothing new, which is the
+    // steady state of a piggybacked update.
+    uint64_t now = microswim_milliseconds();
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        microswim_members_check(ms, &records[i], now);
+        i = (i + 7919) % members.size();
+    }
+    microswim_perf_stop(&perf, state);
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_members_check_refuted(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+    size_t i = 0;
+
+    std::vector<microswim_update_record_t> records(members.size());
+    for (size_t j = 0; j < members.size(); j++) {
+        microswim_record_from_member(&records[j], &members[j]);
+    }
+
+    // NOTE: every update brings a higher incarnation, so the member is updated and its update
+    // queued again, as when members refute their suspicion.
+    uint64_t now = microswim_milliseconds();
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        records[i].incarnation++;
+        microswim_members_check(ms, &records[i], now);
+        i = (i + 7919) % members.size();
+    }
+    microswim_perf_stop(&perf, state);
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_message_pack(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_message_t* message = (microswim_message_t*)calloc(1, sizeof(microswim_message_t));
+    const microswim_codec_t* codec = microswim_codec_select(ms, NULL);
+    microswim_message_construct(ms, codec, message, PING_MESSAGE, MESSAGE_BUDGET);
+    microswim_perf_t perf;
+
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        microswim_message_pack(ms, codec, message, MESSAGE_BUDGET);
+        benchmark::DoNotOptimize(message->update_count);
+
+        // NOTE: once most of the updates are retired, every member is queued again.
+        if (ms->update_count < MESSAGE_UPDATES) {
+            state.PauseTiming();
+            for (size_t i = 0; i < ms->member_count; i++) {
+                microswim_update_add(ms, &ms->members[i]);
+            }
+            state.ResumeTiming();
+        }
+    }
+    microswim_perf_stop(&perf, state);
+
+    state.counters["updates"] = message->update_count;
+
+    free(message);
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_pings_check(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+
+    // NOTE: every member is being pinged, but none of the deadlines are due.
+    uint64_t now = microswim_milliseconds();
+    for (size_t i = 0; i < members.size(); i++) {
+        microswim_ping_add(ms, microswim_member_find(ms, &members[i]), now);
+    }
+
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        microswim_pings_check(ms);
+    }
+    microswim_perf_stop(&perf, state);
+
+    state.counters["timers"] = ms->timer_count;
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_members_check_suspects(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+
+    // NOTE: every member is suspected, but none of the suspicions have timed out.
+    uint64_t now = microswim_milliseconds();
+    for (size_t i = 0; i < members.size(); i++) {
+        microswim_member_mark_suspect(ms, microswim_member_find(ms, &members[i]), now);
+    }
+
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        microswim_members_check_suspects(ms);
+    }
+    microswim_perf_stop(&perf, state);
+
+    state.counters["timers"] = ms->timer_count;
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_member_retrieve(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    microswim_perf_t perf;
+
+    // NOTE: the round-robin sequence is shuffled whenever it wraps around, which is included.
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(microswim_member_retrieve(ms));
+    }
+    microswim_perf_stop(&perf, state);
+
+    microswim_release(ms);
+}
+
+static void BENCHMARK_microswim_message_handle(benchmark::State& state) {
+    std::vector<microswim_member_t> members;
+    microswim_t* ms = microswim_populate(state.range(0), members);
+    const microswim_codec_t* codec = microswim_codec_select(ms, NULL);
+    microswim_perf_t perf;
+
+    // NOTE: PINGs from known members, piggybacking updates about other known members which
+    // bring nothing new. Every one of them is answered by an ACK.
+    std::vector<std::vector<unsigned char>> datagrams(DATAGRAMS);
+    std::vector<size_t> lengths(DATAGRAMS);
+    size_t j = 0;
+    for (size_t i = 0; i < DATAGRAMS; i++) {
+        microswim_message_t message = {};
+        message.type = PING_MESSAGE;
+        microswim_record_from_member(&message.sender, &members[(i * 7919) % members.size()]);
+        for (size_t k = 0; k < DATAGRAM_UPDATES; k++) {
+            j = (j + 7919) % members.size();
+            microswim_record_from_member(&message.mu[k], &members[j]);
+        }
+        message.update_count = DATAGRAM_UPDATES;
+
+        datagrams[i].assign(BUFFER_SIZE + 1, 0);
+        lengths[i] = codec->encode(&message, datagrams[i].data(), BUFFER_SIZE);
+    }
+
+    size_t i = 0;
+    uint64_t now = microswim_milliseconds();
+    microswim_scale_sent = 0;
+    microswim_perf_start(&perf);
+    for (auto _ : state) {
+        microswim_message_handle(ms, datagrams[i].data(), (ssize_t)lengths[i], now, NULL);
+        i = (i + 1) % DATAGRAMS;
+    }
+    microswim_perf_stop(&perf, state);
+
+    state.counters["bytes_sent"] =
+        benchmark::Counter((double)microswim_scale_sent, benchmark::Counter::kAvgIterations);
+
+    microswim_release(ms);
+}
+
+static void microswim_scale(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t members : { 8, 64, 512, 4096, 16384 }) {
+        benchmark->Arg(members);
+    }
+}
+
+BENCHMARK(BENCHMARK_microswim_member_find)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_members_check)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_members_check_refuted)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_message_pack)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_pings_check)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_members_check_suspects)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_member_retrieve)->Apply(microswim_scale);
+BENCHMARK(BENCHMARK_microswim_message_handle)->Apply(microswim_scale);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,19 @@
+#ifndef MICROSWIM_CUSTOM_CONFIGURATION_H
+#define MICROSWIM_CUSTOM_CONFIGURATION_H
+
+#define PROTOCOL_PERIOD 1
+#define PING_REQ_PERIOD 0.5
+#define SUSPECT_TIMEOUT 20
+
+#define FAILURE_DETECTION_GROUP 3
+#define GOSSIP_FANOUT 4
+
+// NOTE: The simulator sizes the tables of every node for the number of nodes it runs.
+#define MAXIMUM_MEMBERS 16384
+#define MAXIMUM_UPDATES 16384
+#define MAXIMUM_PINGS 16384
+#define MAXIMUM_EVENTS 10
+
+#define BUFFER_SIZE 1024
+
+#endif
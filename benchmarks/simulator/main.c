@@ -0,0 +1,593 @@
+#include "configuration.h"
+#include "change.h"
+#include "member.h"
+#include "message.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "rng.h"
+#include "simulator.h"
+#include "update.h"
+#include "utils.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// NOTE: Node i goes by 10.0.0.0 + i + 1, so that the addresses say which node they belong to.
+#define SIMULATOR_NETWORK 0x0a000000u
+#define SIMULATOR_PORT 7946
+
+typedef struct {
+    size_t node_count;
+    uint64_t seed;
+    uint64_t latency;     // NOTE: Milliseconds every datagram takes at least
+    uint64_t jitter;      // NOTE: Milliseconds added at random, which reorders the datagrams
+    unsigned loss;        // NOTE: Percentage of the datagrams lost
+    unsigned duplication; // NOTE: Percentage of the datagrams delivered twice
+    unsigned reordering;  // NOTE: Percentage of the datagrams held back by a further latency
+    size_t partition;     // NOTE: Nodes [0, partition) are cut off from the others, none if 0
+    uint64_t partition_start;
+    uint64_t partition_end;
+    size_t crash_count;
+    uint64_t crash_at; // NOTE: Once the nodes have converged if 0
+    uint64_t duration; // NOTE: Virtual milliseconds after which the simulation gives up
+    bool csv;
+} simulator_config_t;
+
+typedef struct {
+    uint64_t deliver_at;
+    uint64_t sequence; // NOTE: Orders the datagrams delivered at the same time
+    size_t node;
+    size_t length;
+    unsigned char* buffer;
+} simulator_datagram_t;
+
+typedef struct {
+    microswim_t ms; // NOTE: First, so that the instances handed to callbacks lead to their node
+    uint64_t deadline;
+    size_t position; // NOTE: Position in the deadline heap
+    size_t detected; // NOTE: Crashed nodes this node has confirmed
+    bool crashed;
+    bool converged;
+} simulator_node_t;
+
+typedef struct {
+    simulator_config_t config;
+    simulator_node_t* nodes;
+    size_t* heap; // NOTE: Binary min-heap of the nodes ordered by their deadline
+    simulator_datagram_t* datagrams; // NOTE: Binary min-heap ordered by the delivery time
+    size_t datagram_count;
+    size_t datagram_capacity;
+    uint64_t sequence;
+
+    size_t sent;
+    size_t bytes;
+    size_t delivered;
+    size_t lost;
+    size_t duplicated;
+    size_t cut;
+
+    size_t converged_count;
+    uint64_t converged_at;
+    size_t converged_sent;
+    size_t converged_bytes;
+
+    size_t live_count;
+    uint64_t crashed_at;
+    uint64_t suspected_at;
+    uint64_t detected_at;
+    size_t detected_count;
+    size_t false_suspicions;
+    size_t false_confirmations;
+} simulator_t;
+
+static bool simulator_roll(unsigned percentage) {
+    return percentage > 0 && simulator_bounded(100) < percentage;
+}
+
+static size_t simulator_node_index(const unsigned char address[4]) {
+    uint32_t ip;
+    memcpy(&ip, address, sizeof(ip));
+    return (size_t)(ntohl(ip) - SIMULATOR_NETWORK - 1);
+}
+
+static bool simulator_datagram_earlier(const simulator_datagram_t* a, const simulator_datagram_t* b) {
+    return a->deliver_at < b->deliver_at ||
+           (a->deliver_at == b->deliver_at && a->sequence < b->sequence);
+}
+
+static void simulator_datagram_push(simulator_t* sim, simulator_datagram_t datagram) {
+    if (sim->datagram_count == sim->datagram_capacity) {
+        sim->datagram_capacity = (sim->datagram_capacity == 0) ? 1024 : 2 * sim->datagram_capacity;
+        sim->datagrams = realloc(sim->datagrams, sim->datagram_capacity * sizeof(simulator_datagram_t));
+        if (sim->datagrams == NULL) {
+            MICROSWIM_LOG_ERROR("Unable to queue %zu datagrams", sim->datagram_capacity);
+            exit(1);
+        }
+    }
+
+    size_t position = sim->datagram_count++;
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!simulator_datagram_earlier(&datagram, &sim->datagrams[parent])) {
+            break;
+        }
+        sim->datagrams[position] = sim->datagrams[parent];
+        position = parent;
+    }
+    sim->datagrams[position] = datagram;
+}
+
+static simulator_datagram_t simulator_datagram_pop(simulator_t* sim) {
+    simulator_datagram_t first = sim->datagrams[0];
+    simulator_datagram_t last = sim->datagrams[--sim->datagram_count];
+
+    size_t position = 0;
+    for (;;) {
+        size_t earliest = 2 * position + 1;
+        if (earliest >= sim->datagram_count) {
+            break;
+        }
+        if (earliest + 1 < sim->datagram_count &&
+            simulator_datagram_earlier(&sim->datagrams[earliest + 1], &sim->datagrams[earliest])) {
+            earliest++;
+        }
+        if (!simulator_datagram_earlier(&sim->datagrams[earliest], &last)) {
+            break;
+        }
+        sim->datagrams[position] = sim->datagrams[earliest];
+        position = earliest;
+    }
+    if (sim->datagram_count > 0) {
+        sim->datagrams[position] = last;
+    }
+
+    return first;
+}
+
+static bool simulator_node_earlier(simulator_t* sim, size_t a, size_t b) {
+    const simulator_node_t* x = &sim->nodes[sim->heap[a]];
+    const simulator_node_t* y = &sim->nodes[sim->heap[b]];
+    return x->deadline < y->deadline || (x->deadline == y->deadline && sim->heap[a] < sim->heap[b]);
+}
+
+static void simulator_node_swap(simulator_t* sim, size_t a, size_t b) {
+    size_t temp = sim->heap[a];
+    sim->heap[a] = sim->heap[b];
+    sim->heap[b] = temp;
+    sim->nodes[sim->heap[a]].position = a;
+    sim->nodes[sim->heap[b]].position = b;
+}
+
+static void simulator_node_sift_down(simulator_t* sim, size_t position) {
+    for (;;) {
+        size_t earliest = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < sim->config.node_count && simulator_node_earlier(sim, left, earliest)) {
+            earliest = left;
+        }
+        if (right < sim->config.node_count && simulator_node_earlier(sim, right, earliest)) {
+            earliest = right;
+        }
+        if (earliest == position) {
+            return;
+        }
+        simulator_node_swap(sim, position, earliest);
+        position = earliest;
+    }
+}
+
+/**
+ * @brief Files the node under its next deadline, which its work may have moved.
+ */
+static void simulator_node_reschedule(simulator_t* sim, size_t index) {
+    simulator_node_t* node = &sim->nodes[index];
+    node->deadline = node->crashed ? UINT64_MAX : microswim_next_deadline(&node->ms);
+
+    size_t position = node->position;
+    while (position > 0 && simulator_node_earlier(sim, position, (position - 1) / 2)) {
+        simulator_node_swap(sim, position, (position - 1) / 2);
+        position = (position - 1) / 2;
+    }
+
+    simulator_node_sift_down(sim, position);
+}
+
+static bool simulator_partitioned(simulator_t* sim, size_t from, size_t to) {
+    const simulator_config_t* config = &sim->config;
+    if (config->partition == 0 || simulator_clock < config->partition_start ||
+        simulator_clock >= config->partition_end) {
+        return false;
+    }
+
+    return (from < config->partition) != (to < config->partition);
+}
+
+/**
+ * @brief Puts the datagram on the simulated network, which may lose, duplicate or delay it.
+ */
+static void simulator_send(
+    void* ms, const struct sockaddr_in* addr, const unsigned char* buffer, size_t length,
+    void* context) {
+    simulator_t* sim = context;
+    const simulator_config_t* config = &sim->config;
+    size_t from = (size_t)((simulator_node_t*)ms - sim->nodes);
+    size_t to = simulator_node_index((const unsigned char*)&addr->sin_addr.s_addr);
+
+    sim->sent++;
+    sim->bytes += length;
+
+    if (to >= config->node_count || simulator_roll(config->loss)) {
+        sim->lost++;
+        return;
+    }
+
+    if (simulator_partitioned(sim, from, to)) {
+        sim->cut++;
+        return;
+    }
+
+    size_t copies = 1;
+    if (simulator_roll(config->duplication)) {
+        sim->duplicated++;
+        copies = 2;
+    }
+
+    for (size_t i = 0; i < copies; i++) {
+        uint64_t delay = config->latency + simulator_bounded(config->jitter + 1);
+        if (simulator_roll(config->reordering)) {
+            delay += config->latency + config->jitter;
+        }
+
+        // NOTE: The decoders expect a terminating null byte after the message.
+        unsigned char* copy = malloc(length + 1);
+        if (copy == NULL) {
+            MICROSWIM_LOG_ERROR("Unable to queue a datagram of %zu bytes", length);
+            exit(1);
+        }
+        memcpy(copy, buffer, length);
+        copy[length] = '\0';
+
+        simulator_datagram_t datagram = {
+            .deliver_at = simulator_clock + delay,
+            .sequence = sim->sequence++,
+            .node = to,
+            .length = length,
+            .buffer = copy,
+        };
+        simulator_datagram_push(sim, datagram);
+    }
+}
+
+/**
+ * @brief Follows the suspicions and confirmations, to time how long the crashes take to detect.
+ */
+static void simulator_on_changes(
+    microswim_t* ms, const microswim_change_t* changes, size_t count, void* context) {
+    simulator_t* sim = context;
+    simulator_node_t* node = (simulator_node_t*)ms;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t target = simulator_node_index(changes[i].record.address);
+        bool crashed = target < sim->config.node_count && sim->nodes[target].crashed;
+
+        if (changes[i].type == CHANGE_SUSPECT) {
+            if (!crashed) {
+                sim->false_suspicions++;
+            } else if (sim->suspected_at == 0) {
+                sim->suspected_at = simulator_clock;
+            }
+        }
+
+        if (changes[i].type != CHANGE_CONFIRMED &&
+            !(changes[i].type == CHANGE_JOINED && changes[i].record.status == CONFIRMED)) {
+            continue;
+        }
+
+        if (!crashed) {
+            sim->false_confirmations++;
+            continue;
+        }
+
+        if (++node->detected == sim->config.crash_count && !node->crashed &&
+            ++sim->detected_count == sim->live_count) {
+            sim->detected_at = simulator_clock;
+        }
+    }
+}
+
+/**
+ * @brief Crashes nodes picked at random, which stop running and receiving from now on.
+ */
+static void simulator_crash(simulator_t* sim) {
+    size_t count = sim->config.crash_count;
+    size_t* order = malloc(sim->config.node_count * sizeof(size_t));
+    if (order == NULL) {
+        exit(1);
+    }
+
+    for (size_t i = 0; i < sim->config.node_count; i++) {
+        order[i] = i;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t j = i + (size_t)simulator_bounded(sim->config.node_count - i);
+        size_t temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+
+        sim->nodes[order[i]].crashed = true;
+        simulator_node_reschedule(sim, order[i]);
+    }
+
+    free(order);
+    sim->live_count = sim->config.node_count - count;
+    sim->crashed_at = simulator_clock;
+}
+
+/**
+ * @brief Notes when every node knows every other one, and counts the traffic it took.
+ */
+static void simulator_check_convergence(simulator_t* sim, simulator_node_t* node) {
+    if (node->converged ||
+        node->ms.member_count - node->ms.anonymous_count < sim->config.node_count) {
+        return;
+    }
+
+    node->converged = true;
+    if (++sim->converged_count == sim->config.node_count) {
+        sim->converged_at = simulator_clock;
+        sim->converged_sent = sim->sent;
+        sim->converged_bytes = sim->bytes;
+    }
+}
+
+static bool simulator_node_setup(simulator_t* sim, size_t index) {
+    simulator_node_t* node = &sim->nodes[index];
+    microswim_t* ms = &node->ms;
+
+    microswim_config_t config = MICROSWIM_CONFIG_DEFAULT;
+    config.maximum_members = sim->config.node_count;
+    config.maximum_updates = sim->config.node_count;
+    config.maximum_pings = sim->config.node_count;
+    if (!microswim_init(ms, &config)) {
+        return false;
+    }
+    microswim_rng_seed(ms, simulator_random());
+
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SIMULATOR_PORT);
+    addr.sin_addr.s_addr = htonl(SIMULATOR_NETWORK + (uint32_t)index + 1);
+    microswim_transport_setup(ms, simulator_send, sim, &addr);
+
+    if (!microswim_changes_enable(ms) || !microswim_changes_subscribe(ms, simulator_on_changes, sim)) {
+        return false;
+    }
+
+    microswim_uuid_generate(&ms->self.uuid);
+    microswim_member_t* self = microswim_member_add(ms, ms->self, simulator_clock);
+    if (self) {
+        microswim_index_add(ms);
+        microswim_update_add(ms, self);
+    }
+
+    // NOTE: Every node but the seed knows the seed's address, and the nodes start their first
+    // protocol period at random within the first one.
+    if (index != 0) {
+        microswim_member_t member = { 0 };
+        member.addr = addr;
+        member.addr.sin_addr.s_addr = htonl(SIMULATOR_NETWORK + 1);
+        member.status = ALIVE;
+
+        microswim_member_t* seed = microswim_member_add(ms, member, simulator_clock);
+        if (seed) {
+            microswim_index_add(ms);
+            microswim_update_add(ms, seed);
+        }
+    }
+    ms->protocol_deadline = simulator_bounded((uint64_t)(PROTOCOL_PERIOD * 1000));
+
+    node->position = index;
+    node->deadline = microswim_next_deadline(ms);
+    sim->heap[index] = index;
+
+    return true;
+}
+
+static bool simulator_done(simulator_t* sim) {
+    if (sim->converged_at == 0) {
+        return false;
+    }
+
+    return sim->config.crash_count == 0 || sim->detected_at != 0;
+}
+
+/**
+ * @brief Runs the nodes and the network in virtual time, one event after the other.
+ */
+static void simulator_run(simulator_t* sim) {
+    const simulator_config_t* config = &sim->config;
+
+    while (!simulator_done(sim)) {
+        uint64_t datagram_at = (sim->datagram_count > 0) ? sim->datagrams[0].deliver_at : UINT64_MAX;
+        uint64_t node_at = sim->nodes[sim->heap[0]].deadline;
+        uint64_t now = (datagram_at < node_at) ? datagram_at : node_at;
+        if (now == UINT64_MAX || now > config->duration) {
+            return;
+        }
+
+        simulator_clock = now;
+
+        if (config->crash_count > 0 && sim->crashed_at == 0 &&
+            ((config->crash_at == 0 && sim->converged_at != 0) ||
+             (config->crash_at != 0 && now >= config->crash_at))) {
+            simulator_crash(sim);
+            continue;
+        }
+
+        size_t index;
+        if (datagram_at <= node_at) {
+            simulator_datagram_t datagram = simulator_datagram_pop(sim);
+            index = datagram.node;
+            if (sim->nodes[index].crashed) {
+                sim->lost++;
+                free(datagram.buffer);
+                continue;
+            }
+
+            sim->delivered++;
+            microswim_message_handle(
+                &sim->nodes[index].ms, datagram.buffer, (ssize_t)datagram.length, now, NULL);
+            free(datagram.buffer);
+        } else {
+            index = sim->heap[0];
+            microswim_tick(&sim->nodes[index].ms, now);
+        }
+
+        microswim_changes_dispatch(&sim->nodes[index].ms);
+        simulator_check_convergence(sim, &sim->nodes[index]);
+        simulator_node_reschedule(sim, index);
+    }
+}
+
+static void simulator_report(simulator_t* sim, double cpu) {
+    const simulator_config_t* config = &sim->config;
+    double period = PROTOCOL_PERIOD * 1000.0;
+    double converged = sim->converged_at / 1000.0;
+    double rounds = (sim->converged_at != 0) ? sim->converged_at / period : 0;
+    double suspected = (sim->suspected_at != 0) ? (sim->suspected_at - sim->crashed_at) / 1000.0 : 0;
+    double detected = (sim->detected_at != 0) ? (sim->detected_at - sim->crashed_at) / 1000.0 : 0;
+
+    if (config->csv) {
+        printf(
+            "nodes,seed,latency,jitter,loss,duplication,reordering,partition,crashes,"
+            "converged_s,rounds,messages,bytes,suspected_s,detected_s,false_suspicions,"
+            "false_confirmations,sent,sent_bytes,delivered,lost,duplicated,cut,virtual_s,cpu_s\n");
+        printf(
+            "%zu,%llu,%llu,%llu,%u,%u,%u,%zu,%zu,%.3f,%.1f,%zu,%zu,%.3f,%.3f,%zu,%zu,%zu,%zu,%zu,"
+            "%zu,%zu,%zu,%.3f,%.3f\n",
+            config->node_count, (unsigned long long)config->seed,
+            (unsigned long long)config->latency, (unsigned long long)config->jitter, config->loss,
+            config->duplication, config->reordering, config->partition, config->crash_count,
+            converged, rounds, sim->converged_sent, sim->converged_bytes, suspected, detected,
+            sim->false_suspicions, sim->false_confirmations, sim->sent, sim->bytes, sim->delivered,
+            sim->lost, sim->duplicated, sim->cut, simulator_clock / 1000.0, cpu);
+        return;
+    }
+
+    printf(
+        "[SIMULATOR] %zu nodes, seed %llu, latency %llu+%llu ms, loss %u%%, duplication %u%%, "
+        "reordering %u%%\n",
+        config->node_count, (unsigned long long)config->seed, (unsigned long long)config->latency,
+        (unsigned long long)config->jitter, config->loss, config->duplication, config->reordering);
+
+    if (sim->converged_at != 0) {
+        printf(
+            "[SIMULATOR] converged after %.3f s (%.1f rounds), %zu messages, %zu bytes\n",
+            converged, rounds, sim->converged_sent, sim->converged_bytes);
+    } else {
+        printf("[SIMULATOR] %zu/%zu nodes converged\n", sim->converged_count, config->node_count);
+    }
+
+    if (config->crash_count > 0) {
+        printf(
+            "[SIMULATOR] %zu crashes: first suspected after %.3f s, confirmed by %zu/%zu nodes "
+            "after %.3f s\n",
+            config->crash_count, suspected, sim->detected_count, sim->live_count, detected);
+    }
+
+    printf(
+        "[SIMULATOR] %zu false suspicions, %zu false confirmations\n", sim->false_suspicions,
+        sim->false_confirmations);
+    printf(
+        "[SIMULATOR] %zu messages, %zu bytes sent; %zu delivered, %zu lost, %zu duplicated, %zu "
+        "cut by the partition\n",
+        sim->sent, sim->bytes, sim->delivered, sim->lost, sim->duplicated, sim->cut);
+    printf(
+        "[SIMULATOR] %.3f s of virtual time in %.3f s of CPU time\n", simulator_clock / 1000.0, cpu);
+}
+
+static void simulator_usage(const char* name) {
+    printf(
+        "Usage: %s [-n nodes] [-s seed] [-l latency] [-j jitter] [-d loss%%] [-u duplication%%]\n"
+        "       [-r reordering%%] [-p nodes -a start -b end] [-k crashes [-K at]] [-t seconds] [-c]\n",
+        name);
+}
+
+int main(int argc, char** argv) {
+    simulator_t sim = { 0 };
+    simulator_config_t* config = &sim.config;
+    config->node_count = 64;
+    config->seed = 1;
+    config->latency = 5;
+    config->jitter = 5;
+    config->duration = 600;
+    config->partition_end = UINT64_MAX;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:s:l:j:d:u:r:p:a:b:k:K:t:ch")) != -1) {
+        switch (option) {
+            case 'n': config->node_count = strtoull(optarg, NULL, 10); break;
+            case 's': config->seed = strtoull(optarg, NULL, 10); break;
+            case 'l': config->latency = strtoull(optarg, NULL, 10); break;
+            case 'j': config->jitter = strtoull(optarg, NULL, 10); break;
+            case 'd': config->loss = (unsigned)atoi(optarg); break;
+            case 'u': config->duplication = (unsigned)atoi(optarg); break;
+            case 'r': config->reordering = (unsigned)atoi(optarg); break;
+            case 'p': config->partition = strtoull(optarg, NULL, 10); break;
+            case 'a': config->partition_start = strtoull(optarg, NULL, 10) * 1000; break;
+            case 'b': config->partition_end = strtoull(optarg, NULL, 10) * 1000; break;
+            case 'k': config->crash_count = strtoull(optarg, NULL, 10); break;
+            case 'K': config->crash_at = strtoull(optarg, NULL, 10) * 1000; break;
+            case 't': config->duration = strtoull(optarg, NULL, 10); break;
+            case 'c': config->csv = true; break;
+            default: simulator_usage(argv[0]); return 1;
+        }
+    }
+    config->duration *= 1000;
+
+    if (config->node_count < 2 || config->crash_count >= config->node_count) {
+        simulator_usage(argv[0]);
+        return 1;
+    }
+
+    simulator_seed(config->seed);
+
+    sim.nodes = calloc(config->node_count, sizeof(simulator_node_t));
+    sim.heap = calloc(config->node_count, sizeof(size_t));
+    if (sim.nodes == NULL || sim.heap == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to allocate %zu nodes", config->node_count);
+        return 1;
+    }
+
+    sim.live_count = config->node_count;
+    for (size_t i = 0; i < config->node_count; i++) {
+        if (!simulator_node_setup(&sim, i)) {
+            MICROSWIM_LOG_ERROR("Unable to set up node %zu", i);
+            return 1;
+        }
+    }
+    for (size_t i = config->node_count / 2 + 1; i-- > 0;) {
+        simulator_node_sift_down(&sim, i);
+    }
+
+    clock_t start = clock();
+    simulator_run(&sim);
+    double cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    simulator_report(&sim, cpu);
+
+    while (sim.datagram_count > 0) {
+        free(simulator_datagram_pop(&sim).buffer);
+    }
+    for (size_t i = 0; i < config->node_count; i++) {
+        microswim_deinit(&sim.nodes[i].ms);
+    }
+    free(sim.datagrams);
+    free(sim.heap);
+    free(sim.nodes);
+
+    return (sim.converged_at != 0) ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#ifndef MICROSWIM_SIMULATOR_H
+#define MICROSWIM_SIMULATOR_H
+
+#include <stdint.h>
+
+// NOTE: The virtual clock, in milliseconds, which `microswim_milliseconds` reads.
+extern uint64_t simulator_clock;
+
+void simulator_seed(uint64_t seed);
+uint64_t simulator_random(void);
+uint64_t simulator_bounded(uint64_t bound);
+
+#endif // MICROSWIM_SIMULATOR_H
@@ -0,0 +1,59 @@
+#include "utils.h"
+#include "simulator.h"
+#include <stdio.h>
+#include <string.h>
+
+uint64_t simulator_clock = 0;
+
+// NOTE: splitmix64, which is all the simulator needs and easy to seed from a single number.
+static uint64_t simulator_state = 0;
+
+void simulator_seed(uint64_t seed) {
+    simulator_state = seed;
+}
+
+uint64_t simulator_random(void) {
+    uint64_t z = (simulator_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns a number in [0, bound), without the bias of a plain modulo.
+ */
+uint64_t simulator_bounded(uint64_t bound) {
+    uint64_t threshold = -bound % bound;
+    for (;;) {
+        uint64_t value = simulator_random();
+        if (value >= threshold) {
+            return value % bound;
+        }
+    }
+}
+
+size_t microswim_random() {
+    return (size_t)simulator_random();
+}
+
+uint64_t microswim_milliseconds() {
+    return simulator_clock;
+}
+
+void microswim_uuid_generate(microswim_id_t* uuid) {
+    uint64_t high = simulator_random();
+    uint64_t low = simulator_random();
+    memcpy(uuid->bytes, &high, sizeof(high));
+    memcpy(uuid->bytes + sizeof(high), &low, sizeof(low));
+
+    // NOTE: Marked as a random (version 4) UUID, as libuuid would.
+    uuid->bytes[6] = (uuid->bytes[6] & 0x0f) | 0x40;
+    uuid->bytes[8] = (uuid->bytes[8] & 0x3f) | 0x80;
+}
+
+void microswim_sockaddr_to_uri(struct sockaddr_in* addr, char* buffer, size_t buffer_size) {
+    char ip_str[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(addr->sin_addr), ip_str, sizeof(ip_str));
+    int port = ntohs(addr->sin_port);
+    snprintf(buffer, buffer_size, "%s:%d", ip_str, port);
+}
@@ -0,0 +1,21 @@
+#ifndef MICROSWIM_CUSTOM_CONFIGURATION_H
+#define MICROSWIM_CUSTOM_CONFIGURATION_H
+
+#define PROTOCOL_PERIOD 2
+#define PING_REQ_PERIOD 1
+#define SUSPECT_TIMEOUT 30
+
+#define FAILURE_DETECTION_GROUP 3
+#define GOSSIP_FANOUT 4
+
+// NOTE: The fleet sizes the tables of every instance for the number of instances it runs.
+#define MAXIMUM_MEMBERS 16384
+#define MAXIMUM_UPDATES 16384
+#define MAXIMUM_PINGS 16384
+#define MAXIMUM_EVENTS 10
+
+// NOTE: As large as the payload of a datagram over Ethernet, so that every message piggybacks
+// as many updates as it can without being fragmented.
+#define BUFFER_SIZE 1473
+
+#endif
@@ -0,0 +1,199 @@
+#include "loop.h"
+#include "member.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "update.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+// NOTE: File descriptors needed besides the sockets: the standard streams, and an epoll set
+// and a timer per loop.
+#define FLEET_DESCRIPTORS 16
+
+// NOTE: Seconds between the reports of the fleet.
+#define FLEET_REPORT 5
+
+typedef struct {
+    microswim_t* instances;
+    size_t instance_count;
+    _Atomic size_t* members; // NOTE: Member count of every instance as of its last round
+} fleet_t;
+
+typedef struct {
+    microswim_loop_t loop;
+    pthread_t thread;
+} worker_t;
+
+void on_round(microswim_t* ms, void* context) {
+    fleet_t* fleet = context;
+    size_t index = (size_t)(ms - fleet->instances);
+    atomic_store_explicit(&fleet->members[index], ms->member_count, memory_order_relaxed);
+}
+
+void* worker_run(void* argument) {
+    worker_t* worker = argument;
+    microswim_loop_run(&worker->loop);
+    return NULL;
+}
+
+void log_statistics(fleet_t* fleet, uint64_t elapsed) {
+    size_t converged = 0;
+    size_t minimum = SIZE_MAX;
+    size_t maximum = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < fleet->instance_count; i++) {
+        size_t members = atomic_load_explicit(&fleet->members[i], memory_order_relaxed);
+        converged += (members == fleet->instance_count);
+        minimum = (members < minimum) ? members : minimum;
+        maximum = (members > maximum) ? members : maximum;
+        total += members;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf(
+        "[FLEET] %3llus: %zu/%zu converged, members min %zu avg %zu max %zu, %ld MiB resident\n",
+        (unsigned long long)elapsed, converged, fleet->instance_count, minimum,
+        total / fleet->instance_count, maximum, usage.ru_maxrss / 1024);
+    fflush(stdout);
+}
+
+/**
+ * @brief Raises the limit on open file descriptors as far as it goes, since every instance
+ * has a socket of its own.
+ */
+bool raise_descriptor_limit(size_t needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return false;
+    }
+
+    if (limit.rlim_cur < needed) {
+        limit.rlim_cur = (limit.rlim_max < needed) ? limit.rlim_max : needed;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (limit.rlim_cur < needed) {
+        MICROSWIM_LOG_ERROR("Unable to open %zu file descriptors, the limit is %llu", needed,
+                            (unsigned long long)limit.rlim_cur);
+        return false;
+    }
+
+    return true;
+}
+
+bool instance_setup(microswim_t* ms, const microswim_config_t* config, char* address, int port, int seed) {
+    if (!microswim_init(ms, config)) {
+        return false;
+    }
+
+    microswim_socket_setup(ms, address, port);
+    if (ms->socket < 0) {
+        return false;
+    }
+
+    microswim_uuid_generate(&ms->self.uuid);
+
+    microswim_member_t* self = microswim_member_add(ms, ms->self, microswim_milliseconds());
+    if (self) {
+        microswim_index_add(ms);
+        microswim_update_add(ms, self);
+    }
+
+    if (port == seed) {
+        return true;
+    }
+
+    microswim_member_t member;
+    memset(&member, 0, sizeof(member));
+    member.addr = ms->self.addr;
+    member.addr.sin_port = htons(seed);
+    member.status = ALIVE;
+
+    microswim_member_t* remote = microswim_member_add(ms, member, microswim_milliseconds());
+    if (remote) {
+        microswim_index_add(ms);
+        microswim_update_add(ms, remote);
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printf("Usage: %s <address> <first port> <instances> [threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    srand(time(NULL));
+
+    char* address = argv[1];
+    int first_port = atoi(argv[2]);
+    size_t instance_count = strtoul(argv[3], NULL, 10);
+    size_t worker_count = (argc > 4) ? strtoul(argv[4], NULL, 10) : 1;
+    uint64_t duration = (argc > 5) ? strtoull(argv[5], NULL, 10) : 0;
+    if (instance_count == 0 || worker_count == 0 || first_port + instance_count > 65536) {
+        MICROSWIM_LOG_ERROR("Invalid arguments");
+        return 1;
+    }
+
+    if (!raise_descriptor_limit(instance_count + 2 * worker_count + FLEET_DESCRIPTORS)) {
+        return 1;
+    }
+
+    fleet_t fleet = { .instance_count = instance_count };
+    fleet.instances = calloc(instance_count, sizeof(microswim_t));
+    fleet.members = calloc(instance_count, sizeof(*fleet.members));
+    worker_t* workers = calloc(worker_count, sizeof(worker_t));
+    if (fleet.instances == NULL || fleet.members == NULL || workers == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to allocate %zu instances", instance_count);
+        return 1;
+    }
+
+    // NOTE: Every instance is to learn about all the others, and the seed hears from them all.
+    microswim_config_t config = MICROSWIM_CONFIG_DEFAULT;
+    config.maximum_members = instance_count;
+    config.maximum_updates = instance_count;
+    config.maximum_pings = instance_count;
+
+    microswim_loop_hooks_t hooks = { .round = on_round, .context = &fleet };
+    for (size_t i = 0; i < worker_count; i++) {
+        if (!microswim_loop_init(&workers[i].loop, NULL, &hooks)) {
+            return 1;
+        }
+    }
+
+    // NOTE: The instances are spread over the loops round-robin and share nothing, so every
+    // loop runs on a thread of its own.
+    for (size_t i = 0; i < instance_count; i++) {
+        microswim_t* ms = &fleet.instances[i];
+        if (!instance_setup(ms, &config, address, first_port + (int)i, first_port) ||
+            !microswim_loop_add(&workers[i % worker_count].loop, ms)) {
+            MICROSWIM_LOG_ERROR("Unable to set up the instance on port %zu", first_port + i);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < worker_count; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    }
+
+    uint64_t start = microswim_milliseconds();
+    for (;;) {
+        sleep(FLEET_REPORT);
+
+        uint64_t elapsed = (microswim_milliseconds() - start) / 1000;
+        log_statistics(&fleet, elapsed);
+
+        if (duration != 0 && elapsed >= duration) {
+            // NOTE: The workers block in their loops, the process exits from under them.
+            return 0;
+        }
+    }
+}
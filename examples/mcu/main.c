@@ -28,17 +28,22 @@
 #include <sys/select.h>
 #include <unistd.h>
 
-#define DEADLINE_DETECTION_PERIOD 100000
+#define MEMORY_SIZE MICROSWIM_MEMORY_SIZE(MAXIMUM_MEMBERS, MAXIMUM_UPDATES, MAXIMUM_PINGS)
 
 static microswim_t ms;
+static uint8_t memory[MEMORY_SIZE] __attribute__((aligned(ARENA_ALIGNMENT)));
 
-static void _failure_detection_cb(event_t* arg);
-static event_t _failure_detection_step = { .handler = _failure_detection_cb };
-static event_timeout_t _failure_detection_step_event_timeout;
+static void _tick_cb(event_t* arg);
+static event_t _tick_step = { .handler = _tick_cb };
+static event_timeout_t _tick_step_event_timeout;
 
-static void _deadline_detection_cb(event_t* arg);
-static event_t _deadline_detection_step = { .handler = _deadline_detection_cb };
-static event_timeout_t _deadline_detection_step_event_timeout;
+static void _tick_schedule(void) {
+    uint64_t now = microswim_milliseconds();
+    uint64_t deadline = microswim_next_deadline(&ms);
+    uint64_t wait = (deadline > now) ? deadline - now : 0;
+
+    event_timeout_set(&_tick_step_event_timeout, (uint32_t)(wait * US_PER_MS));
+}
 
 static void _udp_event_handler(sock_udp_t* sock, sock_async_flags_t type, void* arg) {
     (void)arg;
@@ -53,56 +58,36 @@ static void _udp_event_handler(sock_udp_t* sock, sock_async_flags_t type, void*
         }
         buffer[bytes] = '\0';
 
-        microswim_message_handle(&ms, buffer, bytes, NULL);
+        microswim_message_handle(&ms, buffer, bytes, microswim_milliseconds(), NULL);
+
+        // NOTE: Handling the message may have armed an earlier deadline.
+        _tick_schedule();
     }
 }
 
-static void _failure_detection_cb(event_t* arg) {
+static void _tick_cb(event_t* arg) {
     (void)arg;
 
-    for (int i = 0; i < GOSSIP_FANOUT; i++) {
-        microswim_member_t* member = microswim_member_retrieve(&ms);
-        if (member) {
-            unsigned char buffer[BUFFER_SIZE] = { 0 };
-            microswim_message_t message = { 0 };
-            microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-
-            size_t update_count = microswim_updates_retrieve(&ms, updates);
-            microswim_message_construct(&ms, &message, PING_MESSAGE, updates, update_count);
-            size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-
-            microswim_message_send(&ms, member, (const char*)buffer, length);
-            char uri_buffer[64] = { 0 };
-            microswim_sockaddr_to_uri(&member->addr, uri_buffer, 64);
-            MICROSWIM_LOG_DEBUG("Sending PING message to %s (%s)", member->uuid, uri_buffer);
-            microswim_ping_add(&ms, member);
+    uint64_t round = ms.protocol_deadline;
+    microswim_tick(&ms, microswim_milliseconds());
+
+    if (ms.protocol_deadline != round) {
+        MICROSWIM_LOG_DEBUG("ms->ping_count: %u", ms.ping_count);
+        MICROSWIM_LOG_DEBUG("ms->ping_req_count: %u", ms.ping_req_count);
+        MICROSWIM_LOG_DEBUG("ms->update_count: %u", ms.update_count);
+        MICROSWIM_LOG_DEBUG("ms->member_count: %u", ms.member_count);
+        MICROSWIM_LOG_DEBUG("ms->confirmed_count: %u", ms.confirmed_count);
+        printf("[DEBUG] ms->indices: [");
+        for (size_t i = 0; i < ms.member_count; i++) {
+            if (i < ms.member_count - 1) {
+                printf("%u ", ms.indices[i]);
+            } else {
+                printf("%u]\r\n", ms.indices[i]);
+            }
         }
     }
 
-    MICROSWIM_LOG_DEBUG("ms->ping_count: %u", ms.ping_count);
-    MICROSWIM_LOG_DEBUG("ms->ping_req_count: %u", ms.ping_req_count);
-    MICROSWIM_LOG_DEBUG("ms->update_count: %u", ms.update_count);
-    MICROSWIM_LOG_DEBUG("ms->member_count: %u", ms.member_count);
-    MICROSWIM_LOG_DEBUG("ms->confirmed_count: %u", ms.confirmed_count);
-    printf("[DEBUG] ms->indices: [");
-    for (size_t i = 0; i < ms.member_count; i++) {
-        if (i < ms.member_count - 1) {
-            printf("%u ", ms.indices[i]);
-        } else {
-            printf("%u]\r\n", ms.indices[i]);
-        }
-    }
-
-    event_timeout_set(&_failure_detection_step_event_timeout, PROTOCOL_PERIOD * US_PER_SEC);
-}
-
-static void _deadline_detection_cb(event_t* arg) {
-    (void)arg;
-    microswim_ping_reqs_check(&ms);
-    microswim_pings_check(&ms);
-    microswim_members_check_suspects(&ms);
-
-    event_timeout_set(&_deadline_detection_step_event_timeout, DEADLINE_DETECTION_PERIOD);
+    _tick_schedule();
 }
 
 void wait_for_ipv4(void) {
@@ -120,25 +105,31 @@ void wait_for_ipv4(void) {
 int main(void) {
     wait_for_ipv4();
 
-    memset(&ms, 0, sizeof(ms));
+    // NOTE: the tables are carved out of a static buffer sized for their maximums, so that
+    // the heap is never touched.
+    microswim_config_t config = MICROSWIM_CONFIG_DEFAULT;
+    config.memory = memory;
+    config.memory_size = sizeof(memory);
+    if (!microswim_init(&ms, &config)) {
+        return 1;
+    }
+
     microswim_socket_setup(&ms, NULL, 8000);
 
     char buffer[64];
     microswim_sockaddr_to_uri(&ms.self.addr, buffer, 64);
     MICROSWIM_LOG_INFO("SELF.ADDR: %s", buffer);
 
-    char uuid[UUID_SIZE];
-    microswim_uuid_generate(uuid);
-    strncpy((char*)ms.self.uuid, uuid, UUID_SIZE);
+    microswim_uuid_generate(&ms.self.uuid);
 
-    microswim_member_t* self = microswim_member_add(&ms, ms.self);
+    microswim_member_t* self = microswim_member_add(&ms, ms.self, microswim_milliseconds());
     if (self) {
         microswim_index_add(&ms);
         microswim_update_add(&ms, self);
     }
 
     microswim_member_t member;
-    member.uuid[0] = '\0';
+    memset(&member.uuid, 0, sizeof(member.uuid));
     member.addr.family = AF_INET;
     member.addr.port = 8000;
     member.addr.netif = SOCK_ADDR_ANY_NETIF;
@@ -151,18 +142,15 @@ int main(void) {
     microswim_sockaddr_to_uri(&member.addr, buffer, 64);
     MICROSWIM_LOG_INFO("MEMBER.ADDR: %s", buffer);
 
-    microswim_member_t* remote = microswim_member_add(&ms, member);
+    microswim_member_t* remote = microswim_member_add(&ms, member, microswim_milliseconds());
     if (remote) {
         microswim_index_add(&ms);
         microswim_update_add(&ms, remote);
     }
 
     sock_udp_event_init(&ms.socket, EVENT_PRIO_MEDIUM, _udp_event_handler, NULL);
-    event_timeout_init(&_failure_detection_step_event_timeout, EVENT_PRIO_MEDIUM, &_failure_detection_step);
-    event_timeout_set(&_failure_detection_step_event_timeout, PROTOCOL_PERIOD);
-
-    event_timeout_init(&_deadline_detection_step_event_timeout, EVENT_PRIO_MEDIUM, &_deadline_detection_step);
-    event_timeout_set(&_deadline_detection_step_event_timeout, DEADLINE_DETECTION_PERIOD);
+    event_timeout_init(&_tick_step_event_timeout, EVENT_PRIO_MEDIUM, &_tick_step);
+    event_timeout_set(&_tick_step_event_timeout, 0);
 
     return 0;
 }
@@ -7,6 +7,7 @@
 #include "ztimer.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 size_t microswim_random(void) {
     return random_uint32();
@@ -16,10 +17,10 @@ uint64_t microswim_milliseconds(void) {
     return ztimer_now(ZTIMER_MSEC);
 }
 
-void microswim_uuid_generate(char* uuid) {
+void microswim_uuid_generate(microswim_id_t* uuid) {
     uuid_t uuid_binary;
     uuid_v4(&uuid_binary);
-    uuid_to_string(&uuid_binary, uuid);
+    memcpy(uuid->bytes, &uuid_binary, sizeof(uuid->bytes));
 }
 
 void microswim_sockaddr_to_uri(sock_udp_ep_t* addr, char* buffer, size_t buffer_size) {
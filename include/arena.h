@@ -0,0 +1,21 @@
+#ifndef MICROSWIM_ARENA_H
+#define MICROSWIM_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+void* microswim_arena_reallocate(
+    microswim_arena_t* arena, void* block, size_t size, size_t new_size);
+void microswim_arena_release(microswim_arena_t* arena, void* block);
+void* microswim_arena_grow(
+    microswim_arena_t* arena, void* table, size_t* capacity, size_t element_size, size_t count,
+    size_t maximum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_ARENA_H
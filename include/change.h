@@ -0,0 +1,49 @@
+#ifndef MICROSWIM_CHANGE_H
+#define MICROSWIM_CHANGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+typedef enum {
+    CHANGE_JOINED = 0, // NOTE: The member is known by its UUID from now on
+    CHANGE_ALIVE,
+    CHANGE_SUSPECT,
+    CHANGE_CONFIRMED,
+    CHANGE_REMOVED,
+} microswim_change_type_t;
+
+/**
+ * @brief A change of the membership, as the record of the member right after it.
+ *
+ * Sequence numbers start at 1 and have no gaps, so a consumer which finds one missing knows
+ * the changes in between were overwritten before it got to them.
+ */
+typedef struct {
+    uint64_t sequence;
+    microswim_change_type_t type;
+    microswim_update_record_t record;
+} microswim_change_t;
+
+/**
+ * @brief Receives the changes logged since the previous call, oldest first.
+ */
+typedef void (*microswim_change_handler_t)(
+    microswim_t* ms, const microswim_change_t* changes, size_t count, void* context);
+
+bool microswim_changes_enable(microswim_t* ms);
+void microswim_changes_disable(microswim_t* ms);
+bool microswim_changes_subscribe(microswim_t* ms, microswim_change_handler_t handler, void* context);
+void microswim_changes_dispatch(microswim_t* ms);
+size_t microswim_changes_read(
+    microswim_t* ms, uint64_t* sequence, microswim_change_t* changes, size_t count);
+void microswim_change_append(
+    microswim_t* ms, microswim_change_type_t type, const microswim_member_t* member);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_CHANGE_H
@@ -0,0 +1,30 @@
+#ifndef MICROSWIM_CODEC_H
+#define MICROSWIM_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+#ifdef MICROSWIM_CBOR
+extern const microswim_codec_t microswim_codec_cbor;
+#endif
+#ifdef MICROSWIM_JSON
+extern const microswim_codec_t microswim_codec_json;
+#endif
+#ifdef MICROSWIM_BINARY
+extern const microswim_codec_t microswim_codec_binary;
+#endif
+
+bool microswim_codec_register(microswim_t* ms, const microswim_codec_t* codec);
+bool microswim_codecs_register(microswim_t* ms);
+const microswim_codec_t* microswim_codec_detect(microswim_t* ms, const unsigned char* buffer, size_t len);
+const microswim_codec_t* microswim_codec_select(microswim_t* ms, microswim_member_t* member);
+void microswim_codec_assign(microswim_t* ms, microswim_member_t* member, const microswim_codec_t* codec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_CODEC_H
@@ -1,10 +1,24 @@
 #ifndef MICROSWIM_CONSTANTS_H
 #define MICROSWIM_CONSTANTS_H
 
-#define UUID_SIZE 37
+#define UUID_SIZE 37 // NOTE: Textual UUID including the terminating null byte
+#define ID_SIZE 16
+#define URI_SIZE 22 // NOTE: Textual IPv4 address and port including the terminating null byte
+
+// NOTE: Room for the encoded glue around the sender of a message, in any codec
+#define FRAME_SIZE 24
 
 #define SIN_FAMILY 0x01
 #define SIN_PORT 0x02
 #define SIN_ADDR 0x04
 
+// NOTE: Leading byte of binary messages, which can start neither a CBOR map nor a JSON object
+#define BINARY_VERSION 0x02
+#define BINARY_HEADER_SIZE 3  // NOTE: Version, message type and update count
+#define BINARY_MEMBER_SIZE 23 // NOTE: Status, ID, IPv4 address and port, without the incarnation
+#define BINARY_VARINT_SIZE 10 // NOTE: Longest LEB128 encoding of a 64-bit incarnation
+
+// NOTE: Shortest encoding of an update in any codec, a binary member with a one-byte incarnation
+#define UPDATE_SIZE_MINIMUM (BINARY_MEMBER_SIZE + 1)
+
 #endif
@@ -7,8 +7,29 @@ extern "C" {
 
 #include "microswim.h"
 
-void microswim_decode_message(microswim_message_t* message, const char* buffer, ssize_t len);
-microswim_message_type_t microswim_decode_message_type(unsigned char* buffer, ssize_t len);
+#ifdef MICROSWIM_CBOR
+bool microswim_decode_cbor_message(microswim_message_t* message, const char* buffer, ssize_t len);
+microswim_message_type_t microswim_decode_cbor_message_type(unsigned char* buffer, ssize_t len);
+bool microswim_decode_cbor_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len);
+bool microswim_decode_cbor_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record);
+#endif
+
+#ifdef MICROSWIM_JSON
+bool microswim_decode_json_message(microswim_message_t* message, const char* buffer, ssize_t len);
+microswim_message_type_t microswim_decode_json_message_type(unsigned char* buffer, ssize_t len);
+bool microswim_decode_json_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len);
+bool microswim_decode_json_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record);
+#endif
+
+#ifdef MICROSWIM_BINARY
+bool microswim_decode_binary_message(microswim_message_t* message, const char* buffer, ssize_t len);
+microswim_message_type_t microswim_decode_binary_message_type(unsigned char* buffer, ssize_t len);
+bool microswim_decode_binary_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len);
+bool microswim_decode_binary_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record);
+#endif
 
 #ifdef __cplusplus
 }
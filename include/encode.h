@@ -7,7 +7,26 @@ extern "C" {
 
 #include "microswim.h"
 
-size_t microswim_encode_message(microswim_message_t* message, unsigned char* buffer, size_t size);
+#ifdef MICROSWIM_CBOR
+size_t microswim_encode_cbor_message(microswim_message_t* message, unsigned char* buffer, size_t size);
+size_t microswim_encode_cbor_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size);
+void microswim_encode_cbor_frame(microswim_message_t* message, microswim_frame_t* frame);
+#endif
+
+#ifdef MICROSWIM_JSON
+size_t microswim_encode_json_message(microswim_message_t* message, unsigned char* buffer, size_t size);
+size_t microswim_encode_json_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size);
+void microswim_encode_json_frame(microswim_message_t* message, microswim_frame_t* frame);
+#endif
+
+#ifdef MICROSWIM_BINARY
+size_t microswim_encode_binary_message(microswim_message_t* message, unsigned char* buffer, size_t size);
+size_t microswim_encode_binary_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size);
+void microswim_encode_binary_frame(microswim_message_t* message, microswim_frame_t* frame);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,52 @@
+#ifndef MICROSWIM_FRAGMENT_H
+#define MICROSWIM_FRAGMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "message.h"
+#include "microswim.h"
+#ifndef RIOT_OS
+#include <sys/uio.h>
+#endif
+
+// NOTE: The frame's head, the sender, the frame's middle and the tail, and a separator and a
+// fragment per update.
+#define SPLICE_PARTS (4 + 2 * MESSAGE_UPDATES)
+
+#ifdef RIOT_OS
+typedef struct {
+    void* iov_base;
+    size_t iov_len;
+} microswim_iovec_t;
+#else
+typedef struct iovec microswim_iovec_t;
+#endif
+
+/**
+ * @brief An encoded message as a list of the cached fragments it is made of.
+ */
+typedef struct {
+    microswim_frame_t frame;
+    microswim_iovec_t parts[SPLICE_PARTS];
+    size_t count;
+    size_t length;
+} microswim_splice_t;
+
+bool microswim_fragment_reserve(microswim_t* ms);
+size_t microswim_fragment_sender(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    const unsigned char** data);
+size_t microswim_fragment_update(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* record,
+    const unsigned char** data);
+bool microswim_fragment_splice(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    microswim_splice_t* splice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_FRAGMENT_H
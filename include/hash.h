@@ -0,0 +1,19 @@
+#ifndef MICROSWIM_HASH_H
+#define MICROSWIM_HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+microswim_hash_entry_t* microswim_hash_find(microswim_t* ms, const microswim_id_t* uuid);
+microswim_hash_entry_t* microswim_hash_insert(microswim_t* ms, const microswim_id_t* uuid);
+void microswim_hash_release(microswim_t* ms, microswim_hash_entry_t* entry);
+bool microswim_hash_reserve(microswim_t* ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_HASH_H
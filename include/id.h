@@ -0,0 +1,61 @@
+#ifndef MICROSWIM_ID_H
+#define MICROSWIM_ID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "constants.h"
+
+/**
+ * @brief Binary member identifier (the 16 bytes of a UUID).
+ *
+ * The textual UUID form is only used when encoding, decoding and logging.
+ * An identifier with all bytes set to zero is "nil" and stands for a member
+ * whose UUID is not known yet.
+ */
+typedef struct {
+    uint8_t bytes[ID_SIZE];
+} microswim_id_t;
+
+/**
+ * @brief Compares two identifiers with a single 128-bit comparison.
+ */
+static inline bool microswim_id_equal(const microswim_id_t* a, const microswim_id_t* b) {
+#if defined(__SSE2__)
+    __m128i x = _mm_loadu_si128((const __m128i*)a->bytes);
+    __m128i y = _mm_loadu_si128((const __m128i*)b->bytes);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xFFFF;
+#else
+    uint64_t x[2], y[2];
+    memcpy(x, a->bytes, ID_SIZE);
+    memcpy(y, b->bytes, ID_SIZE);
+    return ((x[0] ^ y[0]) | (x[1] ^ y[1])) == 0;
+#endif
+}
+
+/**
+ * @brief Checks whether the identifier is nil, i.e. the UUID is not known yet.
+ */
+static inline bool microswim_id_is_nil(const microswim_id_t* id) {
+    uint64_t x[2];
+    memcpy(x, id->bytes, ID_SIZE);
+    return (x[0] | x[1]) == 0;
+}
+
+bool microswim_id_parse(microswim_id_t* id, const char* text, size_t length);
+void microswim_id_format(const microswim_id_t* id, char* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_ID_H
@@ -0,0 +1,60 @@
+#ifndef MICROSWIM_IO_H
+#define MICROSWIM_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fragment.h"
+#include "microswim.h"
+
+#ifdef RIOT_OS
+// NOTE: RIOT sends and receives through its own sock API, one datagram at a time.
+static inline bool microswim_io_reserve(microswim_t* ms) {
+    (void)ms;
+    return false;
+}
+
+static inline void microswim_io_release(microswim_t* ms) {
+    (void)ms;
+}
+
+static inline void microswim_io_cork(microswim_t* ms) {
+    (void)ms;
+}
+
+static inline void microswim_io_uncork(microswim_t* ms) {
+    (void)ms;
+}
+#else
+/**
+ * @brief Decides whether a received datagram is handled, or dropped as if it had been lost.
+ */
+typedef bool (*microswim_io_admit_t)(
+    microswim_t* ms, const microswim_datagram_t* datagram, void* context);
+
+microswim_io_t* microswim_io_create(microswim_arena_t* arena, bool shared);
+void microswim_io_destroy(microswim_arena_t* arena, microswim_io_t* io);
+bool microswim_io_reserve(microswim_t* ms);
+void microswim_io_lend(microswim_t* ms, microswim_io_t* io);
+void microswim_io_release(microswim_t* ms);
+bool microswim_io_uring_setup(microswim_t* ms);
+bool microswim_io_shard_setup(microswim_t* ms, size_t count);
+size_t microswim_io_dropped(microswim_t* ms);
+int microswim_io_descriptor(microswim_t* ms);
+size_t microswim_io_system_calls(microswim_t* ms);
+void microswim_io_cork(microswim_t* ms);
+void microswim_io_uncork(microswim_t* ms);
+bool microswim_io_queue(
+    microswim_t* ms, const struct sockaddr_in* addr, const microswim_iovec_t* parts, size_t count);
+size_t microswim_io_flush(microswim_t* ms);
+size_t microswim_io_receive(
+    microswim_t* ms, uint64_t now, microswim_io_admit_t admit, void* context,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t));
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_IO_H
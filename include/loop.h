@@ -0,0 +1,103 @@
+#ifndef MICROSWIM_LOOP_H
+#define MICROSWIM_LOOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "io.h"
+#include "microswim.h"
+#ifndef RIOT_OS
+#include <poll.h>
+#endif
+
+#ifndef RIOT_OS
+
+// NOTE: The number of application file descriptors a loop can watch besides its instances.
+#ifndef LOOP_WATCHES
+#define LOOP_WATCHES 8
+#endif
+
+typedef struct microswim_loop microswim_loop_t;
+
+/**
+ * @brief Called when a watched file descriptor is ready, `events` being poll(2) flags.
+ */
+typedef void (*microswim_loop_callback_t)(
+    microswim_loop_t* loop, int fd, short events, void* context);
+
+/**
+ * @brief Host callbacks of the loop, any of which may be NULL. They are called for every
+ * instance the loop drives.
+ */
+typedef struct {
+    void (*round)(microswim_t* ms, void* context); // NOTE: Before a protocol period starts
+    void (*idle)(microswim_t* ms, void* context);  // NOTE: After the instance has done its work
+    microswim_io_admit_t admit;                    // NOTE: Drops the datagrams it refuses
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t);
+    void* context;
+} microswim_loop_hooks_t;
+
+typedef struct {
+    int fd;
+    short events;
+    microswim_loop_callback_t callback;
+    void* context;
+} microswim_loop_watch_t;
+
+typedef struct {
+    microswim_t* ms;
+    uint64_t deadline; // NOTE: Next deadline of the instance, as of the last time it ran
+    size_t position;   // NOTE: Position in `heap`
+} microswim_loop_instance_t;
+
+/**
+ * @brief Single-threaded event loop driving one or many instances.
+ *
+ * On Linux, the instances' sockets, the watched file descriptors and a timerfd armed for the
+ * earliest deadline of any instance share one epoll set, a socket being replaced by its
+ * io_uring if it has one. Elsewhere the loop falls back to poll(2). Only the instances whose
+ * deadline is due or whose socket is readable run, so a loop can drive thousands of them.
+ * The instances share nothing but the loop's buffers of the batched I/O, which they only use
+ * while they run, so a host can spread them over a loop per thread.
+ */
+struct microswim_loop {
+    microswim_t* ms; // NOTE: Instance the loop was set up with, if any
+    microswim_loop_hooks_t hooks;
+    microswim_loop_watch_t watches[LOOP_WATCHES];
+    size_t watch_count;
+    microswim_arena_t arena;              // NOTE: Backs the tables of the instances
+    microswim_io_t* io;                   // NOTE: Lent to the instances without their own
+    microswim_loop_instance_t* instances; // NOTE: Position in `instances` is the epoll tag
+    size_t* heap; // NOTE: Binary min-heap of positions in `instances`, ordered by the deadline
+    size_t instance_count;
+    size_t instance_capacity;
+    size_t heap_capacity;
+#ifndef __linux__
+    struct pollfd* fds;
+    size_t fd_capacity;
+#endif
+    int epoll;         // NOTE: -1 where the loop falls back to poll(2)
+    int timer;         // NOTE: -1 where the loop falls back to poll(2)
+    uint64_t deadline; // NOTE: Deadline the timer is armed for, 0 when it is disarmed
+    bool running;
+};
+
+bool microswim_loop_init(microswim_loop_t* loop, microswim_t* ms, const microswim_loop_hooks_t* hooks);
+void microswim_loop_deinit(microswim_loop_t* loop);
+bool microswim_loop_add(microswim_loop_t* loop, microswim_t* ms);
+bool microswim_loop_remove(microswim_loop_t* loop, microswim_t* ms);
+bool microswim_loop_watch(
+    microswim_loop_t* loop, int fd, short events, microswim_loop_callback_t callback, void* context);
+bool microswim_loop_unwatch(microswim_loop_t* loop, int fd);
+void microswim_loop_run_once(microswim_loop_t* loop);
+void microswim_loop_run(microswim_loop_t* loop);
+void microswim_loop_stop(microswim_loop_t* loop);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_LOOP_H
@@ -9,21 +9,26 @@ extern "C" {
 
 size_t microswim_member_address_compare(microswim_member_t* a, microswim_member_t* b);
 
+bool microswim_members_reserve(microswim_t* ms, size_t count);
+bool microswim_confirmed_reserve(microswim_t* ms, size_t count);
+
 microswim_member_t* microswim_member_retrieve(microswim_t* ms);
-microswim_member_t* microswim_member_add(microswim_t* ms, microswim_member_t member);
+microswim_member_t* microswim_member_add(microswim_t* ms, microswim_member_t member, uint64_t now);
 microswim_member_t* microswim_member_find(microswim_t* ms, microswim_member_t* member);
 microswim_member_t* microswim_member_remove(microswim_t* ms, microswim_member_t* member);
 microswim_member_t* microswim_member_move(microswim_t* ms, microswim_member_t* member);
 
-void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_member_t* nw);
+void microswim_member_update(
+    microswim_t* ms, microswim_member_t* ex, microswim_member_t* nw, uint64_t now);
 
-void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member);
-void microswim_member_mark_suspect(microswim_t* ms, microswim_member_t* member);
+void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member, uint64_t now);
+void microswim_member_mark_suspect(microswim_t* ms, microswim_member_t* member, uint64_t now);
 void microswim_member_mark_confirmed(microswim_t* ms, microswim_member_t* member);
 
-void microswim_members_shift(microswim_t* ms, size_t index);
-void microswim_members_check(microswim_t* ms, microswim_member_t* member);
+void microswim_members_check(
+    microswim_t* ms, const microswim_update_record_t* record, uint64_t now);
 void microswim_members_check_suspects(microswim_t* ms);
+void microswim_member_expire(microswim_t* ms, size_t slot);
 
 microswim_member_t* microswim_member_confirmed_find(microswim_t* ms, microswim_member_t* member);
 microswim_member_t* microswim_member_confirmed_add(microswim_t* ms, microswim_member_t member);
@@ -7,16 +7,34 @@ extern "C" {
 
 #include "microswim.h"
 
+// NOTE: The receivers keep one byte of BUFFER_SIZE for the terminating null byte.
+#define MESSAGE_BUDGET (BUFFER_SIZE - 1)
+
 void microswim_message_construct(
-    microswim_t* ms, microswim_message_t* message, microswim_message_type_t type,
-    microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE], size_t update_count);
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    microswim_message_type_t type, size_t budget);
+void microswim_message_pack(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message, size_t budget);
 
 void microswim_status_message_construct(
     microswim_t* ms, microswim_message_t* message, microswim_message_type_t type, microswim_member_t* member);
+void microswim_message_extract_members(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_message_view_t* view,
+    const microswim_update_record_t* sender, uint64_t now);
+void microswim_message_extract_records(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* sender,
+    const microswim_update_record_t* updates, size_t count, uint64_t now);
+bool microswim_message_delta_decode(microswim_t* ms, microswim_delta_t* delta);
+void microswim_message_delta_handle(
+    microswim_t* ms, microswim_delta_t* delta, uint64_t now,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t));
 void microswim_message_handle(
-    microswim_t* ms, unsigned char* buffer, ssize_t len,
+    microswim_t* ms, unsigned char* buffer, ssize_t len, uint64_t now,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t));
+void microswim_message_batch_handle(
+    microswim_t* ms, microswim_datagram_t* datagrams, size_t count, uint64_t now,
     void (*event_handler)(microswim_t*, unsigned char*, ssize_t));
-void microswim_message_send(microswim_t* ms, microswim_member_t* member, const char* buffer, size_t length);
+void microswim_message_send(microswim_t* ms, microswim_member_t* member, microswim_message_t* message);
 void microswim_ping_message_send(microswim_t* ms, microswim_member_t* member);
 
 #ifdef __cplusplus
@@ -17,6 +17,7 @@ extern "C" {
 #endif
 
 #include "constants.h"
+#include "id.h"
 
 #ifdef CUSTOM_CONFIGURATION
 #include "configuration.h"
@@ -24,6 +25,68 @@ extern "C" {
 #include "microswim_configuration.h"
 #endif
 
+// NOTE: The tables start with room for INITIAL_MEMBERS and grow geometrically
+// up to the maximums supplied to `microswim_init`.
+#ifndef INITIAL_MEMBERS
+#define INITIAL_MEMBERS 8
+#endif
+
+// NOTE: Every update is piggybacked RETRANSMIT_MULTIPLIER * ceil(log2(n + 1)) times,
+// n being the number of members, before it is retired.
+#ifndef RETRANSMIT_MULTIPLIER
+#define RETRANSMIT_MULTIPLIER 3
+#endif
+
+// NOTE: The number of codecs an instance can have registered at the same time.
+#define MAXIMUM_CODECS 3
+
+// NOTE: Room for the cached encoding of a member. Members whose encoding is longer, which
+// none of the codecs produces for IPv4 members, are encoded anew on every send.
+#ifndef FRAGMENT_SIZE
+#define FRAGMENT_SIZE 136
+#endif
+
+// NOTE: The number of members whose encoding as an update is cached, enough for the updates
+// of the few messages sent in a row which piggyback mostly the same ones.
+#ifndef FRAGMENT_CACHE
+#define FRAGMENT_CACHE (2 * MESSAGE_UPDATES)
+#endif
+
+// NOTE: Entries of the fragment cache of an instance with room for `members` members.
+#define FRAGMENT_ENTRIES(members) ((FRAGMENT_CACHE < (members)) ? FRAGMENT_CACHE : (members))
+
+// NOTE: The number of datagrams received or sent with one system call where the platform
+// supports it, and the number of outgoing messages held back until they are flushed.
+#ifndef IO_BATCH
+#define IO_BATCH 32
+#endif
+
+// NOTE: The number of receive buffers an io_uring provides to the kernel, a power of two.
+// Datagrams are received straight into them and handled in place.
+#ifndef IO_URING_BUFFERS
+#define IO_URING_BUFFERS 256
+#endif
+
+// NOTE: The number of decoded messages the receive workers of an instance can hand over to it
+// before they drop datagrams, a power of two.
+#ifndef SHARD_QUEUE
+#define SHARD_QUEUE 1024
+#endif
+
+// NOTE: The number of membership changes kept for the consumers which poll them, a power of two.
+#ifndef CHANGE_LOG_SIZE
+#define CHANGE_LOG_SIZE 256
+#endif
+
+#ifndef CHANGE_SUBSCRIBERS
+#define CHANGE_SUBSCRIBERS 4
+#endif
+
+#define HASH_INDEX_NONE SIZE_MAX
+#define SLAB_SLOT_NONE SIZE_MAX
+#define TIMER_NONE SIZE_MAX
+#define UPDATE_NONE SIZE_MAX
+
 typedef enum {
     ALIVE = 0,
     SUSPECT,
@@ -42,50 +105,218 @@ typedef enum {
     MALFORMED_MESSAGE
 } microswim_message_type_t;
 
+/**
+ * @brief Stable reference to a member.
+ *
+ * A handle names a slot of the member slab rather than a position in the member arrays,
+ * so it survives members being moved around. The generation is bumped whenever the slot
+ * is released, which turns any handle still referring to it stale. Generation 0 is never
+ * handed out, so a zeroed handle does not refer to any member.
+ */
+typedef struct {
+    uint32_t slot;
+    uint32_t generation;
+} microswim_handle_t;
+
+typedef enum {
+    SLAB_FREE = 0,
+    SLAB_MEMBERS,
+    SLAB_CONFIRMED,
+} microswim_slab_table_t;
+
+/**
+ * @brief What is disseminated about a member, without the local bookkeeping of
+ * `microswim_member_t`.
+ *
+ * The address is reduced to the IPv4 address and the port, which is all the codecs carry.
+ */
+typedef struct {
+    microswim_id_t uuid;
+    uint8_t address[4]; // NOTE: IPv4 address in network byte order
+    uint16_t port;
+    uint8_t status; // NOTE: A microswim_member_status_t
+    size_t incarnation;
+} microswim_update_record_t;
+
+/**
+ * @brief Cached encoding of a member in one of the codecs.
+ *
+ * The encoding only holds for as long as the member's record stays the one it was encoded
+ * from, which is stored alongside to tell.
+ */
+typedef struct {
+    microswim_update_record_t record;
+    uint8_t codec;   // NOTE: Position in `codecs` of the codec the data is encoded in
+    uint16_t length; // NOTE: 0 when nothing is cached
+    unsigned char data[FRAGMENT_SIZE];
+} microswim_fragment_t;
+
+/**
+ * @brief Entry of the fragment cache, which holds the encodings of the members recently
+ * piggybacked as updates.
+ */
 typedef struct {
-    uint8_t uuid[UUID_SIZE];
+    microswim_handle_t member; // NOTE: Zeroed while the entry is unused
+    uint32_t message;          // NOTE: Splice the entry was last part of
+    microswim_fragment_t fragment;
+} microswim_fragment_entry_t;
+
+typedef struct {
+    uint32_t generation;
+    microswim_slab_table_t table;
+    size_t position; // NOTE: Position in `members` or `confirmed`, or the next free slot
+    size_t order;    // NOTE: Position in `indices`, for the members in `members`
+    size_t timer;    // NOTE: Position of the suspicion timer in `timers` or TIMER_NONE
+    size_t update;   // NOTE: Position of the queued update in `updates` or UPDATE_NONE
+    uint8_t codec;   // NOTE: Position in `codecs` of the codec the member is sent messages in
+    uint16_t fragment; // NOTE: Entry of `fragments` last holding the member, if it still does
+} microswim_slot_t;
+
+typedef struct {
+    microswim_id_t uuid;
 #ifdef RIOT_OS
     sock_udp_ep_t addr;
 #else
     struct sockaddr_in addr;
 #endif
     microswim_member_status_t status;
+    microswim_handle_t handle; // NOTE: Only meaningful for members stored in the member arrays
     size_t incarnation;
     uint64_t timeout; // NOTE: Suspicion timeout
 } microswim_member_t;
 
 typedef struct {
-    microswim_member_t* member;
+    microswim_handle_t member;
     uint64_t ping_req_deadline;
     uint64_t suspect_deadline;
+    size_t timer; // NOTE: Position in `timers` or TIMER_NONE
     bool ping_req;
 } microswim_ping_t;
 
 typedef struct {
-    microswim_member_t* target;
-    microswim_member_t* source;
+    microswim_handle_t target;
+    microswim_handle_t source;
     uint64_t timeout;
+    size_t timer; // NOTE: Position in `timers` or TIMER_NONE
 } microswim_ping_req_t;
 
+typedef enum {
+    TIMER_PING = 0, // NOTE: Owned by a ping, fires at the ping-req and then at the suspect deadline
+    TIMER_PING_REQ, // NOTE: Owned by a ping-req
+    TIMER_SUSPICION // NOTE: Owned by the slot of a suspect member
+} microswim_timer_type_t;
+
+typedef struct {
+    uint64_t deadline;
+    microswim_timer_type_t type;
+    size_t owner; // NOTE: Position in `pings` or `ping_reqs`, or a slot in `slots`
+} microswim_timer_t;
+
 typedef struct {
-    microswim_member_t* member;
+    microswim_handle_t member;
     size_t count;
 } microswim_update_t;
 
+// NOTE: The most updates a datagram can hold, the budget of the instance decides how many are
+// sent. MAXIMUM_UPDATES only sizes the update queue.
+#define MESSAGE_UPDATES (BUFFER_SIZE / UPDATE_SIZE_MINIMUM)
+
+// NOTE: Slots refer to their entry of the fragment cache with 16 bits.
+#if FRAGMENT_CACHE > UINT16_MAX
+#error "FRAGMENT_CACHE must not exceed UINT16_MAX"
+#endif
+
 typedef struct {
     microswim_message_type_t type;
-    uint8_t uuid[UUID_SIZE];
-#ifdef RIOT_OS
-    sock_udp_ep_t addr;
-#else
-    struct sockaddr_in addr;
-#endif
-    microswim_member_status_t status;
-    size_t incarnation;
-    microswim_member_t mu[MAXIMUM_UPDATES];
+    microswim_update_record_t sender;
+    microswim_update_record_t mu[MESSAGE_UPDATES];
     size_t update_count;
 } microswim_message_t;
 
+/**
+ * @brief A received message left encoded in the receive buffer.
+ *
+ * Only the type and the offsets of the sender and of the first update are recorded when the
+ * message is indexed. The members are decoded one at a time on access, straight out of the
+ * buffer, which therefore has to outlive the view. An update may turn out to be malformed only
+ * once it is decoded.
+ */
+typedef struct {
+    const unsigned char* buffer;
+    size_t length;
+    microswim_message_type_t type;
+    size_t sender;  // NOTE: Offset of the sender's fields
+    size_t updates; // NOTE: Offset of the first update, updates follow one another
+    size_t update_count;
+} microswim_message_view_t;
+
+/**
+ * @brief A received datagram, followed by a terminating null byte past its `length` bytes.
+ */
+typedef struct {
+    unsigned char* buffer;
+    ssize_t length;
+} microswim_datagram_t;
+
+/**
+ * @brief Encoded glue which turns the fragments of a sender and its updates into a message.
+ */
+typedef struct {
+    unsigned char head[FRAME_SIZE];   // NOTE: Precedes the sender
+    unsigned char middle[FRAME_SIZE]; // NOTE: Sits between the sender and the updates
+    size_t head_length;
+    size_t middle_length;
+} microswim_frame_t;
+
+/**
+ * @brief Wire format of the messages.
+ *
+ * `detect` recognises the format from the first bytes of a datagram, the remaining
+ * functions are those of the codec's encoder and decoder. `view` indexes a message without
+ * decoding its members, which `member` then decodes one at a time, advancing `position` past
+ * the member it decodes. A message is the frame's head,
+ * the sender's fragment, the frame's middle and the updates' fragments delimited by
+ * `separator`, followed by `tail`.
+ */
+typedef struct {
+    const char* name;
+    bool (*detect)(const unsigned char* buffer, size_t len);
+    microswim_message_type_t (*decode_type)(unsigned char* buffer, ssize_t len);
+    bool (*decode)(microswim_message_t* message, const char* buffer, ssize_t len);
+    bool (*view)(microswim_message_view_t* view, const unsigned char* buffer, size_t len);
+    bool (*member)(
+        const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record);
+    size_t (*encode)(microswim_message_t* message, unsigned char* buffer, size_t size);
+    size_t (*fragment)(
+        const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size);
+    void (*frame)(microswim_message_t* message, microswim_frame_t* frame);
+    const char* separator;
+    const char* tail;
+} microswim_codec_t;
+
+/**
+ * @brief A received message decoded away from the instance, for the thread which owns the
+ * instance to apply.
+ *
+ * The datagram is kept alongside for the admission filter and the event handler. The updates
+ * following a malformed one are dropped.
+ */
+typedef struct {
+    const microswim_codec_t* codec;
+    microswim_message_type_t type;
+    microswim_update_record_t sender;
+    microswim_update_record_t updates[MESSAGE_UPDATES];
+    size_t update_count;
+    ssize_t length;
+    unsigned char buffer[BUFFER_SIZE];
+} microswim_delta_t;
+
+typedef struct {
+    microswim_id_t uuid;
+    size_t slot; // NOTE: Slot in `slots` or HASH_INDEX_NONE
+    size_t ping; // NOTE: Position in `pings` or HASH_INDEX_NONE
+} microswim_hash_entry_t;
+
 typedef size_t (*microswim_event_encoder_t)(void* output, void* input, size_t size);
 typedef void (*microswim_event_decoder_t)(void* output, void* input, size_t size);
 typedef void (*microswim_event_handler_t)(void* ms, void* buffer, size_t length);
@@ -103,35 +334,152 @@ typedef struct {
     void* payload;
 } microswim_event_message_t;
 
+/**
+ * @brief Runtime capacities of the membership tables.
+ *
+ * Every table starts with room for `initial_members` entries and grows geometrically
+ * up to its maximum. If `memory` is supplied, the tables are carved out of it instead
+ * of being allocated from the heap. A table carved out of the buffer takes the room for its
+ * maximum the first time it is needed and never moves, so `memory_size` has to be at least
+ * MICROSWIM_MEMORY_SIZE of the maximums, and `initial_members` does not matter.
+ *
+ * `message_budget` is the most bytes a message may take, and decides how many updates are
+ * piggybacked on it. It is bounded by `BUFFER_SIZE - 1`, so a budget as large as the MTU
+ * takes a BUFFER_SIZE of one more byte than the payload of a datagram (1472 bytes over IPv4
+ * on Ethernet).
+ */
+typedef struct {
+    size_t initial_members;
+    size_t maximum_members; // NOTE: Applies to the member and the confirmed member tables
+    size_t maximum_updates;
+    size_t maximum_pings; // NOTE: Applies to the ping and the ping-req tables
+    void* memory;       // NOTE: Aligned to ARENA_ALIGNMENT, or NULL to use the heap
+    size_t memory_size; // NOTE: See MICROSWIM_MEMORY_SIZE
+    const microswim_codec_t* codec; // NOTE: Default codec, the first one compiled in if NULL
+    size_t message_budget;          // NOTE: BUFFER_SIZE - 1 if 0 or larger
+} microswim_config_t;
+
+#define MICROSWIM_CONFIG_DEFAULT                                                            \
+    { INITIAL_MEMBERS, MAXIMUM_MEMBERS, MAXIMUM_UPDATES, MAXIMUM_PINGS, NULL, 0, NULL, \
+      BUFFER_SIZE - 1 }
+
+// NOTE: Alignment of every block carved out of a memory buffer.
+#define ARENA_ALIGNMENT 16
+
+#define MICROSWIM_MEMORY_TABLE(element_size, count) \
+    (((element_size) * (count) + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/**
+ * @brief The size of a memory buffer which holds the tables of an instance with the given
+ * maximums, as `memory_size` of its configuration.
+ *
+ * It mirrors the maximums the tables grow to. Snapshots, the change log and buffers of the
+ * batched I/O reserved for the instance take more if they are enabled.
+ */
+#define MICROSWIM_MEMORY_SIZE(members, updates, pings)                                      \
+    (MICROSWIM_MEMORY_TABLE(sizeof(size_t), members) +                                     \
+     2 * MICROSWIM_MEMORY_TABLE(sizeof(microswim_member_t), members) +                     \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_hash_entry_t), 4 * (members)) +               \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_slot_t), 2 * (members)) +                     \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_update_t), updates) +                         \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_ping_t), pings) +                             \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_ping_req_t), pings) +                         \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_timer_t), 2 * (pings) + (members)) +          \
+     MICROSWIM_MEMORY_TABLE(sizeof(microswim_fragment_entry_t), FRAGMENT_ENTRIES(members)))
+
+typedef struct {
+    uint8_t* base; // NOTE: NULL when the tables are allocated from the heap
+    size_t size;
+    size_t used;
+    size_t last; // NOTE: Offset of the most recent allocation
+} microswim_arena_t;
+
+#ifndef RIOT_OS
+typedef struct microswim_io microswim_io_t;
+
+/**
+ * @brief Carries an encoded message to `addr` in place of the socket, for hosts which deliver
+ * the messages themselves, such as a simulated network.
+ */
+typedef void (*microswim_transport_t)(
+    void* ms, const struct sockaddr_in* addr, const unsigned char* buffer, size_t length,
+    void* context);
+#endif
+
+typedef struct microswim_snapshots microswim_snapshots_t;
+typedef struct microswim_changes microswim_changes_t;
+
 typedef struct {
 #ifdef RIOT_OS
     sock_udp_t socket;
 #else
     int socket;
+    microswim_io_t* io; // NOTE: Buffers of the batched socket I/O, NULL if unavailable
+    microswim_transport_t transport; // NOTE: Sends in place of `socket` unless NULL
+    void* transport_context;
 #endif
     microswim_member_t self;
-    microswim_member_t members[MAXIMUM_MEMBERS];
-    microswim_member_t confirmed[MAXIMUM_MEMBERS];
-    microswim_update_t updates[MAXIMUM_UPDATES];
-    microswim_ping_t pings[MAXIMUM_MEMBERS];
-    microswim_ping_req_t ping_reqs[MAXIMUM_MEMBERS];
+    microswim_fragment_t fragment; // NOTE: Encoding of the sender of the last message sent
+    microswim_fragment_entry_t* fragments; // NOTE: Encodings of members as updates
+    microswim_member_t* members;
+    microswim_member_t* confirmed;
+    microswim_update_t* updates; // NOTE: Binary min-heap ordered by the transmit count
+    microswim_ping_t* pings;
+    microswim_ping_req_t* ping_reqs;
     microswim_event_t events[MAXIMUM_EVENTS];
-    size_t indices[MAXIMUM_MEMBERS];
+    const microswim_codec_t* codecs[MAXIMUM_CODECS]; // NOTE: The first one is the default
+    microswim_hash_entry_t* hash;
+    microswim_slot_t* slots;
+    microswim_timer_t* timers; // NOTE: Binary min-heap ordered by the deadline
+    size_t* indices;
     size_t member_count;
     size_t confirmed_count;
     size_t update_count;
     size_t ping_count;
     size_t ping_req_count;
     size_t event_count;
+    size_t codec_count;
+    size_t timer_count;
+    size_t anonymous_count; // NOTE: Members which are not indexed because their UUID is not known yet
     size_t round_robin_index;
+    uint64_t rng[4]; // NOTE: State of the random number generator, never all zero
+    uint64_t revision; // NOTE: Bumped whenever a member is added, removed or changes its status
+    microswim_snapshots_t* snapshots; // NOTE: NULL unless the membership is published to readers
+    microswim_changes_t* changes;     // NOTE: NULL unless membership changes are logged
+    uint64_t protocol_deadline; // NOTE: Start of the next protocol period
+    size_t slot_count; // NOTE: Slots handed out so far, including the released ones
+    size_t fragment_hand;     // NOTE: Next entry of `fragments` considered for reuse
+    uint32_t fragment_splice; // NOTE: Bumped for every message spliced
+    size_t free_slot;  // NOTE: Head of the list of released slots or SLAB_SLOT_NONE
+    size_t member_capacity;
+    size_t confirmed_capacity;
+    size_t update_capacity;
+    size_t ping_capacity;
+    size_t ping_req_capacity;
+    size_t hash_capacity;
+    size_t slot_capacity;
+    size_t timer_capacity;
+    size_t index_capacity;
+    size_t fragment_capacity;
+    microswim_config_t config;
+    microswim_arena_t arena;
 } microswim_t;
 
+bool microswim_init(microswim_t* ms, const microswim_config_t* config);
+void microswim_deinit(microswim_t* ms);
+
 void microswim_socket_setup(microswim_t* ms, char* addr, int port);
+#ifndef RIOT_OS
+void microswim_transport_setup(
+    microswim_t* ms, microswim_transport_t transport, void* context, struct sockaddr_in* addr);
+#endif
+
+void microswim_tick(microswim_t* ms, uint64_t now);
+uint64_t microswim_next_deadline(microswim_t* ms);
 
 void microswim_index_add(microswim_t* ms);
-void microswim_index_remove(microswim_t* ms);
+void microswim_index_remove(microswim_t* ms, size_t order);
 void microswim_indices_shuffle(microswim_t* ms);
-size_t* microswim_indices_shift(microswim_t* ms, size_t index);
 
 #ifdef __cplusplus
 }
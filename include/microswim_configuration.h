@@ -5,7 +5,6 @@
 #define PING_REQ_PERIOD 2.5
 #define SUSPECT_TIMEOUT 60
 
-#define MAXIMUM_MEMBERS_IN_AN_UPDATE 3
 #define FAILURE_DETECTION_GROUP 3
 #define GOSSIP_FANOUT 1
 
@@ -9,7 +9,9 @@
 #define INFO 3
 #define DEBUG 4
 
+#ifndef MICROSWIM_LOG_LEVEL
 #define MICROSWIM_LOG_LEVEL DEBUG
+#endif
 
 #define MICROSWIM_LOG(level, format, ...)                         \
     do {                                                          \
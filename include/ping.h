@@ -7,10 +7,12 @@ extern "C" {
 
 #include "microswim.h"
 
-microswim_ping_t* microswim_ping_add(microswim_t* ms, microswim_member_t* member);
+microswim_ping_t* microswim_ping_add(microswim_t* ms, microswim_member_t* member, uint64_t now);
 microswim_ping_t* microswim_ping_find(microswim_t* ms, microswim_member_t* member);
 
+void microswim_ping_round(microswim_t* ms, uint64_t now);
 void microswim_pings_check(microswim_t* ms);
+void microswim_ping_expire(microswim_t* ms, microswim_ping_t* ping, uint64_t now);
 void microswim_ping_remove(microswim_t* ms, microswim_ping_t* ping);
 
 #ifdef __cplusplus
@@ -9,8 +9,11 @@ extern "C" {
 
 void microswim_ping_reqs_check(microswim_t* ms);
 void microswim_ping_req_remove(microswim_t* ms, microswim_ping_req_t* ping);
-void microswim_ping_req_message_handle(microswim_t* ms, microswim_message_t* message);
-void microswim_ping_req_add(microswim_t* ms, microswim_member_t* source, microswim_member_t* target);
+void microswim_ping_req_message_handle(
+    microswim_t* ms, const microswim_update_record_t* sender,
+    const microswim_update_record_t* requested, uint64_t now);
+void microswim_ping_req_add(
+    microswim_t* ms, microswim_member_t* source, microswim_member_t* target, uint64_t now);
 microswim_ping_req_t*
     microswim_ping_req_find(microswim_t* ms, microswim_member_t* source, microswim_member_t* target);
 
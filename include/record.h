@@ -0,0 +1,29 @@
+#ifndef MICROSWIM_RECORD_H
+#define MICROSWIM_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+/**
+ * @brief Compares two records field by field, leaving their padding out.
+ */
+static inline bool
+    microswim_record_equal(const microswim_update_record_t* a, const microswim_update_record_t* b) {
+    return a->port == b->port && a->status == b->status && a->incarnation == b->incarnation &&
+           memcmp(a->address, b->address, sizeof(a->address)) == 0 &&
+           microswim_id_equal(&a->uuid, &b->uuid);
+}
+
+void microswim_record_from_member(microswim_update_record_t* record, const microswim_member_t* member);
+void microswim_record_to_member(const microswim_update_record_t* record, microswim_member_t* member);
+size_t microswim_record_uri_format(const microswim_update_record_t* record, char* buffer);
+bool microswim_record_uri_parse(microswim_update_record_t* record, const char* text, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_RECORD_H
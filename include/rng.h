@@ -0,0 +1,18 @@
+#ifndef MICROSWIM_RNG_H
+#define MICROSWIM_RNG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+void microswim_rng_seed(microswim_t* ms, uint64_t seed);
+uint64_t microswim_rng_next(microswim_t* ms);
+size_t microswim_rng_bounded(microswim_t* ms, size_t bound);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_RNG_H
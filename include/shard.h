@@ -0,0 +1,35 @@
+#ifndef MICROSWIM_SHARD_H
+#define MICROSWIM_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+#ifndef RIOT_OS
+
+/**
+ * @brief Receive workers of an instance, each on a thread and a `SO_REUSEPORT` socket of its
+ * own bound to the instance's address.
+ *
+ * The workers decode the datagrams the kernel spreads over their sockets, and hand the decoded
+ * messages over a lock-free queue to the thread which owns the instance, the only one which
+ * applies them.
+ */
+typedef struct microswim_shards microswim_shards_t;
+
+microswim_shards_t* microswim_shards_create(microswim_arena_t* arena, microswim_t* ms, size_t count);
+void microswim_shards_destroy(microswim_arena_t* arena, microswim_shards_t* shards);
+int microswim_shards_descriptor(const microswim_shards_t* shards);
+size_t microswim_shards_dropped(const microswim_shards_t* shards);
+size_t microswim_shards_receive(microswim_shards_t* shards, microswim_delta_t** deltas, size_t count);
+void microswim_shards_recycle(microswim_shards_t* shards);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_SHARD_H
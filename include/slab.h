@@ -0,0 +1,26 @@
+#ifndef MICROSWIM_SLAB_H
+#define MICROSWIM_SLAB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+static inline bool microswim_handle_equal(microswim_handle_t a, microswim_handle_t b) {
+    return a.slot == b.slot && a.generation == b.generation;
+}
+
+microswim_handle_t
+    microswim_slab_acquire(microswim_t* ms, microswim_slab_table_t table, size_t position);
+void microswim_slab_relocate(
+    microswim_t* ms, microswim_handle_t handle, microswim_slab_table_t table, size_t position);
+void microswim_slab_release(microswim_t* ms, microswim_handle_t handle);
+microswim_slot_t* microswim_slab_slot(microswim_t* ms, microswim_handle_t handle);
+microswim_member_t* microswim_slab_resolve(microswim_t* ms, microswim_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_SLAB_H
@@ -0,0 +1,33 @@
+#ifndef MICROSWIM_SNAPSHOT_H
+#define MICROSWIM_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+/**
+ * @brief An immutable copy of the membership, as the instance saw it at `revision`.
+ *
+ * The records of the members come first, ALIVE or SUSPECT, followed by those of the confirmed
+ * members. Members whose UUID is not known yet are left out.
+ */
+typedef struct {
+    uint64_t revision;
+    const microswim_update_record_t* records;
+    size_t member_count;
+    size_t confirmed_count;
+} microswim_snapshot_t;
+
+bool microswim_snapshots_enable(microswim_t* ms);
+void microswim_snapshots_disable(microswim_t* ms);
+bool microswim_snapshot_publish(microswim_t* ms);
+const microswim_snapshot_t* microswim_snapshot_acquire(microswim_t* ms);
+void microswim_snapshot_release(microswim_t* ms, const microswim_snapshot_t* snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_SNAPSHOT_H
@@ -0,0 +1,20 @@
+#ifndef MICROSWIM_TIMER_H
+#define MICROSWIM_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+bool microswim_timer_schedule(
+    microswim_t* ms, size_t timer, microswim_timer_type_t type, size_t owner, uint64_t deadline);
+void microswim_timer_cancel(microswim_t* ms, size_t timer);
+uint64_t microswim_timers_next(microswim_t* ms);
+void microswim_timers_expire(microswim_t* ms, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_TIMER_H
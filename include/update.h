@@ -12,7 +12,9 @@ microswim_update_t* microswim_update_find(microswim_t* ms, microswim_member_t* m
 microswim_update_t* microswim_update_update(microswim_t* ms, microswim_update_t* update);
 microswim_update_t* microswim_update_remove(microswim_t* ms, microswim_update_t* update);
 
-size_t microswim_updates_retrieve(microswim_t* ms, microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE]);
+bool microswim_updates_take(microswim_t* ms, microswim_update_t* update);
+void microswim_updates_restore(
+    microswim_t* ms, microswim_update_t* updates, size_t count, size_t sent);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,36 @@
+#ifndef MICROSWIM_URING_H
+#define MICROSWIM_URING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "microswim.h"
+
+#ifndef RIOT_OS
+
+/**
+ * @brief An io_uring the batched I/O of an instance runs on.
+ *
+ * Datagrams are received by a multishot `recvmsg` into buffers provided to the kernel, and
+ * handed out in place until they are recycled. Messages are sent by `sendmsg` submissions.
+ */
+typedef struct microswim_uring microswim_uring_t;
+
+microswim_uring_t* microswim_uring_create(microswim_arena_t* arena, int socket);
+void microswim_uring_destroy(microswim_arena_t* arena, microswim_uring_t* uring);
+int microswim_uring_descriptor(const microswim_uring_t* uring);
+size_t microswim_uring_system_calls(const microswim_uring_t* uring);
+bool microswim_uring_send(microswim_uring_t* uring, struct msghdr* header);
+size_t microswim_uring_submit(microswim_uring_t* uring);
+size_t microswim_uring_receive(
+    microswim_uring_t* uring, microswim_datagram_t* datagrams, size_t count);
+void microswim_uring_recycle(microswim_uring_t* uring);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MICROSWIM_URING_H
@@ -12,9 +12,11 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 
+#include "id.h"
+
 uint64_t microswim_milliseconds(void);
 size_t microswim_random(void);
-void microswim_uuid_generate(char* uuid);
+void microswim_uuid_generate(microswim_id_t* uuid);
 #ifdef RIOT_OS
 void microswim_sockaddr_to_uri(sock_udp_ep_t* addr, char* buffer, size_t buffer_size);
 #else
@@ -120,7 +120,7 @@ def stop_containers_fast(containers, max_workers=8, remove_volumes=False, force=
                 print(f"    [!] Failed to stop/remove {c.id[:12]}: {e}")
 
 
-def update_header_file(header_path, members, members_in_update, fanout):
+def update_header_file(header_path, members, buffer_size, fanout):
     print(f"[+] Updating header: {header_path}")
     with open(header_path, "r") as f:
         content = f.read()
@@ -131,8 +131,8 @@ def update_header_file(header_path, members, members_in_update, fanout):
         content,
     )
     content = re.sub(
-        r"#define\s+MAXIMUM_MEMBERS_IN_AN_UPDATE\s+\d+",
-        f"#define MAXIMUM_MEMBERS_IN_AN_UPDATE {members_in_update}",
+        r"#define\s+BUFFER_SIZE\s+\d+",
+        f"#define BUFFER_SIZE {buffer_size}",
         content,
     )
     content = re.sub(
@@ -143,7 +143,7 @@ def update_header_file(header_path, members, members_in_update, fanout):
         f.write(content)
 
     print(
-        f"    -> Set MAXIMUM_MEMBERS={members}, MAXIMUM_MEMBERS_IN_AN_UPDATE={members_in_update}, GOSSIP_FANOUT={fanout}"
+        f"    -> Set MAXIMUM_MEMBERS={members}, BUFFER_SIZE={buffer_size}, GOSSIP_FANOUT={fanout}"
     )
 
 
@@ -202,21 +202,21 @@ if __name__ == "__main__":
     redis_client = redis.Redis(host="127.0.0.1", port=6379, decode_responses=True)
 
     members_list = [8, 16, 32, 64, 128]
-    update_list = [2, 3, 4]
+    buffer_list = [256, 512, 1024]
     fanout_list = [2, 3, 4]
 
     try:
         for iteration in range(1, 11):
-            for members, members_in_update, fanout in product(
-                members_list, update_list, fanout_list
+            for members, buffer_size, fanout in product(
+                members_list, buffer_list, fanout_list
             ):
                 print("=" * 70)
                 print(
-                    f"[+] Running experiment: members={members}, updates={members_in_update}, fanout={fanout}, iteration={iteration}"
+                    f"[+] Running experiment: members={members}, buffer={buffer_size}, fanout={fanout}, iteration={iteration}"
                 )
                 print("=" * 70)
 
-                update_header_file(args.header, members, members_in_update, fanout)
+                update_header_file(args.header, members, buffer_size, fanout)
                 build_inside_container(builder_container)
                 containers = spawn_containers_parallel(client, 8000, members)
 
@@ -224,7 +224,7 @@ if __name__ == "__main__":
                     dump_redis_results_fast(
                         redis_client,
                         members,
-                        f"results/results_{members}_{members_in_update}_{fanout}_{iteration}.csv",
+                        f"results/results_{members}_{buffer_size}_{fanout}_{iteration}.csv",
                     )
                 else:
                     print("[!] Not all containers wrote to Redis in time.")
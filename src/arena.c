@@ -0,0 +1,113 @@
+#include "arena.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t microswim_arena_align(size_t size) {
+    return (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Resizes the block to `new_size` bytes, preserving its first `size` bytes.
+ *
+ * Without a backing buffer, the block lives on the heap. Otherwise the most recent
+ * allocation is extended in place, while any other block is copied to the end of the
+ * buffer. The space of a block left behind is not reused, which is why
+ * `microswim_arena_grow` sizes the tables of a buffer for their maximum straight away.
+ *
+ * @return A pointer to the resized block, or NULL if there is not enough memory.
+ * The original block is left untouched on failure.
+ */
+void* microswim_arena_reallocate(
+    microswim_arena_t* arena, void* block, size_t size, size_t new_size) {
+    if (arena->base == NULL) {
+        return realloc(block, new_size);
+    }
+
+    size_t offset = arena->used;
+    if (block != NULL && (uint8_t*)block == arena->base + arena->last) {
+        offset = arena->last;
+    }
+
+    if (offset > arena->size || new_size > arena->size - offset) {
+        return NULL;
+    }
+
+    if (offset != arena->last || block == NULL) {
+        if (block != NULL) {
+            memcpy(arena->base + offset, block, size);
+        }
+        arena->last = offset;
+    }
+
+    arena->used = microswim_arena_align(offset + new_size);
+    if (arena->used > arena->size) {
+        arena->used = arena->size;
+    }
+
+    return arena->base + offset;
+}
+
+/**
+ * @brief Releases the block.
+ *
+ * With a backing buffer, only the most recent allocation gives its space back.
+ */
+void microswim_arena_release(microswim_arena_t* arena, void* block) {
+    if (block == NULL) {
+        return;
+    }
+
+    if (arena->base == NULL) {
+        free(block);
+        return;
+    }
+
+    if ((uint8_t*)block == arena->base + arena->last) {
+        arena->used = arena->last;
+    }
+}
+
+/**
+ * @brief Grows the table so that it can hold at least `count` elements.
+ *
+ * The capacity is doubled until it fits `count`, but never beyond `maximum`. With a backing
+ * buffer, the table takes its `maximum` right away, so that it never has to move.
+ * The newly added elements are zeroed.
+ *
+ * @return A pointer to the table, which may have moved, or NULL if the table
+ * cannot hold `count` elements. On failure, the table and its capacity are untouched.
+ */
+void* microswim_arena_grow(
+    microswim_arena_t* arena, void* table, size_t* capacity, size_t element_size, size_t count,
+    size_t maximum) {
+    if (count <= *capacity) {
+        return table;
+    }
+
+    if (count > maximum) {
+        return NULL;
+    }
+
+    size_t new_capacity = (*capacity == 0) ? count : *capacity;
+    if (arena->base != NULL) {
+        new_capacity = maximum;
+    }
+    while (new_capacity < count) {
+        new_capacity = (new_capacity > maximum / 2) ? maximum : new_capacity * 2;
+    }
+
+    void* new_table = microswim_arena_reallocate(
+        arena, table, *capacity * element_size, new_capacity * element_size);
+    if (new_table == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to grow a table to %zu elements\n", new_capacity);
+        return NULL;
+    }
+
+    size_t size = *capacity * element_size;
+    memset((uint8_t*)new_table + size, 0, new_capacity * element_size - size);
+    *capacity = new_capacity;
+
+    return new_table;
+}
@@ -0,0 +1,194 @@
+#include "change.h"
+#include "arena.h"
+#include "id.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "record.h"
+#include <string.h>
+
+typedef struct {
+    microswim_change_handler_t handler;
+    void* context;
+} microswim_change_subscriber_t;
+
+/**
+ * @brief The most recent membership changes of an instance, in a ring indexed by sequence.
+ *
+ * The change with sequence `s` lives at `log[s % CHANGE_LOG_SIZE]`, so the ring holds the
+ * changes from `sequence - CHANGE_LOG_SIZE + 1` up to `sequence`.
+ */
+struct microswim_changes {
+    microswim_change_t log[CHANGE_LOG_SIZE];
+    microswim_change_subscriber_t subscribers[CHANGE_SUBSCRIBERS];
+    size_t subscriber_count;
+    uint64_t sequence;   // NOTE: Sequence of the latest change, 0 before the first one
+    uint64_t dispatched; // NOTE: Sequence of the latest change handed to the subscribers
+};
+
+/**
+ * @brief Returns the sequence of the oldest change the ring still holds.
+ */
+static uint64_t microswim_changes_oldest(const microswim_changes_t* changes) {
+    return (changes->sequence < CHANGE_LOG_SIZE) ? 1 : changes->sequence - CHANGE_LOG_SIZE + 1;
+}
+
+/**
+ * @brief Copies the changes after `sequence` into `output`, as far as the ring still holds them.
+ *
+ * @return The number of changes copied.
+ */
+static size_t microswim_changes_copy(
+    const microswim_changes_t* changes, uint64_t sequence, microswim_change_t* output, size_t count) {
+    uint64_t first = sequence + 1;
+    uint64_t oldest = microswim_changes_oldest(changes);
+    if (first < oldest) {
+        first = oldest;
+    }
+
+    size_t copied = 0;
+    for (uint64_t s = first; s <= changes->sequence && copied < count; s++) {
+        output[copied++] = changes->log[s % CHANGE_LOG_SIZE];
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Starts logging the membership changes of the instance.
+ *
+ * Only the changes made from now on are logged, the consumers take the membership as it is
+ * from `ms->members` and `ms->confirmed`, or from a snapshot.
+ *
+ * @return true if the changes are logged, false if the log could not be allocated.
+ */
+bool microswim_changes_enable(microswim_t* ms) {
+    if (ms->changes != NULL) {
+        return true;
+    }
+
+    microswim_changes_t* changes =
+        microswim_arena_reallocate(&ms->arena, NULL, 0, sizeof(microswim_changes_t));
+    if (changes == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to allocate the membership change log\n");
+        return false;
+    }
+
+    memset(changes, 0, sizeof(*changes));
+    ms->changes = changes;
+
+    return true;
+}
+
+/**
+ * @brief Stops logging the membership changes and releases the log.
+ */
+void microswim_changes_disable(microswim_t* ms) {
+    microswim_arena_release(&ms->arena, ms->changes);
+    ms->changes = NULL;
+}
+
+/**
+ * @brief Registers a handler to which `microswim_changes_dispatch` hands the changes in batches.
+ *
+ * @return true if the handler is registered, false if changes are not logged or
+ * CHANGE_SUBSCRIBERS handlers are registered already.
+ */
+bool microswim_changes_subscribe(microswim_t* ms, microswim_change_handler_t handler, void* context) {
+    microswim_changes_t* changes = ms->changes;
+    if (changes == NULL || changes->subscriber_count == CHANGE_SUBSCRIBERS) {
+        MICROSWIM_LOG_ERROR("Unable to subscribe to the membership changes\n");
+        return false;
+    }
+
+    changes->subscribers[changes->subscriber_count].handler = handler;
+    changes->subscribers[changes->subscriber_count].context = context;
+    changes->subscriber_count++;
+
+    return true;
+}
+
+/**
+ * @brief Hands the changes logged since the previous dispatch to every subscriber.
+ *
+ * `microswim_loop` dispatches after each tick and each batch of datagrams, hosts driving the
+ * instance themselves call it whenever it suits them. A subscriber gets every change in at most
+ * two calls, one for each side of the point where the ring wraps around, unless more than
+ * CHANGE_LOG_SIZE changes were logged in between.
+ */
+void microswim_changes_dispatch(microswim_t* ms) {
+    microswim_changes_t* changes = ms->changes;
+    if (changes == NULL || changes->dispatched == changes->sequence) {
+        return;
+    }
+
+    uint64_t first = changes->dispatched + 1;
+    uint64_t oldest = microswim_changes_oldest(changes);
+    if (first < oldest) {
+        MICROSWIM_LOG_WARN(
+            "%llu membership changes were overwritten before they were dispatched\n",
+            (unsigned long long)(oldest - first));
+        first = oldest;
+    }
+
+    // NOTE: The subscribers may change the membership, and log more changes, while they run.
+    uint64_t last = changes->sequence;
+    changes->dispatched = last;
+
+    while (first <= last) {
+        size_t start = (size_t)(first % CHANGE_LOG_SIZE);
+        size_t count = CHANGE_LOG_SIZE - start;
+        if (count > last - first + 1) {
+            count = (size_t)(last - first + 1);
+        }
+
+        for (size_t i = 0; i < changes->subscriber_count; i++) {
+            changes->subscribers[i].handler(
+                ms, &changes->log[start], count, changes->subscribers[i].context);
+        }
+
+        first += count;
+    }
+}
+
+/**
+ * @brief Copies the changes logged after `*sequence` into `changes`, oldest first, and moves
+ * `*sequence` past the last one copied.
+ *
+ * A consumer starts with `*sequence` at 0. If the first change copied does not directly follow
+ * the previous `*sequence`, the ones in between were overwritten, and the consumer has to
+ * catch up from the membership itself.
+ *
+ * @return The number of changes copied, 0 if there are none or changes are not logged.
+ */
+size_t microswim_changes_read(
+    microswim_t* ms, uint64_t* sequence, microswim_change_t* changes, size_t count) {
+    if (ms->changes == NULL) {
+        return 0;
+    }
+
+    size_t copied = microswim_changes_copy(ms->changes, *sequence, changes, count);
+    if (copied > 0) {
+        *sequence = changes[copied - 1].sequence;
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Logs a change of the member.
+ *
+ * Members are only logged once their UUID is known, they join at that point.
+ */
+void microswim_change_append(
+    microswim_t* ms, microswim_change_type_t type, const microswim_member_t* member) {
+    microswim_changes_t* changes = ms->changes;
+    if (changes == NULL || microswim_id_is_nil(&member->uuid)) {
+        return;
+    }
+
+    uint64_t sequence = ++changes->sequence;
+    microswim_change_t* change = &changes->log[sequence % CHANGE_LOG_SIZE];
+    change->sequence = sequence;
+    change->type = type;
+    microswim_record_from_member(&change->record, member);
+}
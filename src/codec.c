@@ -0,0 +1,189 @@
+#include "codec.h"
+#include "constants.h"
+#include "decode.h"
+#include "encode.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "slab.h"
+
+#ifdef MICROSWIM_CBOR
+/**
+ * @brief Recognises a CBOR message by the head of its top-level map.
+ */
+static bool microswim_codec_cbor_detect(const unsigned char* buffer, size_t len) {
+    return len > 0 && (buffer[0] & 0xE0) == 0xA0;
+}
+
+const microswim_codec_t microswim_codec_cbor = {
+    "cbor",
+    microswim_codec_cbor_detect,
+    microswim_decode_cbor_message_type,
+    microswim_decode_cbor_message,
+    microswim_decode_cbor_view,
+    microswim_decode_cbor_member,
+    microswim_encode_cbor_message,
+    microswim_encode_cbor_fragment,
+    microswim_encode_cbor_frame,
+    "",
+    "",
+};
+#endif
+
+#ifdef MICROSWIM_JSON
+/**
+ * @brief Recognises a JSON message by the opening brace of its object.
+ */
+static bool microswim_codec_json_detect(const unsigned char* buffer, size_t len) {
+    size_t i = 0;
+    while (i < len &&
+           (buffer[i] == ' ' || buffer[i] == '\t' || buffer[i] == '\r' || buffer[i] == '\n')) {
+        i++;
+    }
+
+    return i < len && buffer[i] == '{';
+}
+
+const microswim_codec_t microswim_codec_json = {
+    "json",
+    microswim_codec_json_detect,
+    microswim_decode_json_message_type,
+    microswim_decode_json_message,
+    microswim_decode_json_view,
+    microswim_decode_json_member,
+    microswim_encode_json_message,
+    microswim_encode_json_fragment,
+    microswim_encode_json_frame,
+    ",",
+    "]}",
+};
+#endif
+
+#ifdef MICROSWIM_BINARY
+/**
+ * @brief Recognises a binary message by its version byte.
+ */
+static bool microswim_codec_binary_detect(const unsigned char* buffer, size_t len) {
+    return len > 0 && buffer[0] == BINARY_VERSION;
+}
+
+const microswim_codec_t microswim_codec_binary = {
+    "binary",
+    microswim_codec_binary_detect,
+    microswim_decode_binary_message_type,
+    microswim_decode_binary_message,
+    microswim_decode_binary_view,
+    microswim_decode_binary_member,
+    microswim_encode_binary_message,
+    microswim_encode_binary_fragment,
+    microswim_encode_binary_frame,
+    "",
+    "",
+};
+#endif
+
+/**
+ * @brief Adds the codec to the codecs the instance understands.
+ *
+ * The first codec registered is the default one, which members are sent messages in
+ * until they are known to speak another codec.
+ *
+ * @return true if the codec is registered, false if there is no room left for it.
+ */
+bool microswim_codec_register(microswim_t* ms, const microswim_codec_t* codec) {
+    for (size_t i = 0; i < ms->codec_count; i++) {
+        if (ms->codecs[i] == codec) {
+            return true;
+        }
+    }
+
+    if (ms->codec_count == MAXIMUM_CODECS) {
+        MICROSWIM_LOG_ERROR(
+            "Unable to register the %s codec, consider increasing MAXIMUM_CODECS", codec->name);
+        return false;
+    }
+
+    ms->codecs[ms->codec_count++] = codec;
+    return true;
+}
+
+/**
+ * @brief Registers the configured default codec, followed by every codec compiled in.
+ */
+bool microswim_codecs_register(microswim_t* ms) {
+    if (ms->config.codec != NULL && !microswim_codec_register(ms, ms->config.codec)) {
+        return false;
+    }
+
+#ifdef MICROSWIM_CBOR
+    if (!microswim_codec_register(ms, &microswim_codec_cbor)) {
+        return false;
+    }
+#endif
+#ifdef MICROSWIM_BINARY
+    if (!microswim_codec_register(ms, &microswim_codec_binary)) {
+        return false;
+    }
+#endif
+#ifdef MICROSWIM_JSON
+    if (!microswim_codec_register(ms, &microswim_codec_json)) {
+        return false;
+    }
+#endif
+
+    if (ms->codec_count == 0) {
+        MICROSWIM_LOG_ERROR("No codec is available, build with at least one of them");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Finds the registered codec the message is encoded in.
+ *
+ * @return The codec, or NULL if none of the registered codecs recognises the message.
+ */
+const microswim_codec_t* microswim_codec_detect(
+    microswim_t* ms, const unsigned char* buffer, size_t len) {
+    for (size_t i = 0; i < ms->codec_count; i++) {
+        if (ms->codecs[i]->detect(buffer, len)) {
+            return ms->codecs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the codec to send messages to the member in.
+ *
+ * Members outside of the member arrays, including a NULL member, get the default codec.
+ */
+const microswim_codec_t* microswim_codec_select(microswim_t* ms, microswim_member_t* member) {
+    microswim_slot_t* slot = (member != NULL) ? microswim_slab_slot(ms, member->handle) : NULL;
+    if (slot == NULL || slot->codec >= ms->codec_count) {
+        return ms->codecs[0];
+    }
+
+    return ms->codecs[slot->codec];
+}
+
+/**
+ * @brief Sends the member messages in the codec from now on.
+ *
+ * Codecs which are not registered are ignored.
+ */
+void microswim_codec_assign(
+    microswim_t* ms, microswim_member_t* member, const microswim_codec_t* codec) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < ms->codec_count; i++) {
+        if (ms->codecs[i] == codec) {
+            slot->codec = (uint8_t)i;
+            return;
+        }
+    }
+}
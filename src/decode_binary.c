@@ -0,0 +1,179 @@
+#ifdef MICROSWIM_BINARY
+
+#include "constants.h"
+#include "decode.h"
+#include "microswim.h"
+#include "microswim_log.h"
+
+/**
+ * @brief Reads an unsigned LEB128 varint.
+ *
+ * @return The length of the varint, or 0 if it is truncated or does not fit into 64 bits.
+ */
+static size_t microswim_decode_varint(const unsigned char* buffer, size_t length, uint64_t* value) {
+    *value = 0;
+    for (size_t i = 0; i < length && i < BINARY_VARINT_SIZE; i++) {
+        uint64_t bits = buffer[i] & 0x7F;
+        if (i == BINARY_VARINT_SIZE - 1 && bits > 1) {
+            return 0;
+        }
+
+        *value |= bits << (7 * i);
+        if (!(buffer[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measures a member record written by `microswim_encode_member`.
+ *
+ * @return The length of the record, or 0 if it is truncated.
+ */
+static size_t microswim_decode_member_length(const unsigned char* buffer, size_t length) {
+    uint64_t value;
+    size_t varint = (length > BINARY_MEMBER_SIZE)
+                        ? microswim_decode_varint(
+                              buffer + BINARY_MEMBER_SIZE, length - BINARY_MEMBER_SIZE, &value)
+                        : 0;
+
+    return (varint > 0) ? BINARY_MEMBER_SIZE + varint : 0;
+}
+
+/**
+ * @brief Reads a member record written by `microswim_encode_member`.
+ *
+ * @return The length of the record, or 0 if it is truncated.
+ */
+static size_t microswim_decode_member(
+    const unsigned char* buffer, size_t length, microswim_update_record_t* record) {
+    uint64_t value;
+    size_t varint = (length > BINARY_MEMBER_SIZE)
+                        ? microswim_decode_varint(
+                              buffer + BINARY_MEMBER_SIZE, length - BINARY_MEMBER_SIZE, &value)
+                        : 0;
+    if (varint == 0) {
+        return 0;
+    }
+
+    record->status = buffer[0];
+    memcpy(record->uuid.bytes, buffer + 1, ID_SIZE);
+    memcpy(record->address, buffer + 1 + ID_SIZE, sizeof(record->address));
+    record->port = (uint16_t)((buffer[BINARY_MEMBER_SIZE - 2] << 8) | buffer[BINARY_MEMBER_SIZE - 1]);
+    record->incarnation = (size_t)value;
+
+    return BINARY_MEMBER_SIZE + varint;
+}
+
+/**
+ * @brief Peeks at the type of the message.
+ *
+ * Messages of any other version, including the CBOR and JSON messages of nodes which
+ * have not been upgraded yet, are reported as unknown and ignored.
+ */
+microswim_message_type_t microswim_decode_binary_message_type(unsigned char* buffer, ssize_t len) {
+    if (len < BINARY_HEADER_SIZE) {
+        MICROSWIM_LOG_ERROR("Malformed message of %zd bytes, ignoring...", len);
+        return MALFORMED_MESSAGE;
+    }
+
+    if (buffer[0] != BINARY_VERSION) {
+        MICROSWIM_LOG_DEBUG("Unsupported message version 0x%02x, ignoring...", buffer[0]);
+        return UNKOWN_MESSAGE;
+    }
+
+    return (buffer[1] < UNKOWN_MESSAGE) ? (microswim_message_type_t)buffer[1] : UNKOWN_MESSAGE;
+}
+
+/**
+ * @brief Decodes the message in a single pass over the buffer.
+ *
+ * @return true if the message was decoded, false if it is malformed.
+ */
+bool microswim_decode_binary_message(microswim_message_t* message, const char* buffer, ssize_t len) {
+    const unsigned char* input = (const unsigned char*)buffer;
+    size_t length = (len > 0) ? (size_t)len : 0;
+
+    if (length < BINARY_HEADER_SIZE || input[0] != BINARY_VERSION) {
+        MICROSWIM_LOG_ERROR("Expected a version %d message, ignoring...", BINARY_VERSION);
+        return false;
+    }
+
+    message->type = (microswim_message_type_t)input[1];
+    size_t update_count = input[2];
+
+    size_t offset = BINARY_HEADER_SIZE;
+    size_t read = microswim_decode_member(input + offset, length - offset, &message->sender);
+
+    // NOTE: updates beyond the capacity of the message are dropped.
+    message->update_count = (update_count < MESSAGE_UPDATES) ? update_count : MESSAGE_UPDATES;
+    for (size_t i = 0; read > 0 && i < message->update_count; i++) {
+        offset += read;
+
+        read = microswim_decode_member(input + offset, length - offset, &message->mu[i]);
+    }
+
+    if (read == 0) {
+        MICROSWIM_LOG_ERROR(
+            "There was an error while reading the input near byte %zu (%zu bytes in total)",
+            offset, length);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Indexes the message, measuring the sender's record only.
+ *
+ * The update records are checked as they are decoded.
+ *
+ * @return true if the header and the sender's record are well formed, false otherwise.
+ */
+bool microswim_decode_binary_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len) {
+    memset(view, 0, sizeof(*view));
+    view->buffer = buffer;
+    view->length = len;
+
+    if (len < BINARY_HEADER_SIZE || buffer[0] != BINARY_VERSION) {
+        MICROSWIM_LOG_ERROR("Expected a version %d message, ignoring...", BINARY_VERSION);
+        return false;
+    }
+
+    size_t read = microswim_decode_member_length(buffer + BINARY_HEADER_SIZE, len - BINARY_HEADER_SIZE);
+    if (read == 0) {
+        MICROSWIM_LOG_ERROR(
+            "There was an error while reading the input near byte %d (%zu bytes in total)",
+            BINARY_HEADER_SIZE, len);
+        return false;
+    }
+
+    view->type = (microswim_message_type_t)buffer[1];
+    view->update_count = buffer[2];
+    view->sender = BINARY_HEADER_SIZE;
+    view->updates = BINARY_HEADER_SIZE + read;
+
+    return true;
+}
+
+/**
+ * @brief Decodes the member at `position` of an indexed message, its sender or an update.
+ *
+ * `position` is advanced past the update, onto the next one.
+ */
+bool microswim_decode_binary_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record) {
+    memset(record, 0, sizeof(*record));
+
+    size_t read = (*position < view->length)
+                      ? microswim_decode_member(
+                            view->buffer + *position, view->length - *position, record)
+                      : 0;
+
+    *position += read;
+    return read > 0;
+}
+
+#endif
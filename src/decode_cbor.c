@@ -1,147 +1,436 @@
 #ifdef MICROSWIM_CBOR
 
-#include "cbor.h"
+#include "decode.h"
 #include "microswim.h"
 #include "microswim_log.h"
+#include "record.h"
 
-microswim_message_type_t microswim_decode_message_type(unsigned char* buffer, ssize_t len) {
-    struct cbor_load_result result;
-    cbor_item_t* root = cbor_load(buffer, len, &result);
+#define CBOR_MAJOR_UNSIGNED 0
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_STRING 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+#define CBOR_NULL 22
 
-    if (result.error.code != CBOR_ERR_NONE) {
-        MICROSWIM_LOG_ERROR(
-            "There was an error while reading the input near byte %zu (read "
-            "%zu bytes in total)",
-            result.error.position, result.read);
+/**
+ * @brief Pulls CBOR data items one at a time out of the receive buffer.
+ *
+ * Strings are not copied; they are handed out as pointers into the buffer.
+ */
+typedef struct {
+    const unsigned char* buffer;
+    size_t length;
+    size_t position;
+} microswim_cbor_reader_t;
 
-        return MALFORMED_MESSAGE;
+/**
+ * @brief Reads the head of the next data item.
+ *
+ * NOTE: indefinite-length items are never produced by the encoder and are rejected.
+ *
+ * @return true if a complete head was read, false if the input is truncated or malformed.
+ */
+static bool microswim_cbor_head(microswim_cbor_reader_t* reader, uint8_t* major, uint64_t* value) {
+    if (reader->position >= reader->length) {
+        return false;
     }
 
-    microswim_message_type_t message_type = MALFORMED_MESSAGE;
+    uint8_t initial = reader->buffer[reader->position++];
+    uint8_t info = initial & 0x1F;
+    *major = initial >> 5;
 
-    switch (cbor_typeof(root)) {
-        case CBOR_TYPE_MAP: {
-            struct cbor_pair pair = cbor_map_handle(root)[0];
-            size_t key_length = cbor_string_length(pair.key);
-            char key[key_length];
-            memcpy(key, cbor_string_handle(pair.key), key_length);
-            if (strncmp(key, "message", key_length) == 0) {
-                size_t value = cbor_get_uint8(pair.value);
-                message_type = (microswim_message_type_t)value;
-            }
-            break;
+    if (info < 24) {
+        *value = info;
+        return true;
+    }
+
+    if (info > 27) {
+        return false;
+    }
+
+    size_t size = (size_t)1 << (info - 24);
+    if (reader->length - reader->position < size) {
+        return false;
+    }
+
+    *value = 0;
+    for (size_t i = 0; i < size; i++) {
+        *value = (*value << 8) | reader->buffer[reader->position++];
+    }
+
+    return true;
+}
+
+static bool microswim_cbor_uint(microswim_cbor_reader_t* reader, uint64_t* value) {
+    uint8_t major;
+    return microswim_cbor_head(reader, &major, value) && major == CBOR_MAJOR_UNSIGNED;
+}
+
+static bool microswim_cbor_string(
+    microswim_cbor_reader_t* reader, const char** string, size_t* length) {
+    uint8_t major;
+    uint64_t value;
+    if (!microswim_cbor_head(reader, &major, &value) || major != CBOR_MAJOR_STRING ||
+        value > reader->length - reader->position) {
+        return false;
+    }
+
+    *string = (const char*)reader->buffer + reader->position;
+    *length = (size_t)value;
+    reader->position += *length;
+
+    return true;
+}
+
+/**
+ * @brief Checks whether the next item is the null value, consuming it if so.
+ */
+static bool microswim_cbor_null(microswim_cbor_reader_t* reader) {
+    if (reader->position < reader->length &&
+        reader->buffer[reader->position] == ((CBOR_MAJOR_SIMPLE << 5) | CBOR_NULL)) {
+        reader->position++;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Skips over the next data item, including everything nested in it.
+ *
+ * Instead of recursing, the number of items still to be skipped is tracked. Every item
+ * takes at least one byte, so an item announcing more elements than there are bytes
+ * left is rejected right away.
+ */
+static bool microswim_cbor_skip(microswim_cbor_reader_t* reader) {
+    size_t pending = 1;
+
+    while (pending > 0) {
+        uint8_t major;
+        uint64_t value;
+        if (!microswim_cbor_head(reader, &major, &value)) {
+            return false;
+        }
+
+        pending--;
+
+        size_t left = reader->length - reader->position;
+        switch (major) {
+            case CBOR_MAJOR_BYTES:
+            case CBOR_MAJOR_STRING:
+                if (value > left) {
+                    return false;
+                }
+                reader->position += (size_t)value;
+                break;
+            case CBOR_MAJOR_ARRAY:
+                if (value > left) {
+                    return false;
+                }
+                pending += (size_t)value;
+                break;
+            case CBOR_MAJOR_MAP:
+                if (value > left / 2) {
+                    return false;
+                }
+                pending += 2 * (size_t)value;
+                break;
+            case CBOR_MAJOR_TAG:
+                pending++;
+                break;
+            default:
+                break;
         }
-        default:
-            MICROSWIM_LOG_ERROR("Wrong message type: %d, ignoring...", cbor_typeof(root));
-            break;
     }
 
-    cbor_decref(&root);
-    return message_type;
+    return true;
 }
 
-static void microswim_decode_uri_to_sockaddr(struct sockaddr_in* addr, cbor_item_t* item) {
-    size_t length = cbor_string_length(item);
-    char buffer[length];
-    memset(buffer, 0, sizeof(buffer));
-    memcpy(buffer, cbor_string_handle(item), sizeof(buffer));
-    char* colon = strchr(buffer, ':');
-    if (colon) {
-        int port_length = (buffer + length) - (colon);
-        char p[port_length - 1];
-        memset(p, 0, sizeof(p));
-        memcpy(p, colon + 1, sizeof(p));
-        buffer[length - port_length] = '\0';
-        p[port_length] = '\0';
-        int port = strtol(p, NULL, 10);
-        if (port) {
-            if (inet_pton(AF_INET, buffer, &(addr->sin_addr)) != 1) {
-                MICROSWIM_LOG_ERROR("Invalid IP address: %s\n", buffer);
-                exit(1);
-            }
-            addr->sin_port = htons(port);
-            addr->sin_family = AF_INET;
+static bool microswim_cbor_key_equal(const char* key, size_t length, const char* expected) {
+    return length == strlen(expected) && memcmp(key, expected, length) == 0;
+}
+
+/**
+ * @brief Decodes the value of one of the fields shared by the message and its updates.
+ *
+ * @return false if the value is malformed. Unknown keys have their value skipped.
+ */
+static bool microswim_decode_pair(
+    microswim_cbor_reader_t* reader, const char* key, size_t key_length,
+    microswim_update_record_t* record) {
+    const char* string;
+    size_t length;
+    uint64_t value;
+
+    if (microswim_cbor_key_equal(key, key_length, "uuid")) {
+        // NOTE: the UUID of a node which has not named itself yet is encoded as null.
+        if (microswim_cbor_null(reader)) {
+            return true;
+        }
+
+        return microswim_cbor_string(reader, &string, &length) &&
+               microswim_id_parse(&record->uuid, string, length);
+    }
+
+    if (microswim_cbor_key_equal(key, key_length, "uri")) {
+        // NOTE: an unusable address leaves the member without one.
+        if (!microswim_cbor_string(reader, &string, &length)) {
+            return false;
         }
+
+        microswim_record_uri_parse(record, string, length);
+        return true;
     }
+
+    if (microswim_cbor_key_equal(key, key_length, "status")) {
+        if (!microswim_cbor_uint(reader, &value)) {
+            return false;
+        }
+
+        record->status = (uint8_t)value;
+        return true;
+    }
+
+    if (microswim_cbor_key_equal(key, key_length, "incarnation")) {
+        if (!microswim_cbor_uint(reader, &value)) {
+            return false;
+        }
+
+        record->incarnation = (size_t)value;
+        return true;
+    }
+
+    return microswim_cbor_skip(reader);
 }
 
-static void microswim_decode_updates(microswim_message_t* message, cbor_item_t* updates) {
-    size_t update_count = cbor_array_size(updates);
-    message->update_count = (int)update_count;
-    for (size_t j = 0; j < update_count; j++) {
-        cbor_item_t* array_item = cbor_array_handle(updates)[j];
-        for (size_t k = 0; k < cbor_map_size(array_item); k++) {
-            struct cbor_pair array_pair = cbor_map_handle(array_item)[k];
-            size_t array_key_length = cbor_string_length(array_pair.key);
-            char array_key[array_key_length];
-            memcpy(array_key, cbor_string_handle(array_pair.key), array_key_length);
-            if (strncmp(array_key, "uuid", array_key_length) == 0) {
-                size_t uuid_length = cbor_string_length(array_pair.value);
-                memcpy(message->mu[j].uuid, cbor_string_handle(array_pair.value), uuid_length);
-                message->mu[j].uuid[uuid_length] = '\0';
-            } else if (strncmp(array_key, "uri", array_key_length) == 0) {
-                microswim_decode_uri_to_sockaddr(&message->mu[j].addr, array_pair.value);
-            } else if (strncmp(array_key, "status", array_key_length) == 0) {
-                size_t status = cbor_get_uint8(array_pair.value);
-                message->mu[j].status = (microswim_member_status_t)status;
-            } else if (strncmp(array_key, "incarnation", array_key_length) == 0) {
-                size_t incarnation = cbor_get_uint8(array_pair.value);
-                message->mu[j].incarnation = (int)incarnation;
-            }
+static bool
+    microswim_decode_update(microswim_cbor_reader_t* reader, microswim_update_record_t* record) {
+    uint8_t major;
+    uint64_t pairs;
+    if (!microswim_cbor_head(reader, &major, &pairs) || major != CBOR_MAJOR_MAP) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        const char* key;
+        size_t key_length;
+        if (!microswim_cbor_string(reader, &key, &key_length) ||
+            !microswim_decode_pair(reader, key, key_length, record)) {
+            return false;
         }
     }
+
+    return true;
 }
 
-static void microswim_decode_pair(microswim_message_t* message, const char* key, size_t key_length, struct cbor_pair pair) {
-    if (strncmp(key, "message", key_length) == 0) {
-        size_t value = cbor_get_uint8(pair.value);
+static bool microswim_decode_updates(
+    microswim_cbor_reader_t* reader, microswim_message_t* message) {
+    uint8_t major;
+    uint64_t update_count;
+    if (!microswim_cbor_head(reader, &major, &update_count) || major != CBOR_MAJOR_ARRAY) {
+        return false;
+    }
+
+    // NOTE: updates beyond the capacity of the message are dropped.
+    message->update_count =
+        (update_count < MESSAGE_UPDATES) ? (size_t)update_count : MESSAGE_UPDATES;
+    for (uint64_t i = 0; i < update_count; i++) {
+        bool decoded = (i < message->update_count)
+                           ? microswim_decode_update(reader, &message->mu[i])
+                           : microswim_cbor_skip(reader);
+        if (!decoded) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Peeks at the type of the message.
+ *
+ * The encoder always places the type first, so only the first few bytes of the buffer
+ * are looked at and anything else is rejected without parsing the rest of the message.
+ */
+microswim_message_type_t microswim_decode_cbor_message_type(unsigned char* buffer, ssize_t len) {
+    microswim_cbor_reader_t reader = { buffer, (len > 0) ? (size_t)len : 0, 0 };
+    uint8_t major;
+    uint64_t pairs;
+    const char* key;
+    size_t key_length;
+    uint64_t value;
+
+    if (!microswim_cbor_head(&reader, &major, &pairs) || major != CBOR_MAJOR_MAP || pairs == 0 ||
+        !microswim_cbor_string(&reader, &key, &key_length) ||
+        !microswim_cbor_key_equal(key, key_length, "message") ||
+        !microswim_cbor_uint(&reader, &value)) {
+        MICROSWIM_LOG_ERROR("Malformed message of %zd bytes, ignoring...", len);
+        return MALFORMED_MESSAGE;
+    }
+
+    return (value < UNKOWN_MESSAGE) ? (microswim_message_type_t)value : UNKOWN_MESSAGE;
+}
+
+static bool microswim_decode_message_pair(
+    microswim_cbor_reader_t* reader, const char* key, size_t key_length,
+    microswim_message_t* message) {
+    if (microswim_cbor_key_equal(key, key_length, "message")) {
+        uint64_t value;
+        if (!microswim_cbor_uint(reader, &value)) {
+            return false;
+        }
+
         message->type = (microswim_message_type_t)value;
-    } else if (strncmp(key, "uuid", key_length) == 0) {
-        size_t length = cbor_string_length(pair.value);
-        memcpy(message->uuid, cbor_string_handle(pair.value), length);
-        message->uuid[length] = '\0';
-    } else if (strncmp(key, "uri", key_length) == 0) {
-        microswim_decode_uri_to_sockaddr(&message->addr, pair.value);
-    } else if (strncmp(key, "status", key_length) == 0) {
-        size_t value = cbor_get_uint8(pair.value);
-        message->status = (microswim_member_status_t)value;
-    } else if (strncmp(key, "incarnation", key_length) == 0) {
-        size_t value = cbor_get_uint8(pair.value);
-        message->incarnation = value;
-    } else if (strncmp(key, "updates", key_length) == 0) {
-        microswim_decode_updates(message, pair.value);
+        return true;
     }
+
+    if (microswim_cbor_key_equal(key, key_length, "updates")) {
+        return microswim_decode_updates(reader, message);
+    }
+
+    return microswim_decode_pair(reader, key, key_length, &message->sender);
 }
 
-void microswim_decode_message(microswim_message_t* message, const char* buffer, ssize_t len) {
-    struct cbor_load_result result;
-    cbor_item_t* root = cbor_load((unsigned char*)buffer, len, &result);
+/**
+ * @brief Decodes the message in a single pass over the buffer, without any allocation.
+ *
+ * @return true if the message was decoded, false if it is malformed.
+ */
+bool microswim_decode_cbor_message(microswim_message_t* message, const char* buffer, ssize_t len) {
+    size_t length = (len > 0) ? (size_t)len : 0;
+    microswim_cbor_reader_t reader = { (const unsigned char*)buffer, length, 0 };
+    uint8_t major;
+    uint64_t pairs;
 
-    if (result.error.code != CBOR_ERR_NONE) {
-        MICROSWIM_LOG_ERROR(
-            "There was an error while reading the input near byte %zu (read "
-            "%zu bytes in total): \n",
-            result.error.position, result.read);
+    if (!microswim_cbor_head(&reader, &major, &pairs) || major != CBOR_MAJOR_MAP) {
+        MICROSWIM_LOG_ERROR("Expected a map, ignoring the message...");
+        return false;
+    }
 
-        return;
+    for (uint64_t i = 0; i < pairs; i++) {
+        const char* key;
+        size_t key_length;
+        if (!microswim_cbor_string(&reader, &key, &key_length) ||
+            !microswim_decode_message_pair(&reader, key, key_length, message)) {
+            MICROSWIM_LOG_ERROR(
+                "There was an error while reading the input near byte %zu (%zu bytes in total)",
+                reader.position, length);
+            return false;
+        }
     }
 
-    switch (cbor_typeof(root)) {
-        case CBOR_TYPE_MAP:
-            for (size_t i = 0; i < cbor_map_size(root); i++) {
-                struct cbor_pair pair = cbor_map_handle(root)[i];
-                size_t key_length = cbor_string_length(pair.key);
-                char key[key_length];
-                memcpy(key, cbor_string_handle(pair.key), key_length);
-                microswim_decode_pair(message, key, key_length, pair);
+    return true;
+}
+
+/**
+ * @brief Indexes the message without decoding any member.
+ *
+ * NOTE: the encoder places the updates last, in which case they are not even skipped; each
+ * of them is checked as it is decoded instead.
+ *
+ * @return true if the message is well formed as far as it was read and has a type.
+ */
+bool microswim_decode_cbor_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len) {
+    microswim_cbor_reader_t reader = { buffer, len, 0 };
+    uint8_t major;
+    uint64_t pairs;
+    bool typed = false;
+
+    memset(view, 0, sizeof(*view));
+    view->buffer = buffer;
+    view->length = len;
+
+    if (!microswim_cbor_head(&reader, &major, &pairs) || major != CBOR_MAJOR_MAP) {
+        MICROSWIM_LOG_ERROR("Expected a map, ignoring the message...");
+        return false;
+    }
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        const char* key;
+        size_t key_length;
+        uint64_t value = 0;
+        bool read = microswim_cbor_string(&reader, &key, &key_length);
+
+        if (read && microswim_cbor_key_equal(key, key_length, "message")) {
+            read = microswim_cbor_uint(&reader, &value);
+            view->type = read ? (microswim_message_type_t)value : MALFORMED_MESSAGE;
+            typed = read;
+        } else if (read && microswim_cbor_key_equal(key, key_length, "updates")) {
+            read = microswim_cbor_head(&reader, &major, &value) && major == CBOR_MAJOR_ARRAY &&
+                   value <= reader.length - reader.position;
+            view->updates = reader.position;
+            view->update_count = (size_t)value;
+            for (uint64_t j = 0; read && i + 1 < pairs && j < value; j++) {
+                read = microswim_cbor_skip(&reader);
             }
+        } else if (read) {
+            read = microswim_cbor_skip(&reader);
+        }
+
+        if (!read) {
+            MICROSWIM_LOG_ERROR(
+                "There was an error while reading the input near byte %zu (%zu bytes in total)",
+                reader.position, len);
+            return false;
+        }
+    }
+
+    return typed;
+}
+
+/**
+ * @brief Decodes the sender's fields, which sit in the message's own map next to the type and
+ * the updates.
+ */
+static bool
+    microswim_decode_sender(microswim_cbor_reader_t* reader, microswim_update_record_t* record) {
+    uint8_t major;
+    uint64_t pairs;
+    if (!microswim_cbor_head(reader, &major, &pairs) || major != CBOR_MAJOR_MAP) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        const char* key;
+        size_t key_length;
+        if (!microswim_cbor_string(reader, &key, &key_length)) {
+            return false;
+        }
+
+        // NOTE: nothing of the sender follows updates which come last.
+        if (i + 1 == pairs && microswim_cbor_key_equal(key, key_length, "updates")) {
             break;
-        default:
-            MICROSWIM_LOG_ERROR("Wrong message type: %d, ignoring...", cbor_typeof(root));
-            break;
+        }
+
+        if (!microswim_decode_pair(reader, key, key_length, record)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Decodes the member at `position` of an indexed message, its sender or an update.
+ *
+ * `position` is advanced past an update, onto the next one.
+ */
+bool microswim_decode_cbor_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record) {
+    microswim_cbor_reader_t reader = { view->buffer, view->length, *position };
+
+    memset(record, 0, sizeof(*record));
+
+    bool decoded = (*position == view->sender) ? microswim_decode_sender(&reader, record)
+                                               : microswim_decode_update(&reader, record);
+    if (!decoded) {
+        return false;
     }
 
-    cbor_decref(&root);
+    *position = reader.position;
+    return true;
 }
 
 #endif // MICROSWIM_CBOR
@@ -1,10 +1,13 @@
 #ifdef MICROSWIM_JSON
 
+#include "decode.h"
 #include "jsmn.h"
 #include "microswim.h"
 #include "microswim_log.h"
+#include "record.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static int jsoneq(const char* json, jsmntok_t* tok, const char* s) {
     if (tok->type == JSMN_STRING && (int)strlen(s) == tok->end - tok->start &&
@@ -14,110 +17,180 @@ static int jsoneq(const char* json, jsmntok_t* tok, const char* s) {
     return -1;
 }
 
-microswim_message_type_t microswim_decode_message_type(char* buffer, ssize_t len) {
-    int r;
-    jsmn_parser p;
-    jsmntok_t t[len];
-
-    jsmn_init(&p);
-    r = jsmn_parse(&p, buffer, strlen(buffer), t, sizeof(t) / sizeof(t[0]));
-    if (r < 0) {
-        MICROSWIM_LOG_ERROR("Failed to parse JSON: %d", r);
-        return MALFORMED_MESSAGE;
+/**
+ * @brief Pulls JSON values one at a time out of the receive buffer, without tokenising it first.
+ *
+ * Strings are not copied or unescaped; they are handed out as pointers into the buffer.
+ */
+typedef struct {
+    const char* buffer;
+    size_t length;
+    size_t position;
+} microswim_json_reader_t;
+
+static void microswim_json_space(microswim_json_reader_t* reader) {
+    while (reader->position < reader->length &&
+           (reader->buffer[reader->position] == ' ' || reader->buffer[reader->position] == '\t' ||
+            reader->buffer[reader->position] == '\n' || reader->buffer[reader->position] == '\r')) {
+        reader->position++;
     }
+}
 
-    if (r < 1 || t[0].type != JSMN_OBJECT) {
-        MICROSWIM_LOG_ERROR("Object expected\n");
-        return UNKOWN_MESSAGE;
+/**
+ * @brief Consumes the character if it is the next one past any whitespace.
+ */
+static bool microswim_json_expect(microswim_json_reader_t* reader, char c) {
+    microswim_json_space(reader);
+    if (reader->position < reader->length && reader->buffer[reader->position] == c) {
+        reader->position++;
+        return true;
     }
 
-    microswim_message_type_t message_type = MALFORMED_MESSAGE;
+    return false;
+}
 
-    for (int i = 0; i < r; i++) {
-        if (jsoneq(buffer, &t[i], "message") == 0) {
-            message_type = (microswim_message_type_t)strtol(buffer + t[i + 1].start, NULL, 10);
-            break;
-        }
+static bool microswim_json_string(
+    microswim_json_reader_t* reader, const char** string, size_t* length) {
+    if (!microswim_json_expect(reader, '"')) {
+        return false;
     }
 
-    return message_type;
-}
-
-#ifdef RIOT_OS
-static void microswim_decode_uri_to_sockaddr(sock_udp_ep_t* addr, char* buffer, size_t length) {
-    memset(addr, 0, sizeof(*addr));
+    size_t start = reader->position;
+    while (reader->position < reader->length && reader->buffer[reader->position] != '"') {
+        if (reader->buffer[reader->position] == '\\') {
+            reader->position++;
+        }
+        reader->position++;
+    }
 
-    const char* colon = memchr(buffer, ':', length);
-    if (!colon) {
-        return;
+    if (reader->position >= reader->length) {
+        return false;
     }
 
-    size_t ip_len = colon - buffer;
-    size_t port_len = length - ip_len - 1;
+    *string = reader->buffer + start;
+    *length = reader->position - start;
+    reader->position++;
 
-    char ip[64];
-    char port_str[8];
+    return true;
+}
 
-    memcpy(ip, buffer, ip_len);
-    ip[ip_len] = '\0';
+static bool microswim_json_uint(microswim_json_reader_t* reader, uint64_t* value) {
+    microswim_json_space(reader);
 
-    memcpy(port_str, colon + 1, port_len);
-    port_str[port_len] = '\0';
+    size_t start = reader->position;
+    *value = 0;
+    while (reader->position < reader->length && reader->buffer[reader->position] >= '0' &&
+           reader->buffer[reader->position] <= '9') {
+        *value = *value * 10 + (uint64_t)(reader->buffer[reader->position++] - '0');
+    }
 
-    char* end;
-    long port = strtol(port_str, &end, 10);
+    return reader->position > start;
+}
 
-    if (*end != '\0' || port <= 0 || port > 65535) {
-        return;
+/**
+ * @brief Skips over the next value, including everything nested in it.
+ *
+ * Instead of recursing, the nesting depth is tracked, stepping over strings as a whole so
+ * that brackets inside them are not counted.
+ */
+static bool microswim_json_skip(microswim_json_reader_t* reader) {
+    const char* string;
+    size_t length;
+
+    microswim_json_space(reader);
+    if (reader->position >= reader->length) {
+        return false;
     }
 
-    if (inet_pton(AF_INET, ip, &(addr->addr)) != 1) {
-        MICROSWIM_LOG_ERROR("Invalid IP address: %s\n", ip);
-        return;
+    char c = reader->buffer[reader->position];
+    if (c == '"') {
+        return microswim_json_string(reader, &string, &length);
     }
 
-    addr->family = AF_INET;
-    addr->port = port;
-}
-#else
-static void microswim_decode_uri_to_sockaddr(struct sockaddr_in* addr, const char* buffer, size_t length) {
-    memset(addr, 0, sizeof(*addr));
+    if (c != '{' && c != '[') {
+        size_t start = reader->position;
+        while (reader->position < reader->length &&
+               !memchr(",}] \t\r\n", reader->buffer[reader->position], 7)) {
+            reader->position++;
+        }
 
-    const char* colon = memchr(buffer, ':', length);
-    if (!colon) {
-        return;
+        return reader->position > start;
     }
 
-    size_t ip_len = colon - buffer;
-    size_t port_len = length - ip_len - 1;
+    size_t depth = 0;
+    while (reader->position < reader->length) {
+        c = reader->buffer[reader->position];
+        if (c == '"') {
+            if (!microswim_json_string(reader, &string, &length)) {
+                return false;
+            }
+            continue;
+        }
 
-    char ip[64];
-    char port_str[8];
+        reader->position++;
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return true;
+        }
+    }
 
-    memcpy(ip, buffer, ip_len);
-    ip[ip_len] = '\0';
+    return false;
+}
 
-    memcpy(port_str, colon + 1, port_len);
-    port_str[port_len] = '\0';
+/**
+ * @brief Reads the key of a pair and the colon after it.
+ */
+static bool microswim_json_key(microswim_json_reader_t* reader, const char** key, size_t* length) {
+    return microswim_json_string(reader, key, length) && microswim_json_expect(reader, ':');
+}
 
-    char* end;
-    long port = strtol(port_str, &end, 10);
+static bool microswim_json_key_equal(const char* key, size_t length, const char* expected) {
+    return length == strlen(expected) && memcmp(key, expected, length) == 0;
+}
 
-    if (*end != '\0' || port <= 0 || port > 65535) {
-        return;
+/**
+ * @brief Peeks at the type of the message.
+ *
+ * The pairs ahead of the type are skipped without being decoded, and nothing past it is
+ * looked at.
+ */
+microswim_message_type_t microswim_decode_json_message_type(unsigned char* input, ssize_t len) {
+    microswim_json_reader_t reader = { (const char*)input, (len > 0) ? (size_t)len : 0, 0 };
+    const char* key;
+    size_t key_length;
+    uint64_t value;
+
+    if (!microswim_json_expect(&reader, '{')) {
+        MICROSWIM_LOG_ERROR("Object expected\n");
+        return UNKOWN_MESSAGE;
     }
 
-    if (inet_pton(AF_INET, ip, &addr->sin_addr) != 1) {
-        MICROSWIM_LOG_ERROR("Invalid IP address: %s\n", ip);
-        return;
+    if (!microswim_json_expect(&reader, '}')) {
+        do {
+            if (!microswim_json_key(&reader, &key, &key_length)) {
+                break;
+            }
+
+            if (microswim_json_key_equal(key, key_length, "message")) {
+                if (!microswim_json_uint(&reader, &value)) {
+                    break;
+                }
+
+                return (value < UNKOWN_MESSAGE) ? (microswim_message_type_t)value : UNKOWN_MESSAGE;
+            }
+
+            if (!microswim_json_skip(&reader)) {
+                break;
+            }
+        } while (microswim_json_expect(&reader, ','));
     }
 
-    addr->sin_family = AF_INET;
-    addr->sin_port = htons((uint16_t)port);
+    MICROSWIM_LOG_ERROR("Malformed message of %zd bytes, ignoring...", len);
+    return MALFORMED_MESSAGE;
 }
-#endif
 
-void microswim_decode_message(microswim_message_t* message, const char* buffer, ssize_t len) {
+bool microswim_decode_json_message(microswim_message_t* message, const char* buffer, ssize_t len) {
     int r;
     jsmn_parser p;
     jsmntok_t t[len];
@@ -126,12 +199,12 @@ void microswim_decode_message(microswim_message_t* message, const char* buffer,
     r = jsmn_parse(&p, buffer, strlen(buffer), t, sizeof(t) / sizeof(t[0]));
     if (r < 0) {
         printf("Failed to parse JSON: %d\n", r);
-        return;
+        return false;
     }
 
     if (r < 1 || t[0].type != JSMN_OBJECT) {
         printf("Object expected\n");
-        return;
+        return false;
     }
 
     for (int i = 1; i < r; i++) {
@@ -140,22 +213,20 @@ void microswim_decode_message(microswim_message_t* message, const char* buffer,
             i++;
         }
         if (jsoneq(buffer, &t[i], "uuid") == 0) {
-            strncpy((char*)message->uuid, buffer + t[i + 1].start, t[i + 1].end - t[i + 1].start);
+            microswim_id_parse(&message->sender.uuid, buffer + t[i + 1].start, t[i + 1].end - t[i + 1].start);
             i++;
         }
         if (jsoneq(buffer, &t[i], "uri") == 0) {
-            char uri_buffer[t[i + 1].end - t[i + 1].start];
-            memset(uri_buffer, 0, sizeof(uri_buffer));
-            strncpy(uri_buffer, buffer + t[i + 1].start, t[i + 1].end - t[i + 1].start);
-            microswim_decode_uri_to_sockaddr(&message->addr, uri_buffer, t[i + 1].end - t[i + 1].start);
+            microswim_record_uri_parse(
+                &message->sender, buffer + t[i + 1].start, t[i + 1].end - t[i + 1].start);
             i++;
         }
         if (jsoneq(buffer, &t[i], "status") == 0) {
-            message->status = strtol(buffer + t[i + 1].start, NULL, 10);
+            message->sender.status = strtol(buffer + t[i + 1].start, NULL, 10);
             i++;
         }
         if (jsoneq(buffer, &t[i], "incarnation") == 0) {
-            message->incarnation = strtol(buffer + t[i + 1].start, NULL, 10);
+            message->sender.incarnation = strtol(buffer + t[i + 1].start, NULL, 10);
             i++;
         }
         if (jsoneq(buffer, &t[i], "updates") == 0) {
@@ -163,8 +234,12 @@ void microswim_decode_message(microswim_message_t* message, const char* buffer,
                 printf("Expected an array.\n");
             }
             // + 1 means that we hit the '[', indicating an array.
-            int array_size = t[i + 1].size;
+            // NOTE: updates beyond the capacity of the message are dropped.
+            int array_size = (t[i + 1].size < MESSAGE_UPDATES) ? t[i + 1].size : MESSAGE_UPDATES;
             message->update_count = array_size;
+            if (array_size == 0) {
+                break;
+            }
 
             // + 2 means that we hit the '{', indicating an object.
             if (t[i + 2].type != JSMN_OBJECT) {
@@ -183,17 +258,14 @@ void microswim_decode_message(microswim_message_t* message, const char* buffer,
                     // if +2 is the object, it means the content will start at +3
                     jsmntok_t* inner = &t[i + j + k + 3];
                     if (jsoneq(buffer, inner, "uuid") == 0) {
-                        strncpy(
-                            (char*)message->mu[j].uuid, buffer + (inner + 1)->start,
+                        microswim_id_parse(
+                            &message->mu[j].uuid, buffer + (inner + 1)->start,
                             (inner + 1)->end - (inner + 1)->start);
                         i++;
                     } else if (jsoneq(buffer, inner, "uri") == 0) {
-                        char uri_buffer[(inner + 1)->end - (inner + 1)->start];
-                        memset(uri_buffer, 0, sizeof(uri_buffer));
-                        strncpy(
-                            uri_buffer, buffer + (inner + 1)->start, (inner + 1)->end - (inner + 1)->start);
-                        microswim_decode_uri_to_sockaddr(
-                            &message->mu[j].addr, uri_buffer, (inner + 1)->end - (inner + 1)->start);
+                        microswim_record_uri_parse(
+                            &message->mu[j], buffer + (inner + 1)->start,
+                            (inner + 1)->end - (inner + 1)->start);
                         i++;
                     } else if (jsoneq(buffer, inner, "status") == 0) {
                         message->mu[j].status = strtol(buffer + (inner + 1)->start, NULL, 10);
@@ -210,6 +282,190 @@ void microswim_decode_message(microswim_message_t* message, const char* buffer,
             break;
         }
     }
+
+    return true;
+}
+
+/**
+ * @brief Decodes the value of one of the fields of a member.
+ *
+ * NOTE: as with the full decoder, an unparsable UUID or address leaves the field empty.
+ * `fields` counts the fields of the member read so far.
+ *
+ * @return false if the value is malformed. Unknown keys have their value skipped.
+ */
+static bool microswim_json_pair(
+    microswim_json_reader_t* reader, const char* key, size_t key_length,
+    microswim_update_record_t* record, size_t* fields) {
+    const char* string;
+    size_t length;
+    uint64_t value;
+
+    if (microswim_json_key_equal(key, key_length, "uuid")) {
+        if (!microswim_json_string(reader, &string, &length)) {
+            return false;
+        }
+
+        (*fields)++;
+        microswim_id_parse(&record->uuid, string, length);
+        return true;
+    }
+
+    if (microswim_json_key_equal(key, key_length, "uri")) {
+        if (!microswim_json_string(reader, &string, &length)) {
+            return false;
+        }
+
+        (*fields)++;
+        microswim_record_uri_parse(record, string, length);
+        return true;
+    }
+
+    if (microswim_json_key_equal(key, key_length, "status")) {
+        if (!microswim_json_uint(reader, &value)) {
+            return false;
+        }
+
+        (*fields)++;
+        record->status = (uint8_t)value;
+        return true;
+    }
+
+    if (microswim_json_key_equal(key, key_length, "incarnation")) {
+        if (!microswim_json_uint(reader, &value)) {
+            return false;
+        }
+
+        (*fields)++;
+        record->incarnation = (size_t)value;
+        return true;
+    }
+
+    return microswim_json_skip(reader);
+}
+
+/**
+ * @brief Reads the pairs of the message, counting the updates without decoding them.
+ *
+ * @return true if the pairs are well formed and one of them is the type.
+ */
+static bool microswim_json_view_pairs(microswim_json_reader_t* reader, microswim_message_view_t* view) {
+    const char* key;
+    size_t key_length;
+    uint64_t value;
+    bool typed = false;
+
+    do {
+        if (!microswim_json_key(reader, &key, &key_length)) {
+            return false;
+        }
+
+        if (microswim_json_key_equal(key, key_length, "message")) {
+            if (!microswim_json_uint(reader, &value)) {
+                return false;
+            }
+
+            view->type = (microswim_message_type_t)value;
+            typed = true;
+        } else if (microswim_json_key_equal(key, key_length, "updates")) {
+            if (!microswim_json_expect(reader, '[')) {
+                return false;
+            }
+
+            view->updates = reader->position;
+            view->update_count = 0;
+            if (microswim_json_expect(reader, ']')) {
+                continue;
+            }
+
+            do {
+                if (!microswim_json_skip(reader)) {
+                    return false;
+                }
+                view->update_count++;
+            } while (microswim_json_expect(reader, ','));
+
+            if (!microswim_json_expect(reader, ']')) {
+                return false;
+            }
+        } else if (!microswim_json_skip(reader)) {
+            return false;
+        }
+    } while (microswim_json_expect(reader, ','));
+
+    return typed;
+}
+
+/**
+ * @brief Indexes the message, checking its structure without decoding any member.
+ *
+ * @return true if the message is well formed and has a type, false otherwise.
+ */
+bool microswim_decode_json_view(microswim_message_view_t* view, const unsigned char* buffer, size_t len) {
+    microswim_json_reader_t reader = { (const char*)buffer, len, 0 };
+
+    memset(view, 0, sizeof(*view));
+    view->buffer = buffer;
+    view->length = len;
+
+    if (!microswim_json_expect(&reader, '{')) {
+        MICROSWIM_LOG_ERROR("Object expected\n");
+        return false;
+    }
+
+    if (!microswim_json_view_pairs(&reader, view) || !microswim_json_expect(&reader, '}')) {
+        MICROSWIM_LOG_ERROR(
+            "There was an error while reading the input near byte %zu (%zu bytes in total)",
+            reader.position, len);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Decodes the member at `position` of an indexed message, its sender or an update.
+ *
+ * `position` is advanced past the update, onto the separator in front of the next one.
+ */
+bool microswim_decode_json_member(
+    const microswim_message_view_t* view, size_t* position, microswim_update_record_t* record) {
+    microswim_json_reader_t reader = { (const char*)view->buffer, view->length, *position };
+    const char* key;
+    size_t key_length;
+    size_t fields = 0;
+
+    memset(record, 0, sizeof(*record));
+
+    microswim_json_expect(&reader, ',');
+    if (!microswim_json_expect(&reader, '{')) {
+        return false;
+    }
+
+    if (!microswim_json_expect(&reader, '}')) {
+        do {
+            if (!microswim_json_key(&reader, &key, &key_length)) {
+                return false;
+            }
+
+            // NOTE: once the sender is complete, the updates are not skipped just to reach
+            // the end of the message.
+            if (fields == 4 && microswim_json_key_equal(key, key_length, "updates")) {
+                return true;
+            }
+
+            if (!microswim_json_pair(&reader, key, key_length, record, &fields)) {
+                return false;
+            }
+        } while (microswim_json_expect(&reader, ','));
+
+        if (!microswim_json_expect(&reader, '}')) {
+            return false;
+        }
+    }
+
+    *position = reader.position;
+    return true;
 }
 
 #endif
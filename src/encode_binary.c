@@ -0,0 +1,113 @@
+#ifdef MICROSWIM_BINARY
+
+#include "constants.h"
+#include "encode.h"
+#include "microswim.h"
+#include "microswim_log.h"
+
+/**
+ * @brief Returns the length of the incarnation encoded as an unsigned LEB128 varint.
+ */
+static size_t microswim_encode_varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+
+    return size;
+}
+
+static size_t microswim_encode_varint(uint64_t value, unsigned char* buffer) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (unsigned char)value;
+
+    return length;
+}
+
+static size_t microswim_encode_member_size(size_t incarnation) {
+    return BINARY_MEMBER_SIZE + microswim_encode_varint_size(incarnation);
+}
+
+/**
+ * @brief Writes a member record: status, ID, IPv4 address and port, and the incarnation.
+ *
+ * The address and the port are written in network byte order.
+ */
+static size_t microswim_encode_member(unsigned char* buffer, const microswim_update_record_t* record) {
+    buffer[0] = record->status;
+    memcpy(buffer + 1, record->uuid.bytes, ID_SIZE);
+    memcpy(buffer + 1 + ID_SIZE, record->address, sizeof(record->address));
+    buffer[BINARY_MEMBER_SIZE - 2] = (unsigned char)(record->port >> 8);
+    buffer[BINARY_MEMBER_SIZE - 1] = (unsigned char)record->port;
+
+    return BINARY_MEMBER_SIZE + microswim_encode_varint(record->incarnation, buffer + BINARY_MEMBER_SIZE);
+}
+
+/**
+ * @brief Encodes the sender of a message or one of its updates on its own.
+ *
+ * Both are plain member records in the binary format.
+ *
+ * @return The length of the fragment, which is only complete if it is shorter than `size`.
+ */
+size_t microswim_encode_binary_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size) {
+    (void)sender;
+    size_t length = microswim_encode_member_size(record->incarnation);
+    if (length >= size) {
+        return length;
+    }
+
+    return microswim_encode_member(buffer, record);
+}
+
+/**
+ * @brief Encodes the fixed header ahead of the sender; nothing separates it from the updates.
+ */
+void microswim_encode_binary_frame(microswim_message_t* message, microswim_frame_t* frame) {
+    frame->head[0] = BINARY_VERSION;
+    frame->head[1] = (unsigned char)message->type;
+    frame->head[2] = (unsigned char)message->update_count;
+    frame->head_length = BINARY_HEADER_SIZE;
+    frame->middle_length = 0;
+}
+
+/**
+ * @brief Encodes the message in the binary format.
+ *
+ * A fixed header carrying the version, the type and the update count is followed by the
+ * sender's member record and then by one record per update.
+ *
+ * @return The length of the encoded message, or 0 if it does not fit into the buffer.
+ */
+size_t microswim_encode_binary_message(microswim_message_t* message, unsigned char* buffer, size_t size) {
+    size_t length = BINARY_HEADER_SIZE + microswim_encode_member_size(message->sender.incarnation);
+    for (size_t i = 0; i < message->update_count; i++) {
+        length += microswim_encode_member_size(message->mu[i].incarnation);
+    }
+
+    if (length > size || message->update_count > UINT8_MAX) {
+        MICROSWIM_LOG_ERROR("Message does not fit into %zu bytes\n", size);
+        return 0;
+    }
+
+    microswim_frame_t frame;
+    microswim_encode_binary_frame(message, &frame);
+    memcpy(buffer, frame.head, frame.head_length);
+
+    size_t offset = frame.head_length;
+    offset += microswim_encode_member(buffer + offset, &message->sender);
+
+    for (size_t i = 0; i < message->update_count; i++) {
+        offset += microswim_encode_member(buffer + offset, &message->mu[i]);
+    }
+
+    return offset;
+}
+
+#endif
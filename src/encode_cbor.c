@@ -1,87 +1,184 @@
 #ifdef MICROSWIM_CBOR
 
-#include "cbor.h"
+#include "encode.h"
 #include "microswim.h"
 #include "microswim_log.h"
-#include "utils.h"
-
-size_t microswim_encode_message(microswim_message_t* message, unsigned char* buffer, size_t size) {
-    cbor_item_t* origin_map = cbor_new_definite_map(6);
-    char uri_buffer[INET6_ADDRSTRLEN];
-    microswim_sockaddr_to_uri(&message->addr, uri_buffer, sizeof(uri_buffer));
-    int success = cbor_map_add(
-        origin_map,
-        (struct cbor_pair){ .key = cbor_move(cbor_build_string("message")),
-                            .value = cbor_move(cbor_build_uint8((uint8_t)message->type)) });
-    success &= cbor_map_add(
-        origin_map,
-        (struct cbor_pair){
-            .key = cbor_move(cbor_build_string("uuid")),
-            .value = cbor_move(message->uuid[0] != '\0' ? cbor_build_string((char*)message->uuid) : cbor_new_null()) });
-    success &= cbor_map_add(
-        origin_map,
-        (struct cbor_pair){ .key = cbor_move(cbor_build_string("uri")),
-                            .value = cbor_move(cbor_build_string(uri_buffer)) });
-    success &= cbor_map_add(
-        origin_map,
-        (struct cbor_pair){ .key = cbor_move(cbor_build_string("status")),
-                            .value = cbor_move(cbor_build_uint8((uint8_t)message->status)) });
-    success &= cbor_map_add(
-        origin_map,
-        (struct cbor_pair){ .key = cbor_move(cbor_build_string("incarnation")),
-                            .value = cbor_move(cbor_build_uint8((uint8_t)message->incarnation)) });
-    if (!success) {
-        MICROSWIM_LOG_ERROR("Preallocated storage for map is full (origin_map)");
-        return 0;
+#include "record.h"
+
+#define CBOR_MAJOR_UNSIGNED 0x00
+#define CBOR_MAJOR_STRING 0x60
+#define CBOR_MAJOR_ARRAY 0x80
+#define CBOR_MAJOR_MAP 0xA0
+#define CBOR_NULL 0xF6
+
+/**
+ * @brief Streams CBOR data items straight into the caller's buffer.
+ *
+ * The writer keeps counting once the buffer is full, so that the same code measures the
+ * exact length of a message when no buffer is supplied at all.
+ */
+typedef struct {
+    unsigned char* buffer;
+    size_t size;
+    size_t length;
+} microswim_cbor_writer_t;
+
+static void microswim_cbor_write(microswim_cbor_writer_t* writer, const void* data, size_t length) {
+    if (writer->length + length <= writer->size) {
+        memcpy(writer->buffer + writer->length, data, length);
     }
 
-    cbor_item_t* update_array = cbor_new_definite_array(message->update_count);
-
-    for (int i = 0; i < message->update_count; i++) {
-        char uri_buffer[INET6_ADDRSTRLEN];
-        microswim_sockaddr_to_uri(&message->mu[i].addr, uri_buffer, sizeof(uri_buffer));
-        cbor_item_t* update_map = cbor_new_definite_map(4);
-        int success = cbor_map_add(
-            update_map,
-            (struct cbor_pair){ .key = cbor_move(cbor_build_string("uuid")),
-                                .value = cbor_move(cbor_build_string((char*)message->mu[i].uuid)) });
-        success &= cbor_map_add(
-            update_map,
-            (struct cbor_pair){ .key = cbor_move(cbor_build_string("uri")),
-                                .value = cbor_move(cbor_build_string(uri_buffer)) });
-        success &= cbor_map_add(
-            update_map,
-            (struct cbor_pair){ .key = cbor_move(cbor_build_string("status")),
-                                .value = cbor_move(cbor_build_uint8((uint8_t)message->mu[i].status)) });
-        success &= cbor_map_add(
-            update_map,
-            (struct cbor_pair){ .key = cbor_move(cbor_build_string("incarnation")),
-                                .value = cbor_move(cbor_build_uint8((uint8_t)message->mu[i].incarnation)) });
-        success &= cbor_array_push(update_array, cbor_move(update_map));
-
-        if (!success) {
-            MICROSWIM_LOG_ERROR("Preallocated storage for map is full (update_map)");
-            return 0;
+    writer->length += length;
+}
+
+/**
+ * @brief Writes the head of a data item, using the shortest encoding of the argument.
+ */
+static void microswim_cbor_head(microswim_cbor_writer_t* writer, uint8_t major, uint64_t value) {
+    unsigned char head[9];
+    size_t length = 0;
+
+    if (value < 24) {
+        head[length++] = major | (uint8_t)value;
+    } else if (value <= UINT8_MAX) {
+        head[length++] = major | 24;
+        head[length++] = (uint8_t)value;
+    } else if (value <= UINT16_MAX) {
+        head[length++] = major | 25;
+        head[length++] = (uint8_t)(value >> 8);
+        head[length++] = (uint8_t)value;
+    } else if (value <= UINT32_MAX) {
+        head[length++] = major | 26;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            head[length++] = (uint8_t)(value >> shift);
+        }
+    } else {
+        head[length++] = major | 27;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            head[length++] = (uint8_t)(value >> shift);
         }
     }
 
-    success &= cbor_map_add(
-        origin_map,
-        (struct cbor_pair){ .key = cbor_move(cbor_build_string("updates")), .value = cbor_move(update_array) });
-    if (!success) {
-        MICROSWIM_LOG_ERROR("Preallocated storage for map is full (origin_map, update_array)");
-        return 0;
+    microswim_cbor_write(writer, head, length);
+}
+
+static void microswim_cbor_string(microswim_cbor_writer_t* writer, const char* string) {
+    size_t length = strlen(string);
+    microswim_cbor_head(writer, CBOR_MAJOR_STRING, length);
+    microswim_cbor_write(writer, string, length);
+}
+
+/**
+ * @brief Writes a key with an unsigned value.
+ *
+ * NOTE: the values are truncated to 8 bits, which is what the decoder reads back.
+ */
+static void microswim_cbor_uint8_pair(
+    microswim_cbor_writer_t* writer, const char* key, size_t value) {
+    microswim_cbor_string(writer, key);
+    microswim_cbor_head(writer, CBOR_MAJOR_UNSIGNED, (uint8_t)value);
+}
+
+/**
+ * @brief Writes the pairs describing the sender of a message, which sit at the top level.
+ *
+ * NOTE: the UUID of a node which has not named itself yet is encoded as null.
+ */
+static void microswim_cbor_sender(
+    microswim_cbor_writer_t* writer, const microswim_update_record_t* record) {
+    char uri_buffer[URI_SIZE];
+    microswim_record_uri_format(record, uri_buffer);
+
+    microswim_cbor_string(writer, "uuid");
+    if (!microswim_id_is_nil(&record->uuid)) {
+        char uuid_buffer[UUID_SIZE];
+        microswim_id_format(&record->uuid, uuid_buffer);
+        microswim_cbor_string(writer, uuid_buffer);
+    } else {
+        unsigned char null = CBOR_NULL;
+        microswim_cbor_write(writer, &null, 1);
     }
 
-    size_t len = cbor_serialize(origin_map, buffer, size);
-    if (!len) {
+    microswim_cbor_string(writer, "uri");
+    microswim_cbor_string(writer, uri_buffer);
+    microswim_cbor_uint8_pair(writer, "status", record->status);
+    microswim_cbor_uint8_pair(writer, "incarnation", record->incarnation);
+}
+
+static void microswim_cbor_member(
+    microswim_cbor_writer_t* writer, const microswim_update_record_t* record) {
+    char uri_buffer[URI_SIZE];
+    microswim_record_uri_format(record, uri_buffer);
+    char uuid_buffer[UUID_SIZE];
+    microswim_id_format(&record->uuid, uuid_buffer);
+
+    microswim_cbor_head(writer, CBOR_MAJOR_MAP, 4);
+    microswim_cbor_string(writer, "uuid");
+    microswim_cbor_string(writer, uuid_buffer);
+    microswim_cbor_string(writer, "uri");
+    microswim_cbor_string(writer, uri_buffer);
+    microswim_cbor_uint8_pair(writer, "status", record->status);
+    microswim_cbor_uint8_pair(writer, "incarnation", record->incarnation);
+}
+
+/**
+ * @brief Encodes the sender of a message or one of its updates on its own.
+ *
+ * @return The length of the fragment, which is only complete if it is shorter than `size`.
+ */
+size_t microswim_encode_cbor_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size) {
+    microswim_cbor_writer_t writer = { buffer, size, 0 };
+    if (sender) {
+        microswim_cbor_sender(&writer, record);
+    } else {
+        microswim_cbor_member(&writer, record);
+    }
+
+    return writer.length;
+}
+
+/**
+ * @brief Encodes the map head and the type ahead of the sender, and the head of the update
+ * array after it.
+ */
+void microswim_encode_cbor_frame(microswim_message_t* message, microswim_frame_t* frame) {
+    microswim_cbor_writer_t head = { frame->head, FRAME_SIZE, 0 };
+    microswim_cbor_head(&head, CBOR_MAJOR_MAP, 6);
+    microswim_cbor_uint8_pair(&head, "message", message->type);
+    frame->head_length = head.length;
+
+    microswim_cbor_writer_t middle = { frame->middle, FRAME_SIZE, 0 };
+    microswim_cbor_string(&middle, "updates");
+    microswim_cbor_head(&middle, CBOR_MAJOR_ARRAY, message->update_count);
+    frame->middle_length = middle.length;
+}
+
+/**
+ * @brief Encodes the message into the buffer without any allocation.
+ *
+ * The output is a definite-length map, in the same layout libcbor used to produce.
+ *
+ * @return The length of the encoded message, or 0 if it does not fit into the buffer.
+ */
+size_t microswim_encode_cbor_message(microswim_message_t* message, unsigned char* buffer, size_t size) {
+    microswim_frame_t frame;
+    microswim_encode_cbor_frame(message, &frame);
+
+    microswim_cbor_writer_t writer = { buffer, size, 0 };
+    microswim_cbor_write(&writer, frame.head, frame.head_length);
+    microswim_cbor_sender(&writer, &message->sender);
+    microswim_cbor_write(&writer, frame.middle, frame.middle_length);
+    for (size_t i = 0; i < message->update_count; i++) {
+        microswim_cbor_member(&writer, &message->mu[i]);
+    }
+
+    if (writer.length > size) {
         MICROSWIM_LOG_ERROR("Message serialization has failed");
         return 0;
     }
 
-    cbor_decref(&origin_map);
-
-    return len;
+    return writer.length;
 }
 
 #endif
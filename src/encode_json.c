@@ -1,34 +1,119 @@
 #ifdef MICROSWIM_JSON
 
+#include "encode.h"
 #include "microswim.h"
 #include "microswim_log.h"
-#include "utils.h"
+#include "record.h"
 #include <stdio.h>
 
-size_t microswim_encode_message(microswim_message_t* message, unsigned char* buffer, size_t size) {
-    char uri_buffer[64];
-    microswim_sockaddr_to_uri(&message->addr, uri_buffer, 64);
-    int remainder = snprintf(
-        (char*)buffer, size,
-        "{\"message\": %d, \"uuid\": \"%s\", \"uri\": \"%s\", \"status\": %d, \"incarnation\": "
-        "%d, "
-        "\"updates\": [",
-        message->type, message->uuid, uri_buffer, message->status, message->incarnation);
-    for (size_t i = 0; i < message->update_count; i++) {
-        char ub[64] = { 0 };
-        microswim_sockaddr_to_uri(&message->mu[i].addr, ub, 64);
-        remainder += snprintf(
-            (char*)buffer + remainder, size - remainder,
-            "{\"uuid\": \"%s\", \"uri\": \"%s\", \"status\": %d, \"incarnation\": %d}",
-            message->mu[i].uuid, ub, message->mu[i].status, message->mu[i].incarnation);
-        if (i < message->update_count - 1) {
-            remainder += snprintf((char*)buffer + remainder, size - remainder, ",");
-        } else {
-            remainder += snprintf((char*)buffer + remainder, size - remainder, "]}");
+static int
+    microswim_encode_sender(const microswim_update_record_t* record, char* buffer, size_t size) {
+    char uri_buffer[URI_SIZE];
+    microswim_record_uri_format(record, uri_buffer);
+    char uuid_buffer[UUID_SIZE];
+    microswim_id_format(&record->uuid, uuid_buffer);
+
+    return snprintf(
+        buffer, size, "\"uuid\": \"%s\", \"uri\": \"%s\", \"status\": %d, \"incarnation\": %zu, ",
+        uuid_buffer, uri_buffer, record->status, record->incarnation);
+}
+
+static int
+    microswim_encode_update(const microswim_update_record_t* record, char* buffer, size_t size) {
+    char uri_buffer[URI_SIZE];
+    microswim_record_uri_format(record, uri_buffer);
+    char uuid_buffer[UUID_SIZE];
+    microswim_id_format(&record->uuid, uuid_buffer);
+
+    return snprintf(
+        buffer, size, "{\"uuid\": \"%s\", \"uri\": \"%s\", \"status\": %d, \"incarnation\": %zu}",
+        uuid_buffer, uri_buffer, record->status, record->incarnation);
+}
+
+/**
+ * @brief Encodes the sender of a message or one of its updates on its own.
+ *
+ * @return The length of the fragment, which is only complete if it is shorter than `size`.
+ */
+size_t microswim_encode_json_fragment(
+    const microswim_update_record_t* record, bool sender, unsigned char* buffer, size_t size) {
+    char* output = (char*)buffer;
+    int length = sender ? microswim_encode_sender(record, output, size)
+                        : microswim_encode_update(record, output, size);
+
+    return (length > 0) ? (size_t)length : 0;
+}
+
+/**
+ * @brief Encodes the opening of the object and the type ahead of the sender, and the opening of
+ * the update array after it.
+ *
+ * NOTE: the frame is rebuilt for every update considered while packing, so it is assembled
+ * by hand rather than with snprintf.
+ */
+void microswim_encode_json_frame(microswim_message_t* message, microswim_frame_t* frame) {
+    static const char head[] = "{\"message\": ";
+    static const char middle[] = "\"updates\": [";
+
+    size_t length = sizeof(head) - 1;
+    memcpy(frame->head, head, length);
+
+    char digits[12];
+    size_t count = 0;
+    unsigned int type = (unsigned int)message->type;
+    do {
+        digits[count++] = (char)('0' + type % 10);
+        type /= 10;
+    } while (type > 0);
+    while (count > 0) {
+        frame->head[length++] = (unsigned char)digits[--count];
+    }
+
+    frame->head[length++] = ',';
+    frame->head[length++] = ' ';
+    frame->head_length = length;
+
+    memcpy(frame->middle, middle, sizeof(middle) - 1);
+    frame->middle_length = sizeof(middle) - 1;
+}
+
+size_t microswim_encode_json_message(microswim_message_t* message, unsigned char* buffer, size_t size) {
+    char* output = (char*)buffer;
+    microswim_frame_t frame;
+    microswim_encode_json_frame(message, &frame);
+
+    size_t length = snprintf(output, size, "%.*s", (int)frame.head_length, (const char*)frame.head);
+    if (length < size) {
+        length += microswim_encode_sender(&message->sender, output + length, size - length);
+    }
+
+    if (length < size) {
+        length += snprintf(
+            output + length, size - length, "%.*s", (int)frame.middle_length,
+            (const char*)frame.middle);
+    }
+
+    for (size_t i = 0; i < message->update_count && length < size; i++) {
+        if (i > 0) {
+            length += snprintf(output + length, size - length, ",");
         }
+
+        if (length < size) {
+            length += microswim_encode_update(&message->mu[i], output + length, size - length);
+        }
+    }
+
+    // NOTE: the array is closed even if there are no updates, so that the message stays valid.
+    if (length < size) {
+        length += snprintf(output + length, size - length, "]}");
+    }
+
+    if (length >= size) {
+        MICROSWIM_LOG_ERROR("Message does not fit into %zu bytes\n", size);
+        return 0;
     }
 
-    return remainder;
+    return length;
 }
 
 #endif
@@ -0,0 +1,195 @@
+#include "fragment.h"
+#include "arena.h"
+#include "hash.h"
+#include "microswim.h"
+#include "record.h"
+#include "slab.h"
+#include <string.h>
+
+/**
+ * @brief Allocates the fragment cache, with an entry for every member up to FRAGMENT_CACHE.
+ *
+ * @return true on success, false if it could not be allocated, in which case the updates are
+ * encoded anew for every message.
+ */
+bool microswim_fragment_reserve(microswim_t* ms) {
+    size_t capacity = FRAGMENT_ENTRIES(ms->config.maximum_members);
+    microswim_fragment_entry_t* fragments = microswim_arena_grow(
+        &ms->arena, ms->fragments, &ms->fragment_capacity, sizeof(microswim_fragment_entry_t),
+        capacity, capacity);
+    if (fragments == NULL) {
+        return false;
+    }
+
+    ms->fragments = fragments;
+    return true;
+}
+
+/**
+ * @brief Returns the entry of the fragment cache that holds the member of the slot.
+ *
+ * A member without an entry takes the one under the hand, which skips the entries of the
+ * message being spliced, since its parts still point into them.
+ *
+ * @return The fragment of the entry, or NULL if there is no cache or all of its entries are
+ * part of the message being spliced.
+ */
+static microswim_fragment_t* microswim_fragment_entry(microswim_t* ms, size_t slot) {
+    microswim_handle_t handle = { .slot = (uint32_t)slot,
+                                  .generation = ms->slots[slot].generation };
+    size_t index = ms->slots[slot].fragment;
+    if (index < ms->fragment_capacity &&
+        microswim_handle_equal(ms->fragments[index].member, handle)) {
+        ms->fragments[index].message = ms->fragment_splice;
+        return &ms->fragments[index].fragment;
+    }
+
+    for (size_t i = 0; i < ms->fragment_capacity; i++) {
+        index = ms->fragment_hand;
+        ms->fragment_hand = (ms->fragment_hand + 1) % ms->fragment_capacity;
+
+        microswim_fragment_entry_t* entry = &ms->fragments[index];
+        if (entry->member.generation != 0 && entry->message == ms->fragment_splice) {
+            continue;
+        }
+
+        entry->member = handle;
+        entry->message = ms->fragment_splice;
+        entry->fragment.length = 0;
+        ms->slots[slot].fragment = (uint16_t)index;
+        return &entry->fragment;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the encoding of the record in the codec, out of the cache if it still holds.
+ *
+ * The cache is refreshed whenever the record or the codec differ from those it was encoded
+ * with.
+ *
+ * @return The length of the encoding. `data` points to it, or is NULL if it is not cached,
+ * which happens if it does not fit into FRAGMENT_SIZE or the codec is not registered.
+ */
+static size_t microswim_fragment_fetch(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_fragment_t* fragment,
+    const microswim_update_record_t* record, bool sender, const unsigned char** data) {
+    size_t codec_index = 0;
+    while (codec_index < ms->codec_count && ms->codecs[codec_index] != codec) {
+        codec_index++;
+    }
+
+    *data = NULL;
+    if (fragment == NULL || codec_index == ms->codec_count) {
+        return codec->fragment(record, sender, NULL, 0);
+    }
+
+    if (fragment->length > 0 && fragment->codec == codec_index &&
+        microswim_record_equal(&fragment->record, record)) {
+        *data = fragment->data;
+        return fragment->length;
+    }
+
+    size_t length = codec->fragment(record, sender, fragment->data, FRAGMENT_SIZE);
+    if (length == 0 || length >= FRAGMENT_SIZE) {
+        fragment->length = 0;
+        return length;
+    }
+
+    fragment->record = *record;
+    fragment->codec = (uint8_t)codec_index;
+    fragment->length = (uint16_t)length;
+
+    *data = fragment->data;
+    return length;
+}
+
+/**
+ * @brief Returns the encoding of the sender of the message.
+ *
+ * The instance caches the last sender it encoded, which is nearly always itself.
+ */
+size_t microswim_fragment_sender(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    const unsigned char** data) {
+    return microswim_fragment_fetch(ms, codec, &ms->fragment, &message->sender, true, data);
+}
+
+/**
+ * @brief Returns the encoding of the update, cached in the fragment cache under the member it
+ * describes.
+ *
+ * Records carry no handle, so the member is found through the ID. Updates about members that
+ * have not named themselves yet are not cached.
+ */
+size_t microswim_fragment_update(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* record,
+    const unsigned char** data) {
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &record->uuid);
+    microswim_fragment_t* fragment = (entry != NULL && entry->slot != HASH_INDEX_NONE) ?
+                                         microswim_fragment_entry(ms, entry->slot) :
+                                         NULL;
+
+    return microswim_fragment_fetch(ms, codec, fragment, record, false, data);
+}
+
+static void microswim_splice_add(microswim_splice_t* splice, const void* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    splice->parts[splice->count].iov_base = (void*)data;
+    splice->parts[splice->count].iov_len = length;
+    splice->count++;
+    splice->length += length;
+}
+
+/**
+ * @brief Assembles the encoded message out of the cached fragments, without copying them.
+ *
+ * The parts point into the frame of the splice and into the caches of the instance, so they
+ * only hold until the next message is encoded.
+ *
+ * @return true if the message is spliced, false if one of its fragments is not cached or it
+ * has more updates than a splice has room for.
+ */
+bool microswim_fragment_splice(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    microswim_splice_t* splice) {
+    if (message->update_count > MESSAGE_UPDATES) {
+        return false;
+    }
+
+    // NOTE: the entries of the cache taken by this message are kept until the next one.
+    ms->fragment_splice++;
+
+    const unsigned char* data;
+    size_t length = microswim_fragment_sender(ms, codec, message, &data);
+    if (data == NULL) {
+        return false;
+    }
+
+    splice->count = 0;
+    splice->length = 0;
+    codec->frame(message, &splice->frame);
+    microswim_splice_add(splice, splice->frame.head, splice->frame.head_length);
+    microswim_splice_add(splice, data, length);
+    microswim_splice_add(splice, splice->frame.middle, splice->frame.middle_length);
+
+    size_t separator = strlen(codec->separator);
+    for (size_t i = 0; i < message->update_count; i++) {
+        length = microswim_fragment_update(ms, codec, &message->mu[i], &data);
+        if (data == NULL) {
+            return false;
+        }
+
+        if (i > 0) {
+            microswim_splice_add(splice, codec->separator, separator);
+        }
+        microswim_splice_add(splice, data, length);
+    }
+
+    microswim_splice_add(splice, codec->tail, strlen(codec->tail));
+    return true;
+}
@@ -0,0 +1,171 @@
+#include "hash.h"
+#include "arena.h"
+#include "constants.h"
+#include "microswim.h"
+#include "microswim_log.h"
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ull
+
+/**
+ * @brief Computes the home slot of the UUID in the hash index.
+ *
+ * Both halves of the identifier are folded together and mixed with a
+ * multiplicative hash, which is then mapped onto the index range with a
+ * multiply-shift instead of a modulo.
+ */
+static size_t microswim_hash_slot(const microswim_id_t* uuid, size_t capacity) {
+    uint64_t words[2];
+    memcpy(words, uuid->bytes, ID_SIZE);
+    uint32_t hash = (uint32_t)(((words[0] ^ (words[1] * HASH_MULTIPLIER)) * HASH_MULTIPLIER) >> 32);
+
+    return (size_t)(((uint64_t)hash * capacity) >> 32);
+}
+
+static size_t microswim_hash_next(microswim_t* ms, size_t slot) {
+    return (slot + 1 == ms->hash_capacity) ? 0 : slot + 1;
+}
+
+/**
+ * @brief Searches for the UUID in the hash index.
+ *
+ * @return A pointer to the entry holding the UUID, or NULL if the UUID is not indexed.
+ */
+microswim_hash_entry_t* microswim_hash_find(microswim_t* ms, const microswim_id_t* uuid) {
+    if (microswim_id_is_nil(uuid)) {
+        return NULL;
+    }
+
+    size_t slot = microswim_hash_slot(uuid, ms->hash_capacity);
+    for (size_t i = 0; i < ms->hash_capacity; i++) {
+        microswim_hash_entry_t* entry = &ms->hash[slot];
+        if (microswim_id_is_nil(&entry->uuid)) {
+            return NULL;
+        }
+
+        if (microswim_id_equal(&entry->uuid, uuid)) {
+            return entry;
+        }
+
+        slot = microswim_hash_next(ms, slot);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Inserts the UUID into the hash index.
+ *
+ * A newly inserted entry does not reference any of the tables. If the UUID
+ * is already indexed, the existing entry is returned untouched.
+ *
+ * @return A pointer to the entry holding the UUID, or NULL if the index is full.
+ */
+microswim_hash_entry_t* microswim_hash_insert(microswim_t* ms, const microswim_id_t* uuid) {
+    if (microswim_id_is_nil(uuid)) {
+        return NULL;
+    }
+
+    size_t slot = microswim_hash_slot(uuid, ms->hash_capacity);
+    for (size_t i = 0; i < ms->hash_capacity; i++) {
+        microswim_hash_entry_t* entry = &ms->hash[slot];
+        if (microswim_id_is_nil(&entry->uuid)) {
+            entry->uuid = *uuid;
+            entry->slot = HASH_INDEX_NONE;
+            entry->ping = HASH_INDEX_NONE;
+            return entry;
+        }
+
+        if (microswim_id_equal(&entry->uuid, uuid)) {
+            return entry;
+        }
+
+        slot = microswim_hash_next(ms, slot);
+    }
+
+    MICROSWIM_LOG_ERROR("Cannot index more than %zu UUIDs\n", ms->hash_capacity);
+    return NULL;
+}
+
+/**
+ * @brief Releases the entry once it no longer references any of the tables.
+ *
+ * The entries following the released one are shifted backwards so that the
+ * probe sequences stay intact without leaving tombstones behind. Any entry
+ * pointers obtained before the call must be considered invalid afterwards.
+ */
+void microswim_hash_release(microswim_t* ms, microswim_hash_entry_t* entry) {
+    if (entry->slot != HASH_INDEX_NONE || entry->ping != HASH_INDEX_NONE) {
+        return;
+    }
+
+    size_t hole = (size_t)(entry - ms->hash);
+    size_t slot = hole;
+
+    for (;;) {
+        slot = microswim_hash_next(ms, slot);
+        microswim_hash_entry_t* next = &ms->hash[slot];
+        if (microswim_id_is_nil(&next->uuid)) {
+            break;
+        }
+
+        // NOTE: the entry can only fill the hole if the hole lies on its probe sequence,
+        // i.e. the home slot is not cyclically within (hole, slot].
+        size_t home = microswim_hash_slot(&next->uuid, ms->hash_capacity);
+        bool movable = (slot > hole) ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            ms->hash[hole] = *next;
+            hole = slot;
+        }
+    }
+
+    memset(&ms->hash[hole].uuid, 0, sizeof(ms->hash[hole].uuid));
+}
+
+/**
+ * @brief Grows the hash index along with the member tables.
+ *
+ * The index holds the UUIDs of both the member and the confirmed member tables. Keeping
+ * its capacity at twice their combined capacity keeps it at most half full. Since every
+ * entry's home slot depends on the capacity, the entries are rehashed into a new table.
+ *
+ * @return true if the index is large enough, false if it could not be grown.
+ */
+bool microswim_hash_reserve(microswim_t* ms) {
+    size_t capacity = 2 * (ms->member_capacity + ms->confirmed_capacity);
+    // NOTE: carved out of a memory buffer, the index is sized for the largest tables at once.
+    if (ms->arena.base != NULL) {
+        capacity = 4 * ms->config.maximum_members;
+    }
+    if (capacity <= ms->hash_capacity) {
+        return true;
+    }
+
+    size_t size = capacity * sizeof(microswim_hash_entry_t);
+    microswim_hash_entry_t* hash = microswim_arena_reallocate(&ms->arena, NULL, 0, size);
+    if (hash == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to grow the hash index to %zu entries\n", capacity);
+        return false;
+    }
+
+    memset(hash, 0, size);
+
+    for (size_t i = 0; i < ms->hash_capacity; i++) {
+        microswim_hash_entry_t* entry = &ms->hash[i];
+        if (microswim_id_is_nil(&entry->uuid)) {
+            continue;
+        }
+
+        size_t slot = microswim_hash_slot(&entry->uuid, capacity);
+        while (!microswim_id_is_nil(&hash[slot].uuid)) {
+            slot = (slot + 1 == capacity) ? 0 : slot + 1;
+        }
+
+        hash[slot] = *entry;
+    }
+
+    microswim_arena_release(&ms->arena, ms->hash);
+    ms->hash = hash;
+    ms->hash_capacity = capacity;
+
+    return true;
+}
@@ -0,0 +1,85 @@
+#include "id.h"
+#include "constants.h"
+
+static int microswim_id_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Parses a textual UUID (8-4-4-4-12 hexadecimal digits) into an identifier.
+ *
+ * The parsing is case-insensitive. An empty string yields the nil identifier.
+ *
+ * @return true if the text was a valid UUID, otherwise false and the identifier is set to nil.
+ */
+bool microswim_id_parse(microswim_id_t* id, const char* text, size_t length) {
+    memset(id->bytes, 0, ID_SIZE);
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (length != UUID_SIZE - 1) {
+        return false;
+    }
+
+    size_t byte = 0;
+    for (size_t i = 0; i < length;) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (text[i] != '-') {
+                memset(id->bytes, 0, ID_SIZE);
+                return false;
+            }
+            i++;
+            continue;
+        }
+
+        int high = microswim_id_nibble(text[i]);
+        int low = microswim_id_nibble(text[i + 1]);
+        if (high < 0 || low < 0) {
+            memset(id->bytes, 0, ID_SIZE);
+            return false;
+        }
+
+        id->bytes[byte++] = (uint8_t)((high << 4) | low);
+        i += 2;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Formats the identifier as a textual UUID.
+ *
+ * The buffer must hold at least UUID_SIZE bytes. The nil identifier is formatted
+ * as an empty string, which is how the members without a UUID appear on the wire.
+ */
+void microswim_id_format(const microswim_id_t* id, char* buffer) {
+    static const char digits[] = "0123456789abcdef";
+
+    if (microswim_id_is_nil(id)) {
+        buffer[0] = '\0';
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < ID_SIZE; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            buffer[offset++] = '-';
+        }
+        buffer[offset++] = digits[id->bytes[i] >> 4];
+        buffer[offset++] = digits[id->bytes[i] & 0x0F];
+    }
+
+    buffer[offset] = '\0';
+}
@@ -0,0 +1,514 @@
+// NOTE: recvmmsg and sendmmsg are GNU extensions.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "io.h"
+#include "arena.h"
+#include "message.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "shard.h"
+#include "uring.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#ifndef RIOT_OS
+
+/**
+ * @brief Buffers of the batched socket I/O.
+ *
+ * Outgoing messages are copied into `outbound` rather than referenced, since the fragments
+ * they are spliced from may be encoded anew in another codec before the queue is flushed.
+ */
+struct microswim_io {
+#ifdef __linux__
+    struct mmsghdr inbound_headers[IO_BATCH];
+    struct mmsghdr outbound_headers[IO_BATCH];
+#endif
+    struct iovec inbound_parts[IO_BATCH];
+    struct iovec outbound_parts[IO_BATCH];
+    struct sockaddr_in outbound_addresses[IO_BATCH];
+    microswim_datagram_t datagrams[IO_BATCH];
+    microswim_uring_t* uring;   // NOTE: NULL unless the I/O runs on an io_uring
+    microswim_shards_t* shards; // NOTE: NULL unless datagrams are received by workers
+    size_t outbound_count;
+    size_t corked;       // NOTE: Nesting depth of the sections whose messages are held back
+    size_t system_calls; // NOTE: Issued by the batched I/O outside of the io_uring
+    bool shared;         // NOTE: Lent by a loop to the instances it drives, which release nothing
+    unsigned char inbound[IO_BATCH][BUFFER_SIZE];
+    unsigned char outbound[IO_BATCH][BUFFER_SIZE];
+};
+
+/**
+ * @brief Allocates buffers of the batched socket I/O out of the arena.
+ *
+ * `shared` buffers may be lent to many instances which run on the same thread, since no
+ * instance leaves anything in them once it has handled its datagrams and flushed its queue.
+ *
+ * @return The buffers, or NULL if they could not be allocated.
+ */
+microswim_io_t* microswim_io_create(microswim_arena_t* arena, bool shared) {
+    microswim_io_t* io = microswim_arena_reallocate(arena, NULL, 0, sizeof(microswim_io_t));
+    if (io == NULL) {
+        MICROSWIM_LOG_WARN("Unable to allocate the I/O buffers, datagrams are handled one at a time\n");
+        return NULL;
+    }
+
+    memset(io, 0, sizeof(*io));
+    io->shared = shared;
+    for (size_t i = 0; i < IO_BATCH; i++) {
+        // NOTE: the receivers keep one byte of BUFFER_SIZE for the terminating null byte.
+        io->inbound_parts[i].iov_base = io->inbound[i];
+        io->inbound_parts[i].iov_len = BUFFER_SIZE - 1;
+        io->outbound_parts[i].iov_base = io->outbound[i];
+#ifdef __linux__
+        io->inbound_headers[i].msg_hdr.msg_iov = &io->inbound_parts[i];
+        io->inbound_headers[i].msg_hdr.msg_iovlen = 1;
+        io->outbound_headers[i].msg_hdr.msg_name = &io->outbound_addresses[i];
+        io->outbound_headers[i].msg_hdr.msg_namelen = sizeof(io->outbound_addresses[i]);
+        io->outbound_headers[i].msg_hdr.msg_iov = &io->outbound_parts[i];
+        io->outbound_headers[i].msg_hdr.msg_iovlen = 1;
+#endif
+    }
+
+    return io;
+}
+
+/**
+ * @brief Releases buffers allocated by `microswim_io_create`, along with their io_uring and
+ * their receive workers.
+ */
+void microswim_io_destroy(microswim_arena_t* arena, microswim_io_t* io) {
+    if (io == NULL) {
+        return;
+    }
+
+    microswim_uring_destroy(arena, io->uring);
+    microswim_shards_destroy(arena, io->shards);
+    microswim_arena_release(arena, io);
+}
+
+/**
+ * @brief Allocates buffers of the batched socket I/O for the instance alone.
+ *
+ * `microswim_init` leaves the instance without, so that its datagrams are received and sent
+ * one at a time. `microswim_loop_add` lends the loop's buffers to the instances which have
+ * none. Hosts which drive an instance themselves, or want it on an io_uring or receive
+ * workers, reserve buffers of its own.
+ *
+ * @return true if the buffers are available, false if messages are received and sent one at
+ * a time.
+ */
+bool microswim_io_reserve(microswim_t* ms) {
+    if (ms->io != NULL && !ms->io->shared) {
+        return true;
+    }
+
+    microswim_io_t* io = microswim_io_create(&ms->arena, false);
+    if (io == NULL) {
+        return false;
+    }
+
+    ms->io = io;
+    return true;
+}
+
+/**
+ * @brief Lends `io`, created shared, to the instance unless it has buffers of its own.
+ */
+void microswim_io_lend(microswim_t* ms, microswim_io_t* io) {
+    if (ms->io == NULL && io != NULL && io->shared) {
+        ms->io = io;
+    }
+}
+
+/**
+ * @brief Releases the buffers of the batched socket I/O, dropping any messages still queued.
+ * Lent buffers are only given back.
+ */
+void microswim_io_release(microswim_t* ms) {
+    if (ms->io != NULL && !ms->io->shared) {
+        microswim_io_destroy(&ms->arena, ms->io);
+    }
+
+    ms->io = NULL;
+}
+
+/**
+ * @brief Moves the batched I/O onto an io_uring, if the library is built with
+ * MICROSWIM_IO_URING and the kernel supports it. The socket has to be set up already, and the
+ * instance needs buffers of its own (`microswim_io_reserve`).
+ *
+ * Datagrams are then received into buffers provided to the kernel and handled in place, and
+ * the messages held back are sent with one `io_uring_enter`. Afterwards the datagrams have to
+ * be waited for on `microswim_io_descriptor` rather than on the socket.
+ *
+ * @return true if the I/O runs on an io_uring, false if it stays on the socket calls.
+ */
+bool microswim_io_uring_setup(microswim_t* ms) {
+#ifdef MICROSWIM_IO_URING
+    if (ms->io == NULL || ms->io->shared || ms->io->shards != NULL) {
+        return false;
+    }
+
+    if (ms->io->uring == NULL) {
+        ms->io->uring = microswim_uring_create(&ms->arena, ms->socket);
+    }
+
+    return ms->io->uring != NULL;
+#else
+    (void)ms;
+    return false;
+#endif
+}
+
+/**
+ * @brief Spreads the receiving and the decoding of datagrams over `count` worker threads, if
+ * the library is built with MICROSWIM_SHARDS. The socket has to be set up already, and the
+ * instance needs buffers of its own (`microswim_io_reserve`).
+ *
+ * Every worker receives on a `SO_REUSEPORT` socket of its own bound to the instance's address,
+ * which the kernel spreads the datagrams over by their source, and decodes them outside of the
+ * instance. The decoded messages are queued for `microswim_io_receive`, so the instance's state
+ * is only ever changed by the thread which owns it. Afterwards the decoded messages have to be
+ * waited for on `microswim_io_descriptor` rather than on the socket, and the instance's
+ * io_uring, if any, is left unused.
+ *
+ * @return true if datagrams are received by the workers, false if they stay on the socket calls.
+ */
+bool microswim_io_shard_setup(microswim_t* ms, size_t count) {
+#ifdef MICROSWIM_SHARDS
+    if (ms->io == NULL || ms->io->shared || ms->io->uring != NULL) {
+        return false;
+    }
+
+    if (ms->io->shards == NULL) {
+        ms->io->shards = microswim_shards_create(&ms->arena, ms, count);
+    }
+
+    return ms->io->shards != NULL;
+#else
+    (void)ms;
+    (void)count;
+    return false;
+#endif
+}
+
+/**
+ * @brief The number of received datagrams the workers dropped because the instance fell
+ * behind in applying them.
+ */
+size_t microswim_io_dropped(microswim_t* ms) {
+    if (ms->io == NULL || ms->io->shards == NULL) {
+        return 0;
+    }
+
+    return microswim_shards_dropped(ms->io->shards);
+}
+
+/**
+ * @brief The file descriptor which becomes readable when datagrams arrive.
+ */
+int microswim_io_descriptor(microswim_t* ms) {
+    if (ms->io != NULL && ms->io->shards != NULL) {
+        return microswim_shards_descriptor(ms->io->shards);
+    }
+
+    if (ms->io != NULL && ms->io->uring != NULL) {
+        return microswim_uring_descriptor(ms->io->uring);
+    }
+
+    return ms->socket;
+}
+
+/**
+ * @brief The number of system calls the batched I/O has issued, including the io_uring's.
+ * Lent buffers count those of all the instances they are lent to.
+ */
+size_t microswim_io_system_calls(microswim_t* ms) {
+    if (ms->io == NULL) {
+        return 0;
+    }
+
+    size_t count = ms->io->system_calls;
+    if (ms->io->uring != NULL) {
+        count += microswim_uring_system_calls(ms->io->uring);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Holds back the messages sent from now on until the matching `microswim_io_uncork`.
+ *
+ * Sections may nest, the messages are flushed once the outermost one ends.
+ */
+void microswim_io_cork(microswim_t* ms) {
+    if (ms->io != NULL) {
+        ms->io->corked++;
+    }
+}
+
+/**
+ * @brief Ends a section started by `microswim_io_cork`, flushing the queue after the outermost.
+ */
+void microswim_io_uncork(microswim_t* ms) {
+    if (ms->io == NULL || ms->io->corked == 0) {
+        return;
+    }
+
+    if (--ms->io->corked == 0) {
+        microswim_io_flush(ms);
+    }
+}
+
+/**
+ * @brief Queues the message made of `parts` for `addr`, flushing the queue first if it is full.
+ *
+ * @return true if the message is queued, false if it has to be sent right away, which is the
+ * case outside of a corked section, on platforms without `sendmmsg` and for messages longer
+ * than BUFFER_SIZE.
+ */
+bool microswim_io_queue(
+    microswim_t* ms, const struct sockaddr_in* addr, const microswim_iovec_t* parts, size_t count) {
+#ifdef __linux__
+    microswim_io_t* io = ms->io;
+    if (io == NULL || io->corked == 0) {
+        return false;
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < count; i++) {
+        length += parts[i].iov_len;
+    }
+
+    if (length > BUFFER_SIZE) {
+        return false;
+    }
+
+    if (io->outbound_count == IO_BATCH) {
+        microswim_io_flush(ms);
+    }
+
+    size_t index = io->outbound_count++;
+    unsigned char* buffer = io->outbound[index];
+    for (size_t i = 0; i < count; i++) {
+        memcpy(buffer, parts[i].iov_base, parts[i].iov_len);
+        buffer += parts[i].iov_len;
+    }
+
+    io->outbound_parts[index].iov_len = length;
+    io->outbound_addresses[index] = *addr;
+
+    return true;
+#else
+    (void)ms;
+    (void)addr;
+    (void)parts;
+    (void)count;
+    return false;
+#endif
+}
+
+/**
+ * @brief Sends the queued messages, as many as possible with every `sendmmsg`.
+ *
+ * @return The number of messages sent. A message the socket refuses is dropped, as it would
+ * be if it had been sent on its own.
+ */
+size_t microswim_io_flush(microswim_t* ms) {
+    size_t sent = 0;
+#ifdef __linux__
+    microswim_io_t* io = ms->io;
+    if (io == NULL) {
+        return 0;
+    }
+
+    if (io->uring != NULL) {
+        for (size_t i = 0; i < io->outbound_count; i++) {
+            microswim_uring_send(io->uring, &io->outbound_headers[i].msg_hdr);
+        }
+
+        io->outbound_count = 0;
+        return microswim_uring_submit(io->uring);
+    }
+
+    size_t position = 0;
+    while (position < io->outbound_count) {
+        io->system_calls++;
+        int result = sendmmsg(
+            ms->socket, &io->outbound_headers[position],
+            (unsigned int)(io->outbound_count - position), 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            MICROSWIM_LOG_ERROR("(microswim_io_flush) sendmmsg failed: %d %s", errno, strerror(errno));
+            position++;
+            continue;
+        }
+
+        position += (size_t)result;
+        sent += (size_t)result;
+    }
+
+    io->outbound_count = 0;
+#else
+    (void)ms;
+#endif
+    return sent;
+}
+
+/**
+ * @brief Receives up to IO_BATCH datagrams into the inbound buffers without blocking.
+ *
+ * @return The number of datagrams received, their descriptions are in `datagrams`.
+ */
+static size_t microswim_io_read(microswim_t* ms) {
+    microswim_io_t* io = ms->io;
+    size_t count = 0;
+
+#ifdef __linux__
+    int result;
+    do {
+        io->system_calls++;
+        result = recvmmsg(ms->socket, io->inbound_headers, IO_BATCH, MSG_DONTWAIT, NULL);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            MICROSWIM_LOG_ERROR("(microswim_io_receive) recvmmsg failed: %d %s", errno, strerror(errno));
+        }
+        return 0;
+    }
+
+    for (; count < (size_t)result; count++) {
+        io->datagrams[count].buffer = io->inbound[count];
+        io->datagrams[count].length = (ssize_t)io->inbound_headers[count].msg_len;
+    }
+#else
+    for (; count < IO_BATCH; count++) {
+        io->system_calls++;
+        ssize_t bytes =
+            recvfrom(ms->socket, io->inbound[count], BUFFER_SIZE - 1, MSG_DONTWAIT, NULL, NULL);
+        if (bytes <= 0) {
+            break;
+        }
+
+        io->datagrams[count].buffer = io->inbound[count];
+        io->datagrams[count].length = bytes;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        io->datagrams[i].buffer[io->datagrams[i].length] = '\0';
+    }
+
+    return count;
+}
+
+/**
+ * @brief Applies the messages the receive workers have decoded, in batches of up to IO_BATCH
+ * whose responses are flushed together.
+ *
+ * @return The number of messages taken from the workers, including the dropped ones.
+ */
+static size_t microswim_io_apply(
+    microswim_t* ms, uint64_t now, microswim_io_admit_t admit, void* context,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t)) {
+    microswim_shards_t* shards = ms->io->shards;
+    microswim_delta_t* deltas[IO_BATCH];
+    size_t total = 0;
+    size_t count;
+
+    do {
+        count = microswim_shards_receive(shards, deltas, IO_BATCH);
+        total += count;
+
+        microswim_io_cork(ms);
+        for (size_t i = 0; i < count; i++) {
+            microswim_datagram_t datagram = { .buffer = deltas[i]->buffer, .length = deltas[i]->length };
+            if (admit == NULL || admit(ms, &datagram, context)) {
+                microswim_message_delta_handle(ms, deltas[i], now, event_handler);
+            }
+        }
+        microswim_io_uncork(ms);
+
+        microswim_shards_recycle(shards);
+    } while (count == IO_BATCH);
+
+    return total;
+}
+
+/**
+ * @brief Handles every datagram waiting on the socket.
+ *
+ * The datagrams are received and handled in batches of up to IO_BATCH, on Linux with a single
+ * `recvmmsg` per batch, and the messages sent in response to a batch are flushed together.
+ * On an io_uring, the datagrams it has received already are handled in place. With receive
+ * workers, the messages they have decoded already are applied.
+ * Without the buffers of the batched I/O, the datagrams are received and handled one at a time.
+ * If `admit` is supplied, the datagrams it refuses are dropped unhandled. Every deadline they
+ * set is counted from `now`.
+ *
+ * @return The number of datagrams received, including the dropped ones.
+ */
+size_t microswim_io_receive(
+    microswim_t* ms, uint64_t now, microswim_io_admit_t admit, void* context,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t)) {
+    size_t total = 0;
+
+    if (ms->io == NULL) {
+        for (;;) {
+            unsigned char buffer[BUFFER_SIZE];
+            ssize_t bytes = recvfrom(ms->socket, buffer, BUFFER_SIZE - 1, MSG_DONTWAIT, NULL, NULL);
+            if (bytes <= 0) {
+                return total;
+            }
+
+            buffer[bytes] = '\0';
+            total++;
+
+            microswim_datagram_t datagram = { .buffer = buffer, .length = bytes };
+            if (admit == NULL || admit(ms, &datagram, context)) {
+                microswim_message_handle(ms, buffer, bytes, now, event_handler);
+            }
+        }
+    }
+
+    if (ms->io->shards != NULL) {
+        return microswim_io_apply(ms, now, admit, context, event_handler);
+    }
+
+    // NOTE: a batch which is not full means the socket has been drained.
+    microswim_uring_t* uring = ms->io->uring;
+    size_t count;
+    do {
+        count = (uring != NULL) ? microswim_uring_receive(uring, ms->io->datagrams, IO_BATCH) :
+                                  microswim_io_read(ms);
+        total += count;
+
+        size_t admitted = count;
+        if (admit != NULL) {
+            admitted = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (admit(ms, &ms->io->datagrams[i], context)) {
+                    ms->io->datagrams[admitted++] = ms->io->datagrams[i];
+                }
+            }
+        }
+
+        microswim_message_batch_handle(ms, ms->io->datagrams, admitted, now, event_handler);
+
+        if (uring != NULL) {
+            microswim_uring_recycle(uring);
+        }
+    } while (count == IO_BATCH);
+
+    return total;
+}
+
+#endif
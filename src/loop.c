@@ -0,0 +1,532 @@
+#include "loop.h"
+#include "arena.h"
+#include "change.h"
+#include "io.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "snapshot.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+#ifndef RIOT_OS
+
+// NOTE: Readiness reported per wait, whatever is left over is reported by the next one.
+#define LOOP_EVENTS 64
+
+// NOTE: Tags of the epoll entries which are not instances, whose tag is their position.
+#define LOOP_TAG_TIMER ((uint64_t)1 << 62)
+#define LOOP_TAG_WATCH ((uint64_t)1 << 63)
+
+static bool microswim_loop_earlier(microswim_loop_t* loop, size_t a, size_t b) {
+    return loop->instances[loop->heap[a]].deadline < loop->instances[loop->heap[b]].deadline;
+}
+
+static void microswim_loop_swap(microswim_loop_t* loop, size_t a, size_t b) {
+    size_t instance = loop->heap[a];
+    loop->heap[a] = loop->heap[b];
+    loop->heap[b] = instance;
+    loop->instances[loop->heap[a]].position = a;
+    loop->instances[loop->heap[b]].position = b;
+}
+
+static void microswim_loop_sift(microswim_loop_t* loop, size_t position) {
+    while (position > 0 && microswim_loop_earlier(loop, position, (position - 1) / 2)) {
+        microswim_loop_swap(loop, position, (position - 1) / 2);
+        position = (position - 1) / 2;
+    }
+
+    for (;;) {
+        size_t earliest = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < loop->instance_count && microswim_loop_earlier(loop, left, earliest)) {
+            earliest = left;
+        }
+        if (right < loop->instance_count && microswim_loop_earlier(loop, right, earliest)) {
+            earliest = right;
+        }
+        if (earliest == position) {
+            return;
+        }
+
+        microswim_loop_swap(loop, position, earliest);
+        position = earliest;
+    }
+}
+
+/**
+ * @brief Files the instance under its next deadline, which its work may have moved.
+ */
+static void microswim_loop_reschedule(microswim_loop_t* loop, size_t index) {
+    microswim_loop_instance_t* instance = &loop->instances[index];
+    instance->deadline = microswim_next_deadline(instance->ms);
+    microswim_loop_sift(loop, instance->position);
+}
+
+#ifdef __linux__
+static uint32_t microswim_loop_epoll_events(short events) {
+    uint32_t result = 0;
+    result |= (events & POLLIN) ? EPOLLIN : 0;
+    result |= (events & POLLOUT) ? EPOLLOUT : 0;
+    result |= (events & POLLPRI) ? EPOLLPRI : 0;
+
+    return result;
+}
+
+static short microswim_loop_poll_events(uint32_t events) {
+    short result = 0;
+    result |= (events & EPOLLIN) ? POLLIN : 0;
+    result |= (events & EPOLLOUT) ? POLLOUT : 0;
+    result |= (events & EPOLLPRI) ? POLLPRI : 0;
+    result |= (events & EPOLLERR) ? POLLERR : 0;
+    result |= (events & EPOLLHUP) ? POLLHUP : 0;
+
+    return result;
+}
+
+/**
+ * @brief Arms the timer for the earliest deadline of the instances, unless it is armed for it
+ * already.
+ *
+ * The timer is armed relative to `now`, which has to come from `microswim_milliseconds`.
+ */
+static void microswim_loop_arm(microswim_loop_t* loop, uint64_t now) {
+    if (loop->instance_count == 0) {
+        return;
+    }
+
+    uint64_t deadline = loop->instances[loop->heap[0]].deadline;
+    if (deadline == loop->deadline) {
+        return;
+    }
+
+    uint64_t wait = (deadline > now) ? deadline - now : 0;
+    struct itimerspec spec = { 0 };
+    spec.it_value.tv_sec = (time_t)(wait / 1000);
+    spec.it_value.tv_nsec = (long)(wait % 1000) * 1000000;
+    if (wait == 0) {
+        // NOTE: a zero expiration would disarm the timer instead.
+        spec.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(loop->timer, 0, &spec, NULL) != 0) {
+        MICROSWIM_LOG_ERROR("(microswim_loop_arm) timerfd_settime failed: %d %s", errno, strerror(errno));
+        return;
+    }
+
+    loop->deadline = deadline;
+}
+#endif
+
+static microswim_loop_watch_t* microswim_loop_find(microswim_loop_t* loop, int fd) {
+    for (size_t i = 0; i < loop->watch_count; i++) {
+        if (loop->watches[i].fd == fd) {
+            return &loop->watches[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Prepares the loop and adds `ms` to it, if supplied. Further instances are added with
+ * `microswim_loop_add`.
+ *
+ * `hooks` may be NULL if the host needs none.
+ *
+ * @return true on success, false if the epoll set or the timer could not be set up, or `ms`
+ * could not be added.
+ */
+bool microswim_loop_init(microswim_loop_t* loop, microswim_t* ms, const microswim_loop_hooks_t* hooks) {
+    memset(loop, 0, sizeof(*loop));
+    loop->ms = ms;
+    loop->epoll = -1;
+    loop->timer = -1;
+    if (hooks != NULL) {
+        loop->hooks = *hooks;
+    }
+
+#ifdef __linux__
+    loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+    loop->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->epoll < 0 || loop->timer < 0) {
+        MICROSWIM_LOG_ERROR("Unable to create the epoll set or the timer: %d %s", errno, strerror(errno));
+        microswim_loop_deinit(loop);
+        return false;
+    }
+
+    struct epoll_event timer_event = { .events = EPOLLIN, .data.u64 = LOOP_TAG_TIMER };
+    if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->timer, &timer_event) != 0) {
+        MICROSWIM_LOG_ERROR("Unable to watch the timer: %d %s", errno, strerror(errno));
+        microswim_loop_deinit(loop);
+        return false;
+    }
+#endif
+
+    // NOTE: without the buffers, the instances receive and send one datagram at a time.
+    loop->io = microswim_io_create(&loop->arena, true);
+
+    if (ms != NULL && !microswim_loop_add(loop, ms)) {
+        microswim_loop_deinit(loop);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Releases the epoll set, the timer, the I/O buffers and the tables of the loop. The
+ * instances, their sockets and the watched file descriptors are left to the host.
+ */
+void microswim_loop_deinit(microswim_loop_t* loop) {
+    for (size_t i = 0; i < loop->instance_count; i++) {
+        if (loop->instances[i].ms->io == loop->io) {
+            microswim_io_release(loop->instances[i].ms);
+        }
+    }
+
+    if (loop->timer >= 0) {
+        close(loop->timer);
+    }
+
+    if (loop->epoll >= 0) {
+        close(loop->epoll);
+    }
+
+    microswim_io_destroy(&loop->arena, loop->io);
+    microswim_arena_release(&loop->arena, loop->instances);
+    microswim_arena_release(&loop->arena, loop->heap);
+#ifndef __linux__
+    microswim_arena_release(&loop->arena, loop->fds);
+    loop->fds = NULL;
+    loop->fd_capacity = 0;
+#endif
+    loop->io = NULL;
+    loop->instances = NULL;
+    loop->heap = NULL;
+    loop->instance_count = 0;
+    loop->instance_capacity = 0;
+    loop->heap_capacity = 0;
+    loop->timer = -1;
+    loop->epoll = -1;
+    loop->watch_count = 0;
+}
+
+/**
+ * @brief Has the loop drive `ms`, whose socket has to be set up already.
+ *
+ * The socket is switched to non-blocking mode. An instance without buffers of the batched I/O
+ * borrows the loop's, one with buffers of its own has its I/O moved onto an io_uring where
+ * `microswim_io_uring_setup` manages to. The instance runs straight away.
+ *
+ * @return true if the loop drives the instance, false if it could not be added.
+ */
+bool microswim_loop_add(microswim_loop_t* loop, microswim_t* ms) {
+    size_t count = loop->instance_count + 1;
+    microswim_loop_instance_t* instances = microswim_arena_grow(
+        &loop->arena, loop->instances, &loop->instance_capacity, sizeof(*instances), count, SIZE_MAX);
+    if (instances == NULL) {
+        return false;
+    }
+    loop->instances = instances;
+
+    size_t* heap = microswim_arena_grow(
+        &loop->arena, loop->heap, &loop->heap_capacity, sizeof(*heap), count, SIZE_MAX);
+    if (heap == NULL) {
+        return false;
+    }
+    loop->heap = heap;
+
+#ifndef __linux__
+    struct pollfd* fds = microswim_arena_grow(
+        &loop->arena, loop->fds, &loop->fd_capacity, sizeof(*fds), count + LOOP_WATCHES, SIZE_MAX);
+    if (fds == NULL) {
+        return false;
+    }
+    loop->fds = fds;
+#endif
+
+    int flags = fcntl(ms->socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(ms->socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+        MICROSWIM_LOG_ERROR("Unable to make the socket non-blocking: %d %s", errno, strerror(errno));
+        return false;
+    }
+
+    microswim_io_lend(ms, loop->io);
+    microswim_io_uring_setup(ms);
+
+    size_t index = loop->instance_count;
+#ifdef __linux__
+    struct epoll_event event = { .events = EPOLLIN, .data.u64 = index };
+    if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, microswim_io_descriptor(ms), &event) != 0) {
+        MICROSWIM_LOG_ERROR("Unable to watch the socket: %d %s", errno, strerror(errno));
+        if (ms->io == loop->io) {
+            microswim_io_release(ms);
+        }
+        return false;
+    }
+#endif
+
+    loop->instances[index].ms = ms;
+    loop->instances[index].deadline = 0;
+    loop->instances[index].position = index;
+    loop->heap[index] = index;
+    loop->instance_count = count;
+    microswim_loop_sift(loop, index);
+
+    return true;
+}
+
+/**
+ * @brief Stops driving `ms`. It may be called from a hook, for any instance but the one the
+ * hook is called for.
+ *
+ * @return true if the loop drove the instance.
+ */
+bool microswim_loop_remove(microswim_loop_t* loop, microswim_t* ms) {
+    size_t index = 0;
+    while (index < loop->instance_count && loop->instances[index].ms != ms) {
+        index++;
+    }
+
+    if (index == loop->instance_count) {
+        return false;
+    }
+
+#ifdef __linux__
+    epoll_ctl(loop->epoll, EPOLL_CTL_DEL, microswim_io_descriptor(ms), NULL);
+#endif
+
+    // NOTE: the last entry of the heap takes the place of the removed one.
+    size_t position = loop->instances[index].position;
+    size_t last = --loop->instance_count;
+    if (position != last) {
+        microswim_loop_swap(loop, position, last);
+        microswim_loop_sift(loop, position);
+    }
+
+    // NOTE: the last instance takes the place of the removed one, which changes its tag.
+    if (index != last) {
+        loop->instances[index] = loop->instances[last];
+        loop->heap[loop->instances[index].position] = index;
+#ifdef __linux__
+        struct epoll_event event = { .events = EPOLLIN, .data.u64 = index };
+        epoll_ctl(loop->epoll, EPOLL_CTL_MOD, microswim_io_descriptor(loop->instances[index].ms), &event);
+#endif
+    }
+
+    if (loop->ms == ms) {
+        loop->ms = NULL;
+    }
+
+    if (ms->io == loop->io) {
+        microswim_io_release(ms);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Calls `callback` whenever `fd` is ready for any of the poll(2) `events`.
+ *
+ * @return true if the file descriptor is watched, false if LOOP_WATCHES are watched already
+ * or it could not be added to the epoll set.
+ */
+bool microswim_loop_watch(
+    microswim_loop_t* loop, int fd, short events, microswim_loop_callback_t callback, void* context) {
+    if (loop->watch_count == LOOP_WATCHES || microswim_loop_find(loop, fd) != NULL) {
+        MICROSWIM_LOG_ERROR("Unable to watch the file descriptor %d", fd);
+        return false;
+    }
+
+#ifdef __linux__
+    struct epoll_event event = {
+        .events = microswim_loop_epoll_events(events), .data.u64 = LOOP_TAG_WATCH | (uint32_t)fd
+    };
+    if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        MICROSWIM_LOG_ERROR("Unable to watch the file descriptor %d: %d %s", fd, errno, strerror(errno));
+        return false;
+    }
+#endif
+
+    microswim_loop_watch_t* watch = &loop->watches[loop->watch_count++];
+    watch->fd = fd;
+    watch->events = events;
+    watch->callback = callback;
+    watch->context = context;
+
+    return true;
+}
+
+/**
+ * @brief Stops watching `fd`. It may be called from the file descriptor's own callback.
+ *
+ * @return true if the file descriptor was watched.
+ */
+bool microswim_loop_unwatch(microswim_loop_t* loop, int fd) {
+    microswim_loop_watch_t* watch = microswim_loop_find(loop, fd);
+    if (watch == NULL) {
+        return false;
+    }
+
+#ifdef __linux__
+    epoll_ctl(loop->epoll, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
+    *watch = loop->watches[--loop->watch_count];
+    return true;
+}
+
+/**
+ * @brief Runs the instance's timers and, if a protocol period is due, its next round.
+ */
+static void microswim_loop_tick(microswim_loop_t* loop, size_t index, uint64_t now) {
+    microswim_t* ms = loop->instances[index].ms;
+
+    if (loop->hooks.round != NULL && ms->protocol_deadline <= now) {
+        loop->hooks.round(ms, loop->hooks.context);
+    }
+
+    microswim_tick(ms, now);
+    microswim_snapshot_publish(ms);
+    microswim_changes_dispatch(ms);
+
+    if (loop->hooks.idle != NULL) {
+        loop->hooks.idle(ms, loop->hooks.context);
+    }
+
+    microswim_loop_reschedule(loop, index);
+}
+
+/**
+ * @brief Handles the datagrams waiting for the instance.
+ */
+static void microswim_loop_receive(microswim_loop_t* loop, size_t index, uint64_t now) {
+    microswim_t* ms = loop->instances[index].ms;
+
+    microswim_io_receive(
+        ms, now, loop->hooks.admit, loop->hooks.context, loop->hooks.event_handler);
+    microswim_snapshot_publish(ms);
+    microswim_changes_dispatch(ms);
+
+    if (loop->hooks.idle != NULL) {
+        loop->hooks.idle(ms, loop->hooks.context);
+    }
+
+    microswim_loop_reschedule(loop, index);
+}
+
+static void microswim_loop_notify(microswim_loop_t* loop, int fd, short events) {
+    // NOTE: the file descriptor may have been unwatched by an earlier callback.
+    microswim_loop_watch_t* watch = microswim_loop_find(loop, fd);
+    if (watch != NULL) {
+        watch->callback(loop, fd, events, watch->context);
+    }
+}
+
+/**
+ * @brief Runs the instances whose deadline is due, then sleeps until the next deadline or
+ * until a socket or a watched file descriptor is ready, and handles whatever woke it up.
+ */
+void microswim_loop_run_once(microswim_loop_t* loop) {
+    uint64_t now = microswim_milliseconds();
+
+    // NOTE: every instance runs at most once per pass, so that none can starve the others.
+    for (size_t runs = loop->instance_count; runs > 0 && loop->instance_count > 0; runs--) {
+        size_t index = loop->heap[0];
+        if (loop->instances[index].deadline > now) {
+            break;
+        }
+
+        microswim_loop_tick(loop, index, now);
+    }
+
+#ifdef __linux__
+    microswim_loop_arm(loop, now);
+
+    struct epoll_event events[LOOP_EVENTS];
+    int count = epoll_wait(loop->epoll, events, LOOP_EVENTS, -1);
+    if (count < 0 && errno != EINTR) {
+        MICROSWIM_LOG_ERROR("(microswim_loop_run_once) epoll_wait failed: %d %s", errno, strerror(errno));
+    }
+
+    now = microswim_milliseconds();
+
+    for (int i = 0; i < count; i++) {
+        uint64_t tag = events[i].data.u64;
+        if (tag == LOOP_TAG_TIMER) {
+            uint64_t expirations;
+            if (read(loop->timer, &expirations, sizeof(expirations)) > 0) {
+                loop->deadline = 0;
+            }
+        } else if (tag & LOOP_TAG_WATCH) {
+            microswim_loop_notify(loop, (int)(uint32_t)tag, microswim_loop_poll_events(events[i].events));
+        } else if (tag < loop->instance_count) {
+            // NOTE: an instance removed by an earlier hook may have handed its tag on.
+            microswim_loop_receive(loop, (size_t)tag, now);
+        }
+    }
+#else
+    int timeout = -1;
+    if (loop->instance_count > 0) {
+        uint64_t deadline = loop->instances[loop->heap[0]].deadline;
+        uint64_t wait = (deadline > now) ? deadline - now : 0;
+        timeout = (wait < INT_MAX) ? (int)wait : INT_MAX;
+    }
+
+    struct pollfd* fds = loop->fds;
+    size_t instance_count = loop->instance_count;
+    nfds_t fd_count = 0;
+    for (size_t i = 0; i < instance_count; i++) {
+        fds[fd_count++] =
+            (struct pollfd){ .fd = microswim_io_descriptor(loop->instances[i].ms), .events = POLLIN };
+    }
+    for (size_t i = 0; i < loop->watch_count; i++) {
+        fds[fd_count++] = (struct pollfd){ .fd = loop->watches[i].fd, .events = loop->watches[i].events };
+    }
+
+    int count = poll(fds, fd_count, timeout);
+    if (count < 0 && errno != EINTR) {
+        MICROSWIM_LOG_ERROR("(microswim_loop_run_once) poll failed: %d %s", errno, strerror(errno));
+    }
+
+    now = microswim_milliseconds();
+
+    for (nfds_t i = 0; count > 0 && i < fd_count; i++) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+
+        if (i >= instance_count) {
+            microswim_loop_notify(loop, fds[i].fd, fds[i].revents);
+        } else if (i < loop->instance_count) {
+            microswim_loop_receive(loop, i, now);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Drives the instances until `microswim_loop_stop` is called, from a hook or a callback.
+ */
+void microswim_loop_run(microswim_loop_t* loop) {
+    loop->running = true;
+    while (loop->running) {
+        microswim_loop_run_once(loop);
+    }
+}
+
+void microswim_loop_stop(microswim_loop_t* loop) {
+    loop->running = false;
+}
+
+#endif
@@ -1,13 +1,18 @@
 #include "member.h"
+#include "arena.h"
+#include "change.h"
 #include "constants.h"
-#include "encode.h"
+#include "hash.h"
 #include "message.h"
 #include "microswim.h"
 #include "microswim_log.h"
 #include "ping.h"
+#include "record.h"
+#include "rng.h"
+#include "slab.h"
+#include "timer.h"
 #include "update.h"
 #include "utils.h"
-#include <stdlib.h>
 
 /**
  * @brief Returns a pointer to the next member in a round-robin sequence.
@@ -26,6 +31,11 @@ microswim_member_t* microswim_member_retrieve(microswim_t* ms) {
         return NULL;
     }
 
+    // NOTE: the member array may have shrunk since the last call.
+    if (ms->round_robin_index >= ms->member_count) {
+        ms->round_robin_index = 0;
+    }
+
     size_t original_index = ms->round_robin_index;
 
     while (1) {
@@ -40,7 +50,7 @@ microswim_member_t* microswim_member_retrieve(microswim_t* ms) {
             microswim_indices_shuffle(ms);
         }
 
-        if (strncmp((char*)ms->self.uuid, (char*)member->uuid, UUID_SIZE) != 0) {
+        if (!microswim_id_equal(&ms->self.uuid, &member->uuid)) {
             return member;
         }
 
@@ -52,6 +62,83 @@ microswim_member_t* microswim_member_retrieve(microswim_t* ms) {
     }
 }
 
+/**
+ * @brief Makes room for `count` members.
+ *
+ * Grows the central member array together with the round-robin indices and the hash
+ * index. The other tables refer to members by handle, so the array is free to move.
+ *
+ * @return true if the array can hold `count` members, false otherwise.
+ */
+bool microswim_members_reserve(microswim_t* ms, size_t count) {
+    if (count <= ms->member_capacity) {
+        return true;
+    }
+
+    size_t index_capacity = ms->index_capacity;
+    size_t* indices = microswim_arena_grow(
+        &ms->arena, ms->indices, &index_capacity, sizeof(size_t), count,
+        ms->config.maximum_members);
+    if (indices == NULL) {
+        return false;
+    }
+
+    ms->indices = indices;
+    ms->index_capacity = index_capacity;
+
+    microswim_member_t* members = microswim_arena_grow(
+        &ms->arena, ms->members, &ms->member_capacity, sizeof(microswim_member_t), count,
+        ms->config.maximum_members);
+    if (members == NULL) {
+        return false;
+    }
+
+    ms->members = members;
+
+    return microswim_hash_reserve(ms);
+}
+
+/**
+ * @brief Makes room for `count` confirmed members.
+ *
+ * @return true if the array can hold `count` confirmed members, false otherwise.
+ */
+bool microswim_confirmed_reserve(microswim_t* ms, size_t count) {
+    if (count <= ms->confirmed_capacity) {
+        return true;
+    }
+
+    microswim_member_t* confirmed = microswim_arena_grow(
+        &ms->arena, ms->confirmed, &ms->confirmed_capacity, sizeof(microswim_member_t), count,
+        ms->config.maximum_members);
+    if (confirmed == NULL) {
+        return false;
+    }
+
+    ms->confirmed = confirmed;
+
+    return microswim_hash_reserve(ms);
+}
+
+/**
+ * @brief Keeps the suspicion timer of the member in line with its status and timeout.
+ *
+ * Only the suspect members of the central member array have a suspicion timer.
+ */
+static void microswim_member_suspicion_update(microswim_t* ms, microswim_member_t* member) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot == NULL) {
+        return;
+    }
+
+    if (slot->table == SLAB_MEMBERS && member->status == SUSPECT) {
+        microswim_timer_schedule(
+            ms, slot->timer, TIMER_SUSPICION, member->handle.slot, member->timeout);
+    } else {
+        microswim_timer_cancel(ms, slot->timer);
+    }
+}
+
 /**
  * @brief Adds a member to the central member array.
  *
@@ -61,22 +148,64 @@ microswim_member_t* microswim_member_retrieve(microswim_t* ms) {
  *
  * @return A pointer to the added member, or NULL if the member cannot be added due to the limit of the array.
  */
-microswim_member_t* microswim_member_add(microswim_t* ms, microswim_member_t member) {
-    if (ms->member_count > MAXIMUM_MEMBERS) {
-        MICROSWIM_LOG_ERROR("Cannot add more than %d members\n", MAXIMUM_MEMBERS);
+microswim_member_t* microswim_member_add(microswim_t* ms, microswim_member_t member, uint64_t now) {
+    if (!microswim_members_reserve(ms, ms->member_count + 1)) {
+        MICROSWIM_LOG_ERROR("Cannot add more than %zu members\n", ms->member_capacity);
+        return NULL;
+    }
+
+    microswim_handle_t handle = microswim_slab_acquire(ms, SLAB_MEMBERS, ms->member_count);
+    if (handle.generation == 0) {
         return NULL;
     }
 
-    microswim_member_t* slot = &ms->members[ms->member_count++];
-    strncpy((char*)slot->uuid, (char*)member.uuid, UUID_SIZE);
+    microswim_member_t* slot = &ms->members[ms->member_count];
+    slot->uuid = member.uuid;
     slot->addr = member.addr;
     slot->incarnation = member.incarnation;
     slot->status = member.status;
-    slot->timeout = (microswim_milliseconds() + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+    slot->handle = handle;
+    slot->timeout = (now + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+
+    // NOTE: the member is visited last until `microswim_index_add` moves its entry.
+    ms->indices[ms->member_count] = ms->member_count;
+    ms->slots[handle.slot].order = ms->member_count;
+    microswim_member_suspicion_update(ms, slot);
+
+    if (microswim_id_is_nil(&slot->uuid)) {
+        ms->anonymous_count++;
+    } else {
+        microswim_hash_entry_t* entry = microswim_hash_insert(ms, &slot->uuid);
+        if (entry != NULL) {
+            entry->slot = handle.slot;
+        }
+    }
+
+    ms->member_count++;
+    ms->revision++;
+    microswim_change_append(ms, CHANGE_JOINED, slot);
 
     return slot;
 }
 
+/**
+ * @brief Indexes a member whose UUID has just become known.
+ *
+ * The member is queued for dissemination from now on, since it could not be told apart
+ * by the other members while it had no UUID.
+ */
+static void microswim_member_name(microswim_t* ms, size_t index) {
+    microswim_hash_entry_t* entry = microswim_hash_insert(ms, &ms->members[index].uuid);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->slot = ms->members[index].handle.slot;
+    microswim_update_add(ms, &ms->members[index]);
+    ms->revision++;
+    microswim_change_append(ms, CHANGE_JOINED, &ms->members[index]);
+}
+
 /**
  * @brief Searches for a member from the central member array.
  *
@@ -85,19 +214,37 @@ microswim_member_t* microswim_member_add(microswim_t* ms, microswim_member_t mem
  * parameter. (it can happen during the launch because initially, we supply only the address and
  * port and the UUID is only generated by the node itself)
  *
+ * Members with a known UUID are looked up through the hash index. The members without a UUID
+ * are only scanned when the index has no match and there are such members left.
+ *
  * @return A pointer to the found member, or NULL if the member was not found.
  */
 microswim_member_t* microswim_member_find(microswim_t* ms, microswim_member_t* member) {
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+    if (entry != NULL && entry->slot != HASH_INDEX_NONE &&
+        ms->slots[entry->slot].table == SLAB_MEMBERS) {
+        return &ms->members[ms->slots[entry->slot].position];
+    }
+
+    if (ms->anonymous_count == 0) {
+        return NULL;
+    }
+
     for (size_t i = 0; i < ms->member_count; i++) {
-        if (ms->members[i].uuid[0] == '\0') {
-            int c = microswim_member_address_compare(&ms->members[i], member);
-            if (c == (SIN_FAMILY | SIN_PORT | SIN_ADDR)) {
-                MICROSWIM_LOG_DEBUG("Updated member's UUID");
-                strncpy((char*)ms->members[i].uuid, (char*)member->uuid, UUID_SIZE);
-            }
+        if (!microswim_id_is_nil(&ms->members[i].uuid)) {
+            continue;
+        }
+
+        if (microswim_id_is_nil(&member->uuid)) {
+            return &ms->members[i];
         }
 
-        if (strncmp((char*)member->uuid, (char*)ms->members[i].uuid, UUID_SIZE) == 0) {
+        int c = microswim_member_address_compare(&ms->members[i], member);
+        if (c == (SIN_FAMILY | SIN_PORT | SIN_ADDR)) {
+            MICROSWIM_LOG_DEBUG("Updated member's UUID");
+            ms->members[i].uuid = member->uuid;
+            ms->anonymous_count--;
+            microswim_member_name(ms, i);
             return &ms->members[i];
         }
     }
@@ -111,52 +258,77 @@ microswim_member_t* microswim_member_find(microswim_t* ms, microswim_member_t* m
  * @return A pointer to the found member, or NULL if the member was not found.
  */
 microswim_member_t* microswim_member_confirmed_find(microswim_t* ms, microswim_member_t* member) {
-    for (size_t i = 0; i < ms->confirmed_count; i++) {
-        if (strncmp((char*)member->uuid, (char*)ms->confirmed[i].uuid, UUID_SIZE) == 0) {
-            return &ms->confirmed[i];
-        }
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+    if (entry != NULL && entry->slot != HASH_INDEX_NONE &&
+        ms->slots[entry->slot].table == SLAB_CONFIRMED) {
+        return &ms->confirmed[ms->slots[entry->slot].position];
     }
 
     return NULL;
 }
 
 /**
- * @brief Shifts the central member array.
+ * @brief Removes the member at `index` from the member or the confirmed member array.
  *
- * Shifts the central member array after the member is moved to the confirmed member array.
- * Additionally, the member's pointer in the central updates array is updated as well.
+ * The last member of the array is moved into the gap, and only its slot and its round-robin
+ * entry have to be updated, since everything else refers to members by handle.
  */
-void microswim_members_shift(microswim_t* ms, size_t index) {
-    for (size_t i = index; i < ms->member_count - 1; i++) {
-        microswim_update_t* update = microswim_update_find(ms, &ms->members[i + 1]);
-        ms->members[i] = ms->members[i + 1];
-        if (update != NULL) {
-            update->member = &ms->members[i];
+static void
+    microswim_members_swap_remove(microswim_t* ms, microswim_slab_table_t table, size_t index) {
+    if (table == SLAB_CONFIRMED) {
+        size_t last = ms->confirmed_count - 1;
+        if (index != last) {
+            ms->confirmed[index] = ms->confirmed[last];
+            microswim_slab_relocate(ms, ms->confirmed[index].handle, table, index);
         }
+
+        ms->confirmed_count--;
+        return;
+    }
+
+    size_t last = ms->member_count - 1;
+    size_t order = ms->slots[ms->members[index].handle.slot].order;
+
+    if (microswim_id_is_nil(&ms->members[index].uuid)) {
+        ms->anonymous_count--;
+    }
+
+    if (index != last) {
+        ms->members[index] = ms->members[last];
+        microswim_slab_relocate(ms, ms->members[index].handle, table, index);
+        ms->indices[ms->slots[ms->members[index].handle.slot].order] = index;
     }
 
     ms->member_count--;
+    microswim_index_remove(ms, order);
 }
 
 /**
  * @brief Updates the member.
  */
-void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_member_t* nw) {
+void microswim_member_update(
+    microswim_t* ms, microswim_member_t* ex, microswim_member_t* nw, uint64_t now) {
+    microswim_member_status_t status = ex->status;
+
     // NOTE: this should probably move somewhere else.
-    if (strncmp((char*)ms->self.uuid, (char*)nw->uuid, UUID_SIZE) == 0 && (nw->status == SUSPECT)) {
+    if (microswim_id_equal(&ms->self.uuid, &nw->uuid) && (nw->status == SUSPECT)) {
         // TODO: check all the ms->self references.
         ms->self.incarnation = nw->incarnation + 1;
         ms->self.status = ALIVE;
         ex->incarnation = nw->incarnation + 1;
         ex->status = ALIVE;
+        microswim_member_suspicion_update(ms, ex);
+        microswim_update_add(ms, ex);
+        ms->revision++;
+        if (status != ALIVE) {
+            microswim_change_append(ms, CHANGE_ALIVE, ex);
+        }
 
         microswim_message_t message = { 0 };
         microswim_status_message_construct(ms, &message, ALIVE_MESSAGE, ex);
         microswim_member_t* recipient = microswim_member_retrieve(ms);
         if (recipient != NULL) {
-            unsigned char buffer[BUFFER_SIZE] = { 0 };
-            size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-            microswim_message_send(ms, recipient, (const char*)buffer, length);
+            microswim_message_send(ms, recipient, &message);
         }
 
         return;
@@ -170,10 +342,16 @@ void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_
             (ex->status == ALIVE && nw->incarnation > ex->incarnation)) {
             ex->status = nw->status;
             ex->incarnation = nw->incarnation;
-            ex->timeout = (microswim_milliseconds() + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+            ex->timeout = (now + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+            microswim_member_suspicion_update(ms, ex);
+            microswim_update_add(ms, ex);
+            ms->revision++;
+            if (status != ALIVE) {
+                microswim_change_append(ms, CHANGE_ALIVE, ex);
+            }
 
             microswim_member_t member = { 0 };
-            strncpy((char*)member.uuid, (char*)ex->uuid, UUID_SIZE);
+            member.uuid = ex->uuid;
             microswim_ping_t* ping = microswim_ping_find(ms, &member);
             if (ping != NULL) {
                 microswim_ping_remove(ms, ping);
@@ -189,10 +367,16 @@ void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_
             (ex->status == ALIVE && nw->incarnation >= ex->incarnation)) {
             ex->status = nw->status;
             ex->incarnation = nw->incarnation;
-            ex->timeout = (microswim_milliseconds() + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+            ex->timeout = (now + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+            microswim_member_suspicion_update(ms, ex);
+            microswim_update_add(ms, ex);
+            ms->revision++;
+            if (status != SUSPECT) {
+                microswim_change_append(ms, CHANGE_SUSPECT, ex);
+            }
 
             microswim_member_t member = { 0 };
-            strncpy((char*)member.uuid, (char*)ex->uuid, UUID_SIZE);
+            member.uuid = ex->uuid;
             microswim_ping_t* ping = microswim_ping_find(ms, &member);
             if (ping != NULL) {
                 microswim_ping_remove(ms, ping);
@@ -209,14 +393,13 @@ void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_
             ex->incarnation = nw->incarnation;
 
             microswim_member_t member = { 0 };
-            strncpy((char*)member.uuid, (char*)ex->uuid, UUID_SIZE);
+            member.uuid = ex->uuid;
             microswim_ping_t* ping = microswim_ping_find(ms, &member);
             if (ping != NULL) {
                 microswim_ping_remove(ms, ping);
             }
 
             microswim_member_mark_confirmed(ms, ex);
-            microswim_index_remove(ms);
         }
     }
 }
@@ -224,47 +407,106 @@ void microswim_member_update(microswim_t* ms, microswim_member_t* ex, microswim_
 /**
  * @brief Moves the member to the confirmed member array.
  *
+ * The member keeps its handle, so the updates, pings and ping-reqs referring to it
+ * stay valid.
+ *
  * @return A pointer to the moved member or if no member was moved, the functions returns NULL.
  */
 microswim_member_t* microswim_member_move(microswim_t* ms, microswim_member_t* member) {
-    int index = -1;
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot == NULL || slot->table != SLAB_MEMBERS || &ms->members[slot->position] != member) {
+        return NULL;
+    }
 
-    for (size_t i = 0; i < ms->member_count; i++) {
-        if (&ms->members[i] == member) {
-            index = i;
-            break;
-        }
+    if (!microswim_confirmed_reserve(ms, ms->confirmed_count + 1)) {
+        MICROSWIM_LOG_ERROR("Cannot add more than %zu members\n", ms->confirmed_capacity);
+        return NULL;
     }
 
-    if (index >= 0) {
-        microswim_ping_t* ping = microswim_ping_find(ms, member);
-        if (ping != NULL) {
-            microswim_ping_remove(ms, ping);
-        }
+    microswim_ping_t* ping = microswim_ping_find(ms, member);
+    if (ping != NULL) {
+        microswim_ping_remove(ms, ping);
+    }
 
-        ms->confirmed[ms->confirmed_count] = ms->members[index];
+    microswim_timer_cancel(ms, slot->timer);
 
-        microswim_update_t* update = microswim_update_find(ms, &ms->members[index]);
-        if (update != NULL) {
-            update->member = &ms->confirmed[ms->confirmed_count];
-        }
+    size_t index = slot->position;
+    ms->confirmed[ms->confirmed_count] = *member;
+    microswim_slab_relocate(ms, member->handle, SLAB_CONFIRMED, ms->confirmed_count);
+    microswim_members_swap_remove(ms, SLAB_MEMBERS, index);
 
-        microswim_members_shift(ms, index);
+    return &ms->confirmed[ms->confirmed_count++];
+}
 
-        return &ms->confirmed[ms->confirmed_count++];
+/**
+ * @brief Removes the member from the member or the confirmed member array.
+ *
+ * The ping and the update referencing the member are removed along with it. Its slot is
+ * released, so any handle still referring to the member becomes stale.
+ *
+ * @return A pointer to the member that took the place of the removed one, or NULL if there is none.
+ */
+microswim_member_t* microswim_member_remove(microswim_t* ms, microswim_member_t* member) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot == NULL) {
+        return NULL;
     }
 
-    return NULL;
+    microswim_slab_table_t table = slot->table;
+    size_t index = slot->position;
+    microswim_member_t* array = (table == SLAB_MEMBERS) ? ms->members : ms->confirmed;
+    if (&array[index] != member) {
+        return NULL;
+    }
+
+    microswim_ping_t* ping = microswim_ping_find(ms, member);
+    if (ping != NULL) {
+        microswim_ping_remove(ms, ping);
+    }
+
+    microswim_update_t* update = microswim_update_find(ms, member);
+    if (update != NULL) {
+        microswim_update_remove(ms, update);
+    }
+
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+    if (entry != NULL) {
+        entry->slot = HASH_INDEX_NONE;
+        microswim_hash_release(ms, entry);
+    }
+
+    microswim_timer_cancel(ms, slot->timer);
+
+    ms->revision++;
+    microswim_change_append(ms, CHANGE_REMOVED, member);
+
+    microswim_handle_t handle = member->handle;
+    microswim_members_swap_remove(ms, table, index);
+    microswim_slab_release(ms, handle);
+
+    if (table == SLAB_MEMBERS) {
+        return (index < ms->member_count) ? &ms->members[index] : NULL;
+    }
+
+    return (index < ms->confirmed_count) ? &ms->confirmed[index] : NULL;
 }
 
 /**
  * @brief Marks the member alive and issues a status message in case the member was marked as suspect.
  */
-void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member) {
+void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member, uint64_t now) {
     microswim_member_status_t status = member->status;
     member->status = ALIVE;
-    member->timeout = (microswim_milliseconds() + (uint64_t)(SUSPECT_TIMEOUT * 1000));
-    MICROSWIM_LOG_DEBUG("Member: %s was marked alive", member->uuid);
+    member->timeout = (now + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+    microswim_member_suspicion_update(ms, member);
+    if (status != ALIVE) {
+        microswim_update_add(ms, member);
+        ms->revision++;
+        microswim_change_append(ms, CHANGE_ALIVE, member);
+    }
+    char uuid[UUID_SIZE];
+    microswim_id_format(&member->uuid, uuid);
+    MICROSWIM_LOG_DEBUG("Member: %s was marked alive", uuid);
 
     if (status == SUSPECT) {
         microswim_message_t message = { 0 };
@@ -272,9 +514,7 @@ void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member) {
 
         microswim_member_t* recipient = microswim_member_retrieve(ms);
         if (recipient != NULL) {
-            unsigned char buffer[BUFFER_SIZE] = { 0 };
-            size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-            microswim_message_send(ms, recipient, (const char*)buffer, length);
+            microswim_message_send(ms, recipient, &message);
         }
     }
 }
@@ -282,20 +522,24 @@ void microswim_member_mark_alive(microswim_t* ms, microswim_member_t* member) {
 /**
  * @brief Marks the member as suspect and issues a status message in case the member was marked as alive.
  */
-void microswim_member_mark_suspect(microswim_t* ms, microswim_member_t* member) {
+void microswim_member_mark_suspect(microswim_t* ms, microswim_member_t* member, uint64_t now) {
     if (member->status == ALIVE) {
         member->status = SUSPECT;
-        member->timeout = (microswim_milliseconds() + (uint64_t)(SUSPECT_TIMEOUT * 1000));
-        MICROSWIM_LOG_DEBUG("Member: %s was marked suspect", member->uuid);
+        member->timeout = (now + (uint64_t)(SUSPECT_TIMEOUT * 1000));
+        microswim_member_suspicion_update(ms, member);
+        microswim_update_add(ms, member);
+        ms->revision++;
+        microswim_change_append(ms, CHANGE_SUSPECT, member);
+        char uuid[UUID_SIZE];
+        microswim_id_format(&member->uuid, uuid);
+        MICROSWIM_LOG_DEBUG("Member: %s was marked suspect", uuid);
 
         microswim_message_t message = { 0 };
         microswim_status_message_construct(ms, &message, SUSPECT_MESSAGE, member);
 
         microswim_member_t* recipient = microswim_member_retrieve(ms);
         if (recipient != NULL) {
-            unsigned char buffer[BUFFER_SIZE] = { 0 };
-            size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-            microswim_message_send(ms, recipient, (const char*)buffer, length);
+            microswim_message_send(ms, recipient, &message);
         }
     }
 }
@@ -305,23 +549,30 @@ void microswim_member_mark_suspect(microswim_t* ms, microswim_member_t* member)
  */
 void microswim_member_mark_confirmed(microswim_t* ms, microswim_member_t* member) {
     member->status = CONFIRMED;
-    MICROSWIM_LOG_DEBUG("Member: %s was marked confirmed", member->uuid);
+    char uuid[UUID_SIZE];
+    microswim_id_format(&member->uuid, uuid);
+    MICROSWIM_LOG_DEBUG("Member: %s was marked confirmed", uuid);
 
     microswim_ping_t* ping = microswim_ping_find(ms, member);
     if (ping != NULL) {
         microswim_ping_remove(ms, ping);
     }
 
-    microswim_member_move(ms, member);
+    // NOTE: the member lives in the confirmed member array from now on.
+    microswim_member_t* moved = microswim_member_move(ms, member);
+    if (moved != NULL) {
+        member = moved;
+    }
+    microswim_update_add(ms, member);
+    ms->revision++;
+    microswim_change_append(ms, CHANGE_CONFIRMED, member);
 
     microswim_message_t message = { 0 };
     microswim_status_message_construct(ms, &message, CONFIRM_MESSAGE, member);
 
     microswim_member_t* recipient = microswim_member_retrieve(ms);
     if (recipient != NULL) {
-        unsigned char buffer[BUFFER_SIZE] = { 0 };
-        size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-        microswim_message_send(ms, recipient, (const char*)buffer, length);
+        microswim_message_send(ms, recipient, &message);
     }
 }
 
@@ -361,100 +612,127 @@ size_t microswim_member_address_compare(microswim_member_t* a, microswim_member_
  * @return A pointer to the member added to the confirmed member array.
  */
 microswim_member_t* microswim_member_confirmed_add(microswim_t* ms, microswim_member_t member) {
-    if (ms->confirmed_count > MAXIMUM_MEMBERS) {
-        MICROSWIM_LOG_ERROR("Cannot add more than %d members\n", MAXIMUM_MEMBERS);
+    if (!microswim_confirmed_reserve(ms, ms->confirmed_count + 1)) {
+        MICROSWIM_LOG_ERROR("Cannot add more than %zu members\n", ms->confirmed_capacity);
         return NULL;
     }
 
-    microswim_member_t* slot = &ms->confirmed[ms->confirmed_count++];
-    strncpy((char*)slot->uuid, (char*)member.uuid, UUID_SIZE);
+    microswim_handle_t handle = microswim_slab_acquire(ms, SLAB_CONFIRMED, ms->confirmed_count);
+    if (handle.generation == 0) {
+        return NULL;
+    }
+
+    microswim_member_t* slot = &ms->confirmed[ms->confirmed_count];
+    slot->uuid = member.uuid;
     slot->addr = member.addr;
     slot->incarnation = member.incarnation;
     slot->status = member.status;
+    slot->handle = handle;
     slot->timeout = 0;
 
+    microswim_hash_entry_t* entry = microswim_hash_insert(ms, &slot->uuid);
+    if (entry != NULL) {
+        entry->slot = handle.slot;
+    }
+
+    ms->confirmed_count++;
+    ms->revision++;
+    microswim_change_append(ms, CHANGE_JOINED, slot);
+
     return slot;
 }
 
 /**
  * @brief Retrieves candidate members for the PING_REQ.
  *
+ * The candidates are taken from a random point of the round-robin sequence, which is
+ * itself a random permutation of the members. The node itself is skipped.
+ *
  * @return A number of members that will be used for indirect pings.
  */
 size_t microswim_get_ping_req_candidates(microswim_t* ms, size_t members[FAILURE_DETECTION_GROUP]) {
     size_t member_count = 0;
-    for (size_t i = 0; (i < ms->member_count - 1 && i < FAILURE_DETECTION_GROUP); i++) {
-        bool exists = false;
-        while (!exists) {
-            size_t index = rand() % (ms->member_count - 1) + 1;
-
-            for (size_t j = 0; j <= member_count; j++) {
-                if (index == members[j]) {
-                    exists = true;
-                    break;
-                }
-            }
-
-            if (!exists) {
-                members[member_count++] = index;
-                break;
-            }
+    if (ms->member_count == 0) {
+        return member_count;
+    }
 
-            exists = false;
+    size_t start = microswim_rng_bounded(ms, ms->member_count);
+    for (size_t i = 0; (i < ms->member_count && member_count < FAILURE_DETECTION_GROUP); i++) {
+        size_t index = ms->indices[(start + i) % ms->member_count];
+        if (microswim_id_equal(&ms->members[index].uuid, &ms->self.uuid)) {
+            continue;
         }
+
+        members[member_count++] = index;
     }
 
     return member_count;
 }
 
 /**
- * @brief
+ * @brief Applies the update record to the member tables.
+ *
+ * The record is widened into a member first, so that it can be stored as is.
  */
-void microswim_members_check(microswim_t* ms, microswim_member_t* member) {
+void microswim_members_check(
+    microswim_t* ms, const microswim_update_record_t* record, uint64_t now) {
+    microswim_member_t update = { 0 };
+    microswim_record_to_member(record, &update);
+    microswim_member_t* member = &update;
+
     microswim_member_t* existing_member = microswim_member_find(ms, member);
     microswim_member_t* confirmed_member = microswim_member_confirmed_find(ms, member);
 
     if (existing_member == NULL && confirmed_member == NULL) {
         // Member is not found in either list, add it to the appropriate list
         if (member->status == CONFIRMED) {
-            MICROSWIM_LOG_DEBUG("Added member: %s to confirmed list.", member->uuid);
+            char uuid[UUID_SIZE];
+            microswim_id_format(&member->uuid, uuid);
+            MICROSWIM_LOG_DEBUG("Added member: %s to confirmed list.", uuid);
             microswim_member_t* new_member = microswim_member_confirmed_add(ms, *member);
             if (new_member != NULL) {
                 microswim_update_add(ms, new_member);
             }
         } else {
-            microswim_member_t* new_member = microswim_member_add(ms, *member);
+            microswim_member_t* new_member = microswim_member_add(ms, *member, now);
             if (new_member != NULL) {
                 microswim_index_add(ms);
                 microswim_update_add(ms, new_member);
             }
         }
     } else if (existing_member != NULL) {
-        // Member exists in the regular list
-        microswim_member_update(ms, existing_member, member);
-        if (member->status != CONFIRMED) {
-            microswim_update_t* update = microswim_update_find(ms, existing_member);
-            if (existing_member->uuid[0] != '\0' && update == NULL) {
-                microswim_update_add(ms, existing_member);
-            }
-        }
+        // Member exists in the regular list, its update is queued again if its state changed
+        microswim_member_update(ms, existing_member, member, now);
     }
 }
 
 /**
- * @brief Checks the suspected members and moves to confirmed if the timeout value is exceeded.
+ * @brief Handles the suspicion timer of the member in the slot.
+ *
+ * The suspect member is marked as confirmed, unless it has been confirmed already.
  */
-void microswim_members_check_suspects(microswim_t* ms) {
-    for (size_t i = 0; i < ms->member_count; i++) {
-        if (ms->members[i].status == SUSPECT) {
-            if (ms->members[i].timeout < microswim_milliseconds()) {
-                microswim_member_t* confirmed = microswim_member_confirmed_find(ms, &ms->members[i]);
-                // BUG: What should happen if confirmed is found?
-                if (!confirmed) {
-                    microswim_member_mark_confirmed(ms, &ms->members[i]);
-                    microswim_index_remove(ms);
-                }
-            }
-        }
+void microswim_member_expire(microswim_t* ms, size_t slot) {
+    if (ms->slots[slot].table != SLAB_MEMBERS) {
+        return;
+    }
+
+    microswim_member_t* member = &ms->members[ms->slots[slot].position];
+    if (member->status != SUSPECT) {
+        return;
     }
+
+    microswim_member_t* confirmed = microswim_member_confirmed_find(ms, member);
+    // BUG: What should happen if confirmed is found?
+    if (!confirmed) {
+        microswim_member_mark_confirmed(ms, member);
+    }
+}
+
+/**
+ * @brief Fires the suspicion timers that are due, along with any other protocol timer.
+ *
+ * Suspect members are moved to confirmed once their timeout is exceeded.
+ */
+void microswim_members_check_suspects(microswim_t* ms) {
+    microswim_timers_expire(ms, microswim_milliseconds());
 }
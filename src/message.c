@@ -1,7 +1,8 @@
 #include "message.h"
+#include "codec.h"
 #include "constants.h"
-#include "decode.h"
-#include "encode.h"
+#include "fragment.h"
+#include "io.h"
 #include "member.h"
 #include "microswim.h"
 #include "microswim_log.h"
@@ -13,6 +14,8 @@
 #endif
 #include "ping.h"
 #include "ping_req.h"
+#include "record.h"
+#include "slab.h"
 #include "update.h"
 #include <errno.h>
 #include <string.h>
@@ -23,158 +26,312 @@
 void microswim_status_message_construct(
     microswim_t* ms, microswim_message_t* message, microswim_message_type_t type, microswim_member_t* member) {
 
-    strncpy((char*)message->uuid, (char*)ms->self.uuid, UUID_SIZE);
     message->type = type;
-    message->addr = ms->self.addr;
-    message->status = ms->self.status;
-    message->incarnation = ms->self.incarnation;
-    message->mu[0] = *member;
+    microswim_record_from_member(&message->sender, &ms->self);
+    microswim_record_from_member(&message->mu[0], member);
     message->update_count = 1;
 }
 
 /*
- * @brief Constructs a gossip message.
+ * @brief Constructs a gossip message that encodes to at most `budget` bytes in the codec.
  */
 void microswim_message_construct(
-    microswim_t* ms, microswim_message_t* message, microswim_message_type_t type,
-    microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE], size_t update_count) {
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    microswim_message_type_t type, size_t budget) {
 
-    strncpy((char*)message->uuid, (char*)ms->self.uuid, UUID_SIZE);
     message->type = type;
-    message->addr = ms->self.addr;
-    message->status = ms->self.status;
-    message->incarnation = ms->self.incarnation;
+    microswim_record_from_member(&message->sender, &ms->self);
 
-    for (size_t i = 0; i < update_count; i++) {
-        message->mu[i] = *updates[i]->member;
+    microswim_message_pack(ms, codec, message, budget);
+}
+
+/*
+ * @brief Piggybacks the least disseminated updates on the message.
+ *
+ * Updates are added in order of priority for as long as the encoded message still fits
+ * into `budget` bytes, as measured by the codec the message is sent in. The message header
+ * has to be filled in beforehand. The number of updates is only bounded by the encoded size.
+ *
+ * The sizes are those of the cached fragments, so that nothing is encoded twice. Each candidate
+ * is written into the next free record of the message, which only counts once it fits.
+ */
+void microswim_message_pack(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message, size_t budget) {
+    microswim_update_t updates[MESSAGE_UPDATES];
+    microswim_frame_t frame;
+    const unsigned char* data;
+    size_t separator = strlen(codec->separator);
+    size_t taken = 0;
+
+    message->update_count = 0;
+    codec->frame(message, &frame);
+    // NOTE: only the middle of the frame depends on the updates.
+    size_t size = frame.head_length + microswim_fragment_sender(ms, codec, message, &data) +
+                  strlen(codec->tail);
+
+    while (taken < MESSAGE_UPDATES && microswim_updates_take(ms, &updates[taken])) {
+        microswim_member_t* member = microswim_slab_resolve(ms, updates[taken++].member);
+        microswim_update_record_t* record = &message->mu[message->update_count];
+        microswim_record_from_member(record, member);
+        size_t length = microswim_fragment_update(ms, codec, record, &data) +
+                        ((message->update_count > 0) ? separator : 0);
+
+        message->update_count++;
+        codec->frame(message, &frame);
+        message->update_count--;
+        if (size + length + frame.middle_length > budget) {
+            break;
+        }
+
+        message->update_count++;
+        size += length;
     }
 
-    message->update_count = update_count;
+    microswim_updates_restore(ms, updates, taken, message->update_count);
 }
 
-void microswim_message_send(microswim_t* ms, microswim_member_t* member, const char* buffer, size_t length) {
+/**
+ * @brief Encodes the message in the codec into `buffer`, from its cached fragments if it can.
+ *
+ * @return The length of the encoded message, 0 if it could not be encoded.
+ */
+static size_t microswim_message_flatten(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_t* message,
+    unsigned char buffer[BUFFER_SIZE]) {
+    microswim_splice_t splice;
+    size_t length = 0;
+
+    if (microswim_fragment_splice(ms, codec, message, &splice) && splice.length < BUFFER_SIZE) {
+        for (size_t i = 0; i < splice.count; i++) {
+            memcpy(buffer + length, splice.parts[i].iov_base, splice.parts[i].iov_len);
+            length += splice.parts[i].iov_len;
+        }
+    } else {
+        length = codec->encode(message, buffer, BUFFER_SIZE);
+    }
+
+    return length;
+}
+
+/*
+ * @brief Encodes the message in the codec and sends it to the address.
+ *
+ * The message is handed to the socket as the list of its cached fragments where the platform
+ * allows it, and copied into a buffer otherwise. Messages with fragments that are not cached
+ * are encoded into the buffer from scratch. Hosts with a transport of their own get the
+ * message in a buffer.
+ */
 #ifdef RIOT_OS
-    ssize_t result = sock_udp_send(&ms->socket, (uint8_t*)buffer, length, &member->addr);
+static void microswim_message_transmit(
+    microswim_t* ms, const microswim_codec_t* codec, sock_udp_ep_t* addr,
+    microswim_message_t* message) {
+    unsigned char buffer[BUFFER_SIZE];
+    size_t length = microswim_message_flatten(ms, codec, message, buffer);
+    if (length == 0) {
+        return;
+    }
+
+    ssize_t result = sock_udp_send(&ms->socket, buffer, length, addr);
     if (result < 0) {
         MICROSWIM_LOG_ERROR("(microswim_message_send) sock_udp_send failed: (%d) %d %s", (int)result, errno, strerror(-result));
     }
+}
 #else
-    ssize_t result =
-        sendto(ms->socket, buffer, length, 0, (struct sockaddr*)(&member->addr), sizeof(member->addr));
+static void microswim_message_transmit(
+    microswim_t* ms, const microswim_codec_t* codec, struct sockaddr_in* addr,
+    microswim_message_t* message) {
+    microswim_splice_t splice;
+    ssize_t result;
+
+    if (ms->transport != NULL) {
+        unsigned char buffer[BUFFER_SIZE];
+        size_t length = microswim_message_flatten(ms, codec, message, buffer);
+        if (length != 0) {
+            ms->transport(ms, addr, buffer, length, ms->transport_context);
+        }
+        return;
+    }
+
+    if (microswim_fragment_splice(ms, codec, message, &splice) && splice.length < BUFFER_SIZE) {
+        if (microswim_io_queue(ms, addr, splice.parts, splice.count)) {
+            return;
+        }
+
+        struct msghdr header = { 0 };
+        header.msg_name = addr;
+        header.msg_namelen = sizeof(*addr);
+        header.msg_iov = splice.parts;
+        header.msg_iovlen = splice.count;
+        result = sendmsg(ms->socket, &header, 0);
+    } else {
+        unsigned char buffer[BUFFER_SIZE];
+        size_t length = codec->encode(message, buffer, BUFFER_SIZE);
+        if (length == 0) {
+            return;
+        }
+
+        microswim_iovec_t part = { .iov_base = buffer, .iov_len = length };
+        if (microswim_io_queue(ms, addr, &part, 1)) {
+            return;
+        }
+
+        result = sendto(ms->socket, buffer, length, 0, (struct sockaddr*)addr, sizeof(*addr));
+    }
+
     if (result < 0) {
-        MICROSWIM_LOG_ERROR("(microswim_message_send) sendto failed: (%d) %d %s", result, errno, strerror(errno));
+        MICROSWIM_LOG_ERROR("(microswim_message_send) sendto failed: (%zd) %d %s", result, errno, strerror(errno));
     }
 
     // TODO: return result.
+}
 #endif
+
+/*
+ * @brief Sends the message to the member in the codec the member speaks.
+ */
+void microswim_message_send(microswim_t* ms, microswim_member_t* member, microswim_message_t* message) {
+    microswim_message_transmit(ms, microswim_codec_select(ms, member), &member->addr, message);
 }
 
-void microswim_message_print(microswim_message_t* message) {
+/*
+ * @brief Logs the message, decoding its updates once more only if they are logged at all.
+ */
+static void microswim_message_print(
+    const microswim_codec_t* codec, const microswim_message_view_t* view,
+    const microswim_update_record_t* sender) {
+    if (DEBUG > MICROSWIM_LOG_LEVEL) {
+        return;
+    }
+
+    char uuid[UUID_SIZE];
+    microswim_id_format(&sender->uuid, uuid);
 #ifdef RIOT_OS
     MICROSWIM_LOG_DEBUG(
         "MESSAGE: %s, FROM: %s, STATUS: %d, INCARNATION: %d URI: %d",
-        (message->type == ALIVE_MESSAGE ?
+        (view->type == ALIVE_MESSAGE ?
              "ALIVE MESSAGE" :
-             (message->type == SUSPECT_MESSAGE ?
+             (view->type == SUSPECT_MESSAGE ?
                   "SUSPECT MESSAGE" :
-                  (message->type == CONFIRM_MESSAGE ?
+                  (view->type == CONFIRM_MESSAGE ?
                        "CONFIRM MESSAGE" :
-                       (message->type == PING_MESSAGE ?
+                       (view->type == PING_MESSAGE ?
                             "PING MESSAGE" :
-                            (message->type == PING_REQ_MESSAGE ? "PING_REQ_MESSAGE" : "ACK MESSAGE"))))),
-        message->uuid, message->status, message->incarnation, message->addr.port);
-    MICROSWIM_LOG_DEBUG("UPDATES:");
-    for (size_t i = 0; i < message->update_count; i++) {
-        MICROSWIM_LOG_DEBUG(
-            "\t%s: STATUS: %d, INCARNATION: %d", message->mu[i].uuid, message->mu[i].status,
-            message->mu[i].incarnation);
-    }
+                            (view->type == PING_REQ_MESSAGE ? "PING_REQ_MESSAGE" : "ACK MESSAGE"))))),
+        uuid, sender->status, sender->incarnation, sender->port);
 #else
     MICROSWIM_LOG_DEBUG(
         "MESSAGE: %s, FROM: %s, STATUS: %d, INCARNATION: %zu, URI: %d",
-        (message->type == ALIVE_MESSAGE ?
+        (view->type == ALIVE_MESSAGE ?
              "ALIVE MESSAGE" :
-             (message->type == SUSPECT_MESSAGE ?
+             (view->type == SUSPECT_MESSAGE ?
                   "SUSPECT MESSAGE" :
-                  (message->type == CONFIRM_MESSAGE ?
+                  (view->type == CONFIRM_MESSAGE ?
                        "CONFIRM MESSAGE" :
-                       (message->type == PING_MESSAGE ?
+                       (view->type == PING_MESSAGE ?
                             "PING MESSAGE" :
-                            (message->type == PING_REQ_MESSAGE ? "PING_REQ_MESSAGE" : "ACK MESSAGE"))))),
-        message->uuid, message->status, message->incarnation, ntohs(message->addr.sin_port));
+                            (view->type == PING_REQ_MESSAGE ? "PING_REQ_MESSAGE" : "ACK MESSAGE"))))),
+        uuid, sender->status, sender->incarnation, sender->port);
+#endif
     MICROSWIM_LOG_DEBUG("UPDATES:");
-    for (size_t i = 0; i < message->update_count; i++) {
+
+    microswim_update_record_t update;
+    size_t position = view->updates;
+    for (size_t i = 0; i < view->update_count && codec->member(view, &position, &update); i++) {
+        microswim_id_format(&update.uuid, uuid);
+#ifdef RIOT_OS
         MICROSWIM_LOG_DEBUG(
-            "\t%s: STATUS: %d, INCARNATION: %zu", message->mu[i].uuid, message->mu[i].status,
-            message->mu[i].incarnation);
-    }
+            "\t%s: STATUS: %d, INCARNATION: %d", uuid, update.status, update.incarnation);
+#else
+        MICROSWIM_LOG_DEBUG(
+            "\t%s: STATUS: %d, INCARNATION: %zu", uuid, update.status, update.incarnation);
 #endif
+    }
 }
 
 /*
- * @brief Extracts information from the message.
+ * @brief Applies what the message says about its sender, who is sent messages in the codec it
+ * used from now on.
  */
-void microswim_message_extract_members(microswim_t* ms, microswim_message_t* message) {
-    microswim_member_t self;
-    strncpy((char*)self.uuid, (char*)message->uuid, UUID_SIZE);
-    self.addr = message->addr;
-    self.status = message->status;
-    self.incarnation = message->incarnation;
-
-    microswim_members_check(ms, &self);
-
-    for (size_t i = 0; i < message->update_count; i++) {
-        microswim_member_t* message_member = &message->mu[i];
-        microswim_members_check(ms, message_member);
+static void microswim_message_extract_sender(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* sender,
+    uint64_t now) {
+    microswim_members_check(ms, sender, now);
+
+    microswim_member_t temp = { 0 };
+    microswim_record_to_member(sender, &temp);
+    microswim_member_t* member = microswim_member_find(ms, &temp);
+    if (member != NULL) {
+        microswim_codec_assign(ms, member, codec);
     }
 }
 
 /*
- * @brief Sends an ACK message. TODO: refactor to use `microswim_message_send function.
+ * @brief Extracts information from the message, decoding its updates one at a time straight
+ * out of the receive buffer.
+ *
+ * The sender is sent messages in the codec it used from now on.
  */
+void microswim_message_extract_members(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_message_view_t* view,
+    const microswim_update_record_t* sender, uint64_t now) {
+    microswim_message_extract_sender(ms, codec, sender, now);
 
-#ifdef RIOT_OS
-void microswim_ack_message_send(microswim_t* ms, sock_udp_ep_t addr) {
-    microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-    microswim_message_t message = { 0 };
-
-    unsigned char buffer[BUFFER_SIZE] = { 0 };
-    int update_count = microswim_updates_retrieve(ms, updates);
-    microswim_message_construct(ms, &message, ACK_MESSAGE, updates, update_count);
-    size_t len = microswim_encode_message(&message, buffer, BUFFER_SIZE);
+    microswim_update_record_t update;
+    // NOTE: no datagram holds more than MESSAGE_UPDATES updates, as for a decoded message.
+    size_t position = view->updates;
+    for (size_t i = 0; i < view->update_count && i < MESSAGE_UPDATES; i++) {
+        // NOTE: the updates ahead of a malformed one have been applied already.
+        if (!codec->member(view, &position, &update)) {
+            MICROSWIM_LOG_ERROR("Malformed update near byte %zu, ignoring the rest...", position);
+            return;
+        }
 
-    ssize_t result = sock_udp_send(&ms->socket, buffer, len, &addr);
-    if (result < 0) {
-        MICROSWIM_LOG_ERROR("(microswim_message_send) sendto failed: (%d) %d %s", (int)result, errno, strerror(errno));
+        microswim_members_check(ms, &update, now);
     }
 }
-#else
-void microswim_ack_message_send(microswim_t* ms, struct sockaddr_in addr) {
-    microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-    microswim_message_t message = { 0 };
 
-    unsigned char buffer[BUFFER_SIZE] = { 0 };
-    int update_count = microswim_updates_retrieve(ms, updates);
-    microswim_message_construct(ms, &message, ACK_MESSAGE, updates, update_count);
-    size_t len = microswim_encode_message(&message, buffer, BUFFER_SIZE);
+/*
+ * @brief Extracts information from a message whose updates have been decoded already.
+ */
+void microswim_message_extract_records(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* sender,
+    const microswim_update_record_t* updates, size_t count, uint64_t now) {
+    microswim_message_extract_sender(ms, codec, sender, now);
 
-    ssize_t result = sendto(ms->socket, buffer, len, 0, (struct sockaddr*)(&addr), sizeof(addr));
-    if (result < 0) {
-        MICROSWIM_LOG_ERROR("(microswim_ack_message_send) sendto failed.");
+    for (size_t i = 0; i < count; i++) {
+        microswim_members_check(ms, &updates[i], now);
     }
 }
+
+/*
+ * @brief Sends an ACK message.
+ */
+#ifdef RIOT_OS
+void microswim_ack_message_send(microswim_t* ms, const microswim_codec_t* codec, sock_udp_ep_t addr) {
+#else
+void microswim_ack_message_send(microswim_t* ms, const microswim_codec_t* codec, struct sockaddr_in addr) {
 #endif
+    microswim_message_t message = { 0 };
+    microswim_message_construct(ms, codec, &message, ACK_MESSAGE, ms->config.message_budget);
+    microswim_message_transmit(ms, codec, &addr, &message);
+}
 
 /*
  * @brief Handles PING message.
+ *
+ * The ACK is sent in the codec the ping arrived in.
  */
-static void microswim_ping_message_handle(microswim_t* ms, microswim_message_t* message) {
+static void microswim_ping_message_handle(
+    microswim_t* ms, const microswim_codec_t* codec, const microswim_update_record_t* sender,
+    uint64_t now) {
+    microswim_member_t temp = { 0 };
+    microswim_record_to_member(sender, &temp);
     // NOTE: if a member receives a ping, it should send an ack.
     // An ack will piggyback known member information.
-    microswim_ack_message_send(ms, message->addr);
+    microswim_ack_message_send(ms, codec, temp.addr);
     // A bit of a hack. Could be done cleaner.
-    microswim_member_t temp = { 0 };
-    strncpy((char*)temp.uuid, (char*)message->uuid, UUID_SIZE);
+    memset(&temp, 0, sizeof(temp));
+    temp.uuid = sender->uuid;
     microswim_ping_t* ping = microswim_ping_find(ms, &temp);
     if (ping != NULL) {
         microswim_ping_remove(ms, ping);
@@ -182,75 +339,222 @@ static void microswim_ping_message_handle(microswim_t* ms, microswim_message_t*
 
     microswim_member_t* member = microswim_member_find(ms, &temp);
     if (member) {
-        microswim_member_mark_alive(ms, member);
+        microswim_member_mark_alive(ms, member, now);
     }
 }
 
 /*
  * @brief Handles ACK message.
+ *
+ * Only an ACK answering a ping of ours marks its sender alive, a late or unsolicited one leaves
+ * a suspicion as it is. A member asked to ping-req opens no ping of its own, so the ACK is
+ * matched against the ping-reqs about its sender whether or not a ping is found, and relayed to
+ * the members which asked.
  */
-void microswim_ack_message_handle(microswim_t* ms, microswim_message_t* message) {
-    // TODO: decide what to do when a PING is NULL.
-    // It should never happen here, though. But it must be handled.
+static void microswim_ack_message_handle(
+    microswim_t* ms, const microswim_update_record_t* sender, uint64_t now) {
     microswim_member_t member = { 0 };
-    strncpy((char*)member.uuid, (char*)message->uuid, UUID_SIZE);
+    member.uuid = sender->uuid;
     microswim_ping_t* ping = microswim_ping_find(ms, &member);
+    microswim_member_t* target = (ping != NULL) ? microswim_slab_resolve(ms, ping->member) :
+                                                  microswim_member_find(ms, &member);
 
-    if (ping != NULL && ping->member->uuid[0] != '\0') {
-        microswim_member_mark_alive(ms, ping->member);
-
-        microswim_ping_req_t* ping_req = NULL;
-        for (size_t i = 0; i < ms->ping_req_count; i++) {
-            if (strncmp((char*)message->uuid, (char*)ms->ping_reqs[i].target->uuid, UUID_SIZE) == 0) {
-                ping_req = &ms->ping_reqs[i];
-                microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-                microswim_message_t message = { 0 };
-                unsigned char buffer[BUFFER_SIZE] = { 0 };
-                int update_count = microswim_updates_retrieve(ms, updates);
-                microswim_message_construct(ms, &message, ACK_MESSAGE, updates, update_count);
-                message.status = ping_req->target->status;
-                message.incarnation = ping_req->target->incarnation;
-                message.addr = ping_req->target->addr;
-                strncpy((char*)message.uuid, (char*)ping_req->target->uuid, UUID_SIZE);
-                size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-
-                microswim_message_send(ms, ping_req->source, (const char*)buffer, length);
-                microswim_ping_req_remove(ms, ping_req);
-            }
+    if (target == NULL || microswim_id_is_nil(&target->uuid)) {
+        return;
+    }
+
+    if (ping != NULL) {
+        microswim_member_mark_alive(ms, target, now);
+    }
+
+    microswim_ping_req_t* ping_req = NULL;
+    for (size_t i = 0; i < ms->ping_req_count;) {
+        ping_req = &ms->ping_reqs[i];
+        if (!microswim_handle_equal(ping_req->target, target->handle)) {
+            i++;
+            continue;
         }
 
+        microswim_member_t* source = microswim_slab_resolve(ms, ping_req->source);
+        if (source != NULL) {
+            microswim_message_t message = { 0 };
+            message.type = ACK_MESSAGE;
+            microswim_record_from_member(&message.sender, target);
+            const microswim_codec_t* codec = microswim_codec_select(ms, source);
+            microswim_message_pack(ms, codec, &message, ms->config.message_budget);
+            microswim_message_send(ms, source, &message);
+        }
+
+        // NOTE: the last ping-req takes the place of the removed one.
+        microswim_ping_req_remove(ms, ping_req);
+    }
+
+    if (ping != NULL) {
         microswim_ping_remove(ms, ping);
     }
 }
 
+/*
+ * @brief Answers a PING, PING_REQ or ACK message whose members have been extracted, `target`
+ * being the first update, which a PING_REQ is about, or NULL if there is none.
+ */
+static void microswim_message_respond(
+    microswim_t* ms, const microswim_codec_t* codec, microswim_message_type_t type,
+    const microswim_update_record_t* sender, const microswim_update_record_t* target,
+    uint64_t now) {
+    switch (type) {
+        case PING_MESSAGE:
+            microswim_ping_message_handle(ms, codec, sender, now);
+            break;
+        case PING_REQ_MESSAGE:
+            if (target == NULL) {
+                MICROSWIM_LOG_ERROR("Could not find the target member for ping_req");
+                break;
+            }
+            microswim_ping_req_message_handle(ms, sender, target, now);
+            break;
+        case ACK_MESSAGE:
+            microswim_ack_message_handle(ms, sender, now);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * @brief Handles a PING, PING_REQ or ACK message without decoding it up front.
+ *
+ * The message is indexed in place, its sender decoded once for all the handlers and its
+ * updates only as they are applied, so no decoded copy of the message is kept.
+ */
+static void microswim_message_view_handle(
+    microswim_t* ms, const microswim_codec_t* codec, const unsigned char* buffer, size_t len,
+    uint64_t now) {
+    microswim_message_view_t view;
+    microswim_update_record_t sender;
+    size_t position;
+
+    if (!codec->view(&view, buffer, len)) {
+        return;
+    }
+
+    position = view.sender;
+    if (!codec->member(&view, &position, &sender)) {
+        MICROSWIM_LOG_ERROR("Malformed sender of a message of %zu bytes, ignoring...", len);
+        return;
+    }
+
+    microswim_message_print(codec, &view, &sender);
+    microswim_message_extract_members(ms, codec, &view, &sender, now);
+
+    microswim_update_record_t target;
+    position = view.updates;
+    bool targeted = view.type == PING_REQ_MESSAGE && view.update_count > 0 &&
+                    codec->member(&view, &position, &target);
+    microswim_message_respond(ms, codec, view.type, &sender, targeted ? &target : NULL, now);
+}
+
+/**
+ * @brief Decodes the datagram held by the delta without touching the state of the instance,
+ * only its registered codecs are read, so that it can run on any thread.
+ *
+ * @return true if the delta is to be handed to `microswim_message_delta_handle`, false if the
+ * datagram is dropped.
+ */
+bool microswim_message_delta_decode(microswim_t* ms, microswim_delta_t* delta) {
+    size_t len = (delta->length > 0) ? (size_t)delta->length : 0;
+    microswim_message_view_t view;
+    size_t position;
+
+    delta->codec = microswim_codec_detect(ms, delta->buffer, len);
+    if (delta->codec == NULL) {
+        MICROSWIM_LOG_DEBUG("Message of %zd bytes in an unknown format, ignoring...", delta->length);
+        return false;
+    }
+
+    const microswim_codec_t* codec = delta->codec;
+    delta->type = codec->decode_type(delta->buffer, delta->length);
+    delta->update_count = 0;
+    switch (delta->type) {
+        case PING_MESSAGE:
+        case PING_REQ_MESSAGE:
+        case ACK_MESSAGE:
+            break;
+        case EVENT_MESSAGE:
+            return true;
+        default:
+            return false;
+    }
+
+    if (!codec->view(&view, delta->buffer, len)) {
+        return false;
+    }
+
+    position = view.sender;
+    if (!codec->member(&view, &position, &delta->sender)) {
+        MICROSWIM_LOG_ERROR("Malformed sender of a message of %zu bytes, ignoring...", len);
+        return false;
+    }
+
+    microswim_message_print(codec, &view, &delta->sender);
+
+    position = view.updates;
+    while (delta->update_count < view.update_count && delta->update_count < MESSAGE_UPDATES) {
+        if (!codec->member(&view, &position, &delta->updates[delta->update_count])) {
+            MICROSWIM_LOG_ERROR("Malformed update near byte %zu, ignoring the rest...", position);
+            break;
+        }
+
+        delta->update_count++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Applies a message decoded by `microswim_message_delta_decode`, as
+ * `microswim_message_handle` would have applied the datagram.
+ */
+void microswim_message_delta_handle(
+    microswim_t* ms, microswim_delta_t* delta, uint64_t now,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t)) {
+    microswim_io_cork(ms);
+    if (delta->type == EVENT_MESSAGE) {
+        event_handler(ms, delta->buffer, delta->length);
+    } else {
+        microswim_message_extract_records(
+            ms, delta->codec, &delta->sender, delta->updates, delta->update_count, now);
+        microswim_message_respond(
+            ms, delta->codec, delta->type, &delta->sender,
+            (delta->update_count > 0) ? &delta->updates[0] : NULL, now);
+    }
+    microswim_io_uncork(ms);
+}
+
 /*
  * @brief Handles the incoming message.
+ *
+ * `now` is the time, on the clock of `microswim_milliseconds`, that every deadline the message
+ * sets is counted from, so that handling it never reads the clock.
  */
 void microswim_message_handle(
-    microswim_t* ms, unsigned char* buffer, ssize_t len,
+    microswim_t* ms, unsigned char* buffer, ssize_t len, uint64_t now,
     void (*event_handler)(microswim_t*, unsigned char*, ssize_t)) {
 
-    microswim_message_t message = { 0 };
-    microswim_message_type_t type = microswim_decode_message_type(buffer, len);
+    const microswim_codec_t* codec = microswim_codec_detect(ms, buffer, (len > 0) ? (size_t)len : 0);
+    if (codec == NULL) {
+        MICROSWIM_LOG_DEBUG("Message of %zd bytes in an unknown format, ignoring...", len);
+        return;
+    }
+
+    microswim_message_type_t type = codec->decode_type(buffer, len);
 
+    microswim_io_cork(ms);
     switch (type) {
         case PING_MESSAGE:
-            microswim_decode_message(&message, (const char*)buffer, len);
-            microswim_message_print(&message);
-            microswim_message_extract_members(ms, &message);
-            microswim_ping_message_handle(ms, &message);
-            break;
         case PING_REQ_MESSAGE:
-            microswim_decode_message(&message, (const char*)buffer, len);
-            microswim_message_print(&message);
-            microswim_message_extract_members(ms, &message);
-            microswim_ping_req_message_handle(ms, &message);
-            break;
         case ACK_MESSAGE:
-            microswim_decode_message(&message, (const char*)buffer, len);
-            microswim_message_print(&message);
-            microswim_message_extract_members(ms, &message);
-            microswim_ack_message_handle(ms, &message);
+            microswim_message_view_handle(ms, codec, buffer, (size_t)len, now);
             break;
         case ALIVE_MESSAGE:
         case SUSPECT_MESSAGE:
@@ -262,4 +566,21 @@ void microswim_message_handle(
         default:
             break;
     }
+    microswim_io_uncork(ms);
+}
+
+/**
+ * @brief Handles the datagrams received in one batch.
+ *
+ * The messages sent in response are held back and flushed together once the last datagram
+ * has been handled.
+ */
+void microswim_message_batch_handle(
+    microswim_t* ms, microswim_datagram_t* datagrams, size_t count, uint64_t now,
+    void (*event_handler)(microswim_t*, unsigned char*, ssize_t)) {
+    microswim_io_cork(ms);
+    for (size_t i = 0; i < count; i++) {
+        microswim_message_handle(ms, datagrams[i].buffer, datagrams[i].length, now, event_handler);
+    }
+    microswim_io_uncork(ms);
 }
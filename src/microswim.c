@@ -5,15 +5,151 @@
 #include "net/sock.h"
 #include "net/utils.h"
 #endif
+#include "arena.h"
+#include "change.h"
+#include "codec.h"
+#include "fragment.h"
+#include "io.h"
+#include "member.h"
 #include "microswim_log.h"
+#include "ping.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "timer.h"
+#include "utils.h"
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
-#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+/**
+ * @brief Initialises the instance and allocates its tables.
+ *
+ * The tables are sized for `initial_members` and grow on demand up to the maximums of the
+ * configuration. If `config` is NULL, MICROSWIM_CONFIG_DEFAULT is used, which mirrors the
+ * compile-time configuration. The buffers of the batched socket I/O are left to
+ * `microswim_io_reserve`, or to the loop the instance is added to.
+ *
+ * @return true on success, false if no codec is available or the initial tables could not
+ * be allocated.
+ */
+bool microswim_init(microswim_t* ms, const microswim_config_t* config) {
+    microswim_config_t defaults = MICROSWIM_CONFIG_DEFAULT;
+
+    memset(ms, 0, sizeof(*ms));
+    ms->config = (config != NULL) ? *config : defaults;
+    ms->arena.base = ms->config.memory;
+    ms->arena.size = ms->config.memory_size;
+    ms->free_slot = SLAB_SLOT_NONE;
+    // NOTE: the receivers keep one byte of BUFFER_SIZE for the terminating null byte.
+    if (ms->config.message_budget == 0 || ms->config.message_budget > BUFFER_SIZE - 1) {
+        ms->config.message_budget = BUFFER_SIZE - 1;
+    }
+    microswim_rng_seed(
+        ms, microswim_milliseconds() ^ ((uint64_t)microswim_random() << 32) ^ (uintptr_t)ms);
+
+    if (!microswim_codecs_register(ms)) {
+        return false;
+    }
+
+    size_t initial = ms->config.initial_members;
+    if (initial > ms->config.maximum_members) {
+        initial = ms->config.maximum_members;
+    }
+
+    if (!microswim_members_reserve(ms, initial) || !microswim_confirmed_reserve(ms, initial)) {
+        MICROSWIM_LOG_ERROR("Unable to allocate the member tables\n");
+        microswim_deinit(ms);
+        return false;
+    }
+
+    // NOTE: without the fragment cache, every message is encoded anew.
+    microswim_fragment_reserve(ms);
+
+    return true;
+}
+
+/**
+ * @brief Releases the tables of the instance.
+ *
+ * The memory supplied through the configuration is left to the caller.
+ */
+void microswim_deinit(microswim_t* ms) {
+    microswim_snapshots_disable(ms);
+    microswim_changes_disable(ms);
+    microswim_io_release(ms);
+    microswim_arena_release(&ms->arena, ms->fragments);
+    microswim_arena_release(&ms->arena, ms->timers);
+    microswim_arena_release(&ms->arena, ms->slots);
+    microswim_arena_release(&ms->arena, ms->hash);
+    microswim_arena_release(&ms->arena, ms->ping_reqs);
+    microswim_arena_release(&ms->arena, ms->pings);
+    microswim_arena_release(&ms->arena, ms->updates);
+    microswim_arena_release(&ms->arena, ms->confirmed);
+    microswim_arena_release(&ms->arena, ms->members);
+    microswim_arena_release(&ms->arena, ms->indices);
+
+    ms->fragments = NULL;
+    ms->timers = NULL;
+    ms->slots = NULL;
+    ms->hash = NULL;
+    ms->ping_reqs = NULL;
+    ms->pings = NULL;
+    ms->updates = NULL;
+    ms->confirmed = NULL;
+    ms->members = NULL;
+    ms->indices = NULL;
+    ms->timer_capacity = 0;
+    ms->timer_count = 0;
+    ms->slot_capacity = 0;
+    ms->slot_count = 0;
+    ms->free_slot = SLAB_SLOT_NONE;
+    ms->hash_capacity = 0;
+    ms->ping_req_capacity = 0;
+    ms->ping_capacity = 0;
+    ms->update_capacity = 0;
+    ms->confirmed_capacity = 0;
+    ms->member_capacity = 0;
+    ms->index_capacity = 0;
+    ms->fragment_capacity = 0;
+    ms->fragment_hand = 0;
+    ms->arena.used = 0;
+    ms->arena.last = 0;
+}
+
+/**
+ * @brief Runs all the work that is due at `now`.
+ *
+ * Fires the expired ping, ping-req and suspicion timers and, once the protocol period
+ * has elapsed, starts the next one. `now` must come from the same clock as
+ * `microswim_milliseconds`, and every deadline set along the way is counted from it. The
+ * messages sent along the way are flushed together at the end.
+ */
+void microswim_tick(microswim_t* ms, uint64_t now) {
+    microswim_io_cork(ms);
+    microswim_timers_expire(ms, now);
+
+    if (ms->protocol_deadline <= now) {
+        microswim_ping_round(ms, now);
+        ms->protocol_deadline = now + (uint64_t)(PROTOCOL_PERIOD * 1000);
+    }
+    microswim_io_uncork(ms);
+}
+
+/**
+ * @brief Returns the time at which `microswim_tick` next has work to do.
+ *
+ * Hosts can sleep until then, or until a message arrives, whichever comes first. Handling a
+ * message may schedule new timers, so the deadline should be queried again afterwards.
+ */
+uint64_t microswim_next_deadline(microswim_t* ms) {
+    uint64_t deadline = microswim_timers_next(ms);
+
+    return (ms->protocol_deadline < deadline) ? ms->protocol_deadline : deadline;
+}
+
 /**
  * @brief Sets up the socket.
  *
@@ -83,50 +219,71 @@ void microswim_socket_setup(microswim_t* ms, char* addr, int port) {
 #endif
 }
 
-void microswim_index_remove(microswim_t* ms) {
-    if ((ms->member_count + 1) == 0)
-        return;
+#ifndef RIOT_OS
+/**
+ * @brief Has the messages of the instance carried by `transport` rather than a socket.
+ *
+ * The instance goes by `addr` and has no socket. The host hands the datagrams meant for it to
+ * `microswim_message_handle`, and drives it with `microswim_tick` on the clock of
+ * `microswim_milliseconds`. The buffers of the batched I/O are released, since nothing is
+ * queued for a socket any more.
+ */
+void microswim_transport_setup(
+    microswim_t* ms, microswim_transport_t transport, void* context, struct sockaddr_in* addr) {
+    microswim_io_release(ms);
 
-    // Find the index of the highest value
-    int index = 0;
-    for (size_t i = 1; i < ms->member_count + 1; i++) {
-        if (ms->indices[i] > ms->indices[index]) {
-            index = i;
-        }
-    }
+    ms->socket = -1;
+    ms->transport = transport;
+    ms->transport_context = context;
+    ms->self.addr = *addr;
+}
+#endif
 
-    // Shift elements to remove the highest value
-    for (size_t i = index; i < ms->member_count; i++) {
-        ms->indices[i] = ms->indices[i + 1];
-    }
+/**
+ * @brief Swaps two entries of the round-robin indices, keeping the members' slots in sync.
+ */
+static void microswim_indices_swap(microswim_t* ms, size_t a, size_t b) {
+    size_t temp = ms->indices[a];
+    ms->indices[a] = ms->indices[b];
+    ms->indices[b] = temp;
+
+    ms->slots[ms->members[ms->indices[a]].handle.slot].order = a;
+    ms->slots[ms->members[ms->indices[b]].handle.slot].order = b;
 }
 
-void microswim_index_add(microswim_t* ms) {
-    size_t index = 0;
-    if (ms->member_count >= 1) {
-        index = rand() % (ms->member_count);
+/**
+ * @brief Drops the round-robin entry at `order`.
+ *
+ * Must be called once the member has been removed from the member array, with the
+ * position in `indices` its slot recorded. The last entry takes its place.
+ */
+void microswim_index_remove(microswim_t* ms, size_t order) {
+    size_t last = ms->member_count;
+    if (order == last) {
+        return;
     }
 
-    size_t* position = microswim_indices_shift(ms, index);
-    *position = ms->member_count - 1;
+    ms->indices[order] = ms->indices[last];
+    ms->slots[ms->members[ms->indices[order]].handle.slot].order = order;
 }
 
-size_t* microswim_indices_shift(microswim_t* ms, size_t index) {
-    for (size_t i = ms->member_count - 1; i > index; i--) {
-        ms->indices[i] = ms->indices[i - 1];
+/**
+ * @brief Moves the round-robin entry of the most recently added member to a random position.
+ *
+ * `microswim_member_add` appends the entry, so this only decides when the member is visited.
+ */
+void microswim_index_add(microswim_t* ms) {
+    if (ms->member_count == 0) {
+        return;
     }
 
-    size_t* new = &ms->indices[index];
-
-    return new;
+    size_t index = microswim_rng_bounded(ms, ms->member_count);
+    microswim_indices_swap(ms, index, ms->member_count - 1);
 }
 
 void microswim_indices_shuffle(microswim_t* ms) {
     for (size_t i = ms->member_count - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-
-        size_t temp = ms->indices[i];
-        ms->indices[i] = ms->indices[j];
-        ms->indices[j] = temp;
+        size_t j = microswim_rng_bounded(ms, i + 1);
+        microswim_indices_swap(ms, i, j);
     }
 }
@@ -1,37 +1,53 @@
 #include "ping.h"
+#include "arena.h"
+#include "codec.h"
 #include "constants.h"
-#include "encode.h"
+#include "hash.h"
 #include "member.h"
 #include "message.h"
 #include "microswim.h"
 #include "microswim_log.h"
+#include "slab.h"
+#include "timer.h"
+#include "update.h"
 #include "utils.h"
 
 /**
  * @brief
  */
-microswim_ping_t* microswim_ping_add(microswim_t* ms, microswim_member_t* member) {
+microswim_ping_t* microswim_ping_add(microswim_t* ms, microswim_member_t* member, uint64_t now) {
     microswim_ping_t* ping = microswim_ping_find(ms, member);
     if (ping != NULL) {
         microswim_ping_remove(ms, ping);
     }
 
-    if (member->uuid[0] != '\0') {
-        if (ms->ping_count > MAXIMUM_PINGS) {
+    if (!microswim_id_is_nil(&member->uuid)) {
+        microswim_ping_t* pings = microswim_arena_grow(
+            &ms->arena, ms->pings, &ms->ping_capacity, sizeof(microswim_ping_t), ms->ping_count + 1,
+            ms->config.maximum_pings);
+        if (pings == NULL) {
             MICROSWIM_LOG_ERROR(
-                "Unable to add a new ping: the maximum limit (%d) has been "
-                "reached. Consider increasing MAXIMUM_PINGS to allow "
+                "Unable to add a new ping: the maximum limit (%zu) has been "
+                "reached. Consider increasing `maximum_pings` to allow "
                 "additional members.",
-                MAXIMUM_PINGS);
+                ms->config.maximum_pings);
             return NULL;
         }
 
-        ms->pings[ms->ping_count].ping_req_deadline =
-            (microswim_milliseconds() + (uint64_t)(PING_REQ_PERIOD * 1000));
-        ms->pings[ms->ping_count].suspect_deadline =
-            (microswim_milliseconds() + (uint64_t)(PROTOCOL_PERIOD * 1000));
-        ms->pings[ms->ping_count].member = member;
-        ms->pings[ms->ping_count].ping_req = false;
+        ms->pings = pings;
+        ping = &ms->pings[ms->ping_count];
+
+        ping->ping_req_deadline = (now + (uint64_t)(PING_REQ_PERIOD * 1000));
+        ping->suspect_deadline = (now + (uint64_t)(PROTOCOL_PERIOD * 1000));
+        ping->member = member->handle;
+        ping->ping_req = false;
+        ping->timer = TIMER_NONE;
+        microswim_timer_schedule(ms, TIMER_NONE, TIMER_PING, ms->ping_count, ping->ping_req_deadline);
+
+        microswim_hash_entry_t* entry = microswim_hash_insert(ms, &member->uuid);
+        if (entry != NULL) {
+            entry->ping = ms->ping_count;
+        }
 
         return &ms->pings[ms->ping_count++];
     }
@@ -40,65 +56,116 @@ microswim_ping_t* microswim_ping_add(microswim_t* ms, microswim_member_t* member
 }
 
 microswim_ping_t* microswim_ping_find(microswim_t* ms, microswim_member_t* member) {
-    for (size_t i = 0; i < ms->ping_count; i++) {
-        if (strncmp((char*)ms->pings[i].member->uuid, (char*)member->uuid, UUID_SIZE) == 0) {
-            return &ms->pings[i];
-        }
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+    if (entry == NULL || entry->ping == HASH_INDEX_NONE) {
+        return NULL;
     }
 
-    return NULL;
+    return &ms->pings[entry->ping];
 }
 
+/**
+ * @brief Removes the ping by moving the last ping into its place.
+ */
 void microswim_ping_remove(microswim_t* ms, microswim_ping_t* ping) {
-    size_t index;
-    for (index = 0; index < ms->ping_count; index++) {
-        if (&(ms->pings[index]) == ping) {
-            break;
+    size_t index = (size_t)(ping - ms->pings);
+    size_t last = ms->ping_count - 1;
+
+    microswim_timer_cancel(ms, ping->timer);
+
+    microswim_member_t* member = microswim_slab_resolve(ms, ping->member);
+    if (member != NULL) {
+        microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+        if (entry != NULL && entry->ping == index) {
+            entry->ping = HASH_INDEX_NONE;
+            microswim_hash_release(ms, entry);
         }
     }
 
-    for (size_t i = index; i < ms->ping_count - 1; i++) {
-        ms->pings[i] = ms->pings[i + 1];
+    if (index != last) {
+        ms->pings[index] = ms->pings[last];
+        if (ms->pings[index].timer != TIMER_NONE) {
+            ms->timers[ms->pings[index].timer].owner = index;
+        }
+
+        member = microswim_slab_resolve(ms, ms->pings[index].member);
+        if (member != NULL) {
+            microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+            if (entry != NULL) {
+                entry->ping = index;
+            }
+        }
     }
 
     ms->ping_count--;
 }
 
-void microswim_pings_check(microswim_t* ms) {
-    uint64_t now = microswim_milliseconds();
+/**
+ * @brief Handles the timer of the ping.
+ *
+ * Once the ping-req deadline passes without an ACK, the member is probed indirectly
+ * and the timer is moved to the suspect deadline. Once that one passes as well,
+ * the member is marked as suspect.
+ */
+void microswim_ping_expire(microswim_t* ms, microswim_ping_t* ping, uint64_t now) {
+    microswim_member_t* target = microswim_slab_resolve(ms, ping->member);
+    if (target == NULL) {
+        microswim_ping_remove(ms, ping);
+        return;
+    }
 
-    for (size_t i = 0; i < ms->ping_count;) {
-        microswim_ping_t* p = &ms->pings[i];
+    if (ping->suspect_deadline <= now) {
+        microswim_member_mark_suspect(ms, target, now);
+        microswim_ping_remove(ms, ping);
+        return;
+    }
 
-        if (p->suspect_deadline < now) {
-            microswim_member_mark_suspect(ms, p->member);
-            size_t last = ms->ping_count - 1;
-            if (i != last) {
-                ms->pings[i] = ms->pings[last];
-            }
-            ms->ping_count--;
-            continue;
-        } else if (p->ping_req_deadline < now && !p->ping_req) {
-            size_t members[FAILURE_DETECTION_GROUP];
-            size_t count = microswim_get_ping_req_candidates(ms, members);
+    if (!ping->ping_req) {
+        size_t members[FAILURE_DETECTION_GROUP];
+        size_t count = microswim_get_ping_req_candidates(ms, members);
 
-            if (count > FAILURE_DETECTION_GROUP) {
-                count = FAILURE_DETECTION_GROUP;
-            }
+        if (count > FAILURE_DETECTION_GROUP) {
+            count = FAILURE_DETECTION_GROUP;
+        }
 
-            for (size_t j = 0; j < count; j++) {
-                unsigned char buffer[BUFFER_SIZE] = { 0 };
-                microswim_message_t message = { 0 };
-                microswim_member_t* member = &ms->members[members[j]];
-                microswim_status_message_construct(ms, &message, PING_REQ_MESSAGE, p->member);
-                size_t length = microswim_encode_message(&message, buffer, BUFFER_SIZE);
-                microswim_message_send(ms, member, (const char*)buffer, length);
-                p->ping_req = true;
-            }
+        for (size_t j = 0; j < count; j++) {
+            microswim_message_t message = { 0 };
+            microswim_member_t* member = &ms->members[members[j]];
+            microswim_status_message_construct(ms, &message, PING_REQ_MESSAGE, target);
+            microswim_message_send(ms, member, &message);
+            ping->ping_req = true;
+        }
+    }
 
-            i++;
-        } else {
-            i++;
+    size_t index = (size_t)(ping - ms->pings);
+    microswim_timer_schedule(ms, ping->timer, TIMER_PING, index, ping->suspect_deadline);
+}
+
+/**
+ * @brief Starts a protocol period.
+ *
+ * Pings the next GOSSIP_FANOUT members of the round-robin sequence, piggybacking the
+ * least disseminated updates, and waits for their ACKs.
+ */
+void microswim_ping_round(microswim_t* ms, uint64_t now) {
+    for (int i = 0; i < GOSSIP_FANOUT; i++) {
+        microswim_member_t* member = microswim_member_retrieve(ms);
+        if (member == NULL) {
+            continue;
         }
+
+        microswim_message_t message = { 0 };
+        const microswim_codec_t* codec = microswim_codec_select(ms, member);
+        microswim_message_construct(ms, codec, &message, PING_MESSAGE, ms->config.message_budget);
+
+        microswim_message_send(ms, member, &message);
+        microswim_ping_add(ms, member, now);
     }
 }
+
+/**
+ * @brief Fires the ping timers that are due, along with any other protocol timer.
+ */
+void microswim_pings_check(microswim_t* ms) {
+    microswim_timers_expire(ms, microswim_milliseconds());
+}
@@ -1,16 +1,23 @@
 #include "ping_req.h"
-#include "encode.h"
+#include "arena.h"
+#include "codec.h"
 #include "member.h"
 #include "message.h"
 #include "microswim_log.h"
+#include "record.h"
+#include "slab.h"
+#include "timer.h"
 #include "update.h"
 #include "utils.h"
 
-void microswim_ping_req_message_handle(microswim_t* ms, microswim_message_t* message) {
+void microswim_ping_req_message_handle(
+    microswim_t* ms, const microswim_update_record_t* sender,
+    const microswim_update_record_t* requested, uint64_t now) {
     microswim_member_t temp = { 0 };
-    strncpy((char*)temp.uuid, (char*)message->uuid, UUID_SIZE);
+    temp.uuid = sender->uuid;
     microswim_member_t* source = microswim_member_find(ms, &temp);
-    microswim_member_t* target = microswim_member_find(ms, &message->mu[0]);
+    microswim_record_to_member(requested, &temp);
+    microswim_member_t* target = microswim_member_find(ms, &temp);
 
     if (!source) {
         MICROSWIM_LOG_ERROR("Could not find the source member for ping_req");
@@ -21,22 +28,19 @@ void microswim_ping_req_message_handle(microswim_t* ms, microswim_message_t* mes
         return;
     }
 
-    unsigned char buffer[BUFFER_SIZE] = { 0 };
     microswim_message_t ping_message = { 0 };
-    microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE] = { 0 };
-    size_t update_count = microswim_updates_retrieve(ms, updates);
-    microswim_message_construct(ms, &ping_message, PING_MESSAGE, updates, update_count);
-    size_t length = microswim_encode_message(&ping_message, buffer, BUFFER_SIZE);
+    const microswim_codec_t* codec = microswim_codec_select(ms, target);
+    microswim_message_construct(ms, codec, &ping_message, PING_MESSAGE, ms->config.message_budget);
 
-    microswim_message_send(ms, target, (const char*)buffer, length);
-    microswim_ping_req_add(ms, source, target);
+    microswim_message_send(ms, target, &ping_message);
+    microswim_ping_req_add(ms, source, target, now);
 }
 
 microswim_ping_req_t*
     microswim_ping_req_find(microswim_t* ms, microswim_member_t* source, microswim_member_t* target) {
     for (size_t i = 0; i < ms->ping_req_count; i++) {
-        if (strncmp((char*)ms->ping_reqs[i].source->uuid, (char*)source->uuid, UUID_SIZE) == 0 &&
-            strncmp((char*)ms->ping_reqs[i].target->uuid, (char*)target->uuid, UUID_SIZE) == 0) {
+        if (microswim_handle_equal(ms->ping_reqs[i].source, source->handle) &&
+            microswim_handle_equal(ms->ping_reqs[i].target, target->handle)) {
             return &ms->ping_reqs[i];
         }
     }
@@ -44,49 +48,63 @@ microswim_ping_req_t*
     return NULL;
 }
 
+/**
+ * @brief Removes the ping-req by moving the last ping-req into its place.
+ */
 void microswim_ping_req_remove(microswim_t* ms, microswim_ping_req_t* ping) {
-    size_t index;
-    for (index = 0; index < ms->ping_req_count; index++) {
-        if (&(ms->ping_reqs[index]) == ping) {
-            break;
-        }
-    }
+    size_t index = (size_t)(ping - ms->ping_reqs);
+    size_t last = ms->ping_req_count - 1;
 
-    for (size_t i = index; i < ms->ping_req_count - 1; i++) {
-        ms->ping_reqs[i] = ms->ping_reqs[i + 1];
+    microswim_timer_cancel(ms, ping->timer);
+
+    if (index != last) {
+        ms->ping_reqs[index] = ms->ping_reqs[last];
+        if (ms->ping_reqs[index].timer != TIMER_NONE) {
+            ms->timers[ms->ping_reqs[index].timer].owner = index;
+        }
     }
 
     ms->ping_req_count--;
 }
 
-// Safe guard to not have any left.
+/**
+ * @brief Fires the ping-req timers that are due, along with any other protocol timer.
+ *
+ * A ping-req is dropped once its timeout passes. One whose members are gone can no
+ * longer be matched by an ACK, so it simply waits for its timeout.
+ */
 void microswim_ping_reqs_check(microswim_t* ms) {
-    for (size_t i = 0; i < ms->ping_req_count; i++) {
-        if (ms->ping_reqs[i].timeout < microswim_milliseconds()) {
-            microswim_ping_req_remove(ms, &ms->ping_reqs[i]);
-        }
-    }
+    microswim_timers_expire(ms, microswim_milliseconds());
 }
 
-void microswim_ping_req_add(microswim_t* ms, microswim_member_t* source, microswim_member_t* target) {
+void microswim_ping_req_add(
+    microswim_t* ms, microswim_member_t* source, microswim_member_t* target, uint64_t now) {
     microswim_ping_req_t* ping_req = microswim_ping_req_find(ms, source, target);
     if (ping_req != NULL) {
         microswim_ping_req_remove(ms, ping_req);
     }
 
-    if (source->uuid[0] != '\0' && target->uuid[0] != '\0') {
-        if (ms->ping_req_count < MAXIMUM_PINGS) {
-            ms->ping_reqs[ms->ping_req_count].source = source;
-            ms->ping_reqs[ms->ping_req_count].target = target;
+    if (!microswim_id_is_nil(&source->uuid) && !microswim_id_is_nil(&target->uuid)) {
+        microswim_ping_req_t* ping_reqs = microswim_arena_grow(
+            &ms->arena, ms->ping_reqs, &ms->ping_req_capacity, sizeof(microswim_ping_req_t),
+            ms->ping_req_count + 1, ms->config.maximum_pings);
+        if (ping_reqs != NULL) {
+            ms->ping_reqs = ping_reqs;
+            ms->ping_reqs[ms->ping_req_count].source = source->handle;
+            ms->ping_reqs[ms->ping_req_count].target = target->handle;
             ms->ping_reqs[ms->ping_req_count].timeout =
-                (microswim_milliseconds() + (uint64_t)(PROTOCOL_PERIOD * 1000));
+                (now + (uint64_t)(PROTOCOL_PERIOD * 1000));
+            ms->ping_reqs[ms->ping_req_count].timer = TIMER_NONE;
+            microswim_timer_schedule(
+                ms, TIMER_NONE, TIMER_PING_REQ, ms->ping_req_count,
+                ms->ping_reqs[ms->ping_req_count].timeout);
             ms->ping_req_count++;
         } else {
             MICROSWIM_LOG_WARN(
-                "Unable to add a new ping: the maximum limit (%d) has been "
-                "reached. Consider increasing MAXIMUM_PINGS to allow "
+                "Unable to add a new ping: the maximum limit (%zu) has been "
+                "reached. Consider increasing `maximum_pings` to allow "
                 "additional members.",
-                MAXIMUM_PINGS);
+                ms->config.maximum_pings);
         }
     }
 }
@@ -0,0 +1,123 @@
+#include "record.h"
+#include "microswim.h"
+
+/**
+ * @brief Takes the disseminated fields of the member.
+ */
+void microswim_record_from_member(microswim_update_record_t* record, const microswim_member_t* member) {
+    record->uuid = member->uuid;
+#ifdef RIOT_OS
+    memcpy(record->address, &member->addr.addr.ipv4, sizeof(record->address));
+    record->port = member->addr.port;
+#else
+    memcpy(record->address, &member->addr.sin_addr.s_addr, sizeof(record->address));
+    record->port = ntohs(member->addr.sin_port);
+#endif
+    record->status = (uint8_t)member->status;
+    record->incarnation = member->incarnation;
+}
+
+/**
+ * @brief Fills in the disseminated fields of the member, leaving its bookkeeping alone.
+ *
+ * NOTE: a record without an address leaves the member without one, family included.
+ */
+void microswim_record_to_member(const microswim_update_record_t* record, microswim_member_t* member) {
+    uint32_t address;
+    memcpy(&address, record->address, sizeof(address));
+
+    member->uuid = record->uuid;
+    memset(&member->addr, 0, sizeof(member->addr));
+    if (address != 0 || record->port != 0) {
+#ifdef RIOT_OS
+        member->addr.family = AF_INET;
+        memcpy(&member->addr.addr.ipv4, record->address, sizeof(record->address));
+        member->addr.port = record->port;
+#else
+        member->addr.sin_family = AF_INET;
+        memcpy(&member->addr.sin_addr.s_addr, record->address, sizeof(record->address));
+        member->addr.sin_port = htons(record->port);
+#endif
+    }
+    member->status = (microswim_member_status_t)record->status;
+    member->incarnation = record->incarnation;
+}
+
+static size_t microswim_record_decimal(unsigned int value, char* buffer) {
+    char digits[5];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+
+    return count;
+}
+
+/**
+ * @brief Writes the address as "a.b.c.d:port" into a buffer of at least URI_SIZE bytes.
+ *
+ * @return The length of the URI, without the terminating null byte.
+ */
+size_t microswim_record_uri_format(const microswim_update_record_t* record, char* buffer) {
+    size_t length = 0;
+    for (size_t i = 0; i < sizeof(record->address); i++) {
+        length += microswim_record_decimal(record->address[i], buffer + length);
+        buffer[length++] = (i + 1 < sizeof(record->address)) ? '.' : ':';
+    }
+
+    length += microswim_record_decimal(record->port, buffer + length);
+    buffer[length] = '\0';
+
+    return length;
+}
+
+/**
+ * @brief Reads a decimal number of at most `digits` digits, without a leading zero.
+ */
+static bool microswim_record_number(
+    const char* text, size_t length, size_t* position, size_t digits, unsigned long* value) {
+    size_t start = *position;
+    *value = 0;
+    while (*position < length && *position - start < digits && text[*position] >= '0' &&
+           text[*position] <= '9') {
+        *value = *value * 10 + (unsigned long)(text[(*position)++] - '0');
+    }
+
+    size_t count = *position - start;
+    return count > 0 && !(count > 1 && text[start] == '0');
+}
+
+/**
+ * @brief Parses an "a.b.c.d:port" URI into the address of the record.
+ *
+ * @return true if the URI is a valid IPv4 address and port, otherwise false and the record is
+ * left without an address.
+ */
+bool microswim_record_uri_parse(microswim_update_record_t* record, const char* text, size_t length) {
+    size_t position = 0;
+    unsigned long value;
+
+    for (size_t i = 0; i < sizeof(record->address); i++) {
+        char separator = (i + 1 < sizeof(record->address)) ? '.' : ':';
+        if (!microswim_record_number(text, length, &position, 3, &value) || value > UINT8_MAX ||
+            position >= length || text[position++] != separator) {
+            break;
+        }
+
+        record->address[i] = (uint8_t)value;
+        if (separator == ':' && microswim_record_number(text, length, &position, 5, &value) &&
+            position == length && value > 0 && value <= UINT16_MAX) {
+            record->port = (uint16_t)value;
+            return true;
+        }
+    }
+
+    memset(record->address, 0, sizeof(record->address));
+    record->port = 0;
+    return false;
+}
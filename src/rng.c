@@ -0,0 +1,75 @@
+#include "rng.h"
+#include "microswim.h"
+
+/**
+ * @brief Advances a splitmix64 state and returns its next output.
+ *
+ * Only used to spread a seed over the state of the generator, which must not be all zero.
+ */
+static uint64_t microswim_rng_splitmix(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t microswim_rng_rotate(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/**
+ * @brief Seeds the random number generator of the instance.
+ *
+ * `microswim_init` seeds it from the clock, `microswim_random` and the address of the instance.
+ * Hosts which want reproducible runs seed it again right after, instances seeded alike make the
+ * same choices.
+ */
+void microswim_rng_seed(microswim_t* ms, uint64_t seed) {
+    for (size_t i = 0; i < 4; i++) {
+        ms->rng[i] = microswim_rng_splitmix(&seed);
+    }
+}
+
+/**
+ * @brief Returns the next 64 random bits of the instance, from xoshiro256**.
+ *
+ * The state belongs to the instance, so instances sharing a process neither contend for it nor
+ * disturb the sequence of one another.
+ */
+uint64_t microswim_rng_next(microswim_t* ms) {
+    uint64_t* s = ms->rng;
+    uint64_t result = microswim_rng_rotate(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = microswim_rng_rotate(s[3], 45);
+
+    return result;
+}
+
+/**
+ * @brief Returns a number in [0, bound), every one of them equally likely.
+ *
+ * The values below 2^64 mod `bound`, which a plain modulo would fold onto the lowest numbers
+ * once more than the others, are drawn again.
+ *
+ * @return The number, or 0 if `bound` is 0.
+ */
+size_t microswim_rng_bounded(microswim_t* ms, size_t bound) {
+    if (bound == 0) {
+        return 0;
+    }
+
+    uint64_t range = (uint64_t)bound;
+    uint64_t threshold = -range % range;
+    for (;;) {
+        uint64_t value = microswim_rng_next(ms);
+        if (value >= threshold) {
+            return (size_t)(value % range);
+        }
+    }
+}
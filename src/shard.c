@@ -0,0 +1,420 @@
+// NOTE: recvmmsg is a GNU extension.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "shard.h"
+#include "arena.h"
+#include "message.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include <errno.h>
+#include <string.h>
+
+#if !defined(RIOT_OS) && defined(MICROSWIM_SHARDS) && defined(__linux__)
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if (SHARD_QUEUE & (SHARD_QUEUE - 1)) != 0
+#error "SHARD_QUEUE has to be a power of two"
+#endif
+
+/**
+ * @brief A receive worker with the buffers its datagrams are received and decoded in.
+ */
+typedef struct {
+    microswim_shards_t* shards;
+    pthread_t thread;
+    int socket;
+    bool running; // NOTE: Whether the thread has been started
+    struct mmsghdr headers[IO_BATCH];
+    struct iovec parts[IO_BATCH];
+    microswim_delta_t deltas[IO_BATCH];
+} microswim_shard_t;
+
+/**
+ * @brief A cell of the queue, which holds a delta once `sequence` is one past its position and
+ * is free for the position SHARD_QUEUE further on once the owner has recycled it.
+ */
+typedef struct {
+    size_t sequence; // NOTE: Accessed atomically
+    microswim_delta_t delta;
+} microswim_shard_cell_t;
+
+/**
+ * NOTE: The queue is a bounded ring which the workers claim cells of with a compare-and-swap on
+ * `tail`, and which only the owner takes cells out of, so `head` is its own.
+ */
+struct microswim_shards {
+    microswim_t* ms; // NOTE: Only its codecs are read by the workers
+    microswim_shard_t* workers;
+    size_t worker_count;
+    microswim_shard_cell_t* cells;
+    _Alignas(64) size_t tail; // NOTE: Next position a worker claims, accessed atomically
+    _Alignas(64) size_t head; // NOTE: Next position the owner takes
+    size_t taken;             // NOTE: Cells handed out, until they are recycled
+    size_t dropped;           // NOTE: Accessed atomically
+    int event;                // NOTE: Signalled by a worker once it has queued deltas
+    int stop;                 // NOTE: Signalled once to stop all the workers
+};
+
+/**
+ * @brief Opens a socket bound to `addr`, in the `SO_REUSEPORT` group of the address if
+ * `group` is set, with a receive buffer of `size` bytes unless it is 0.
+ *
+ * @return The socket, or -1 if it could not be bound.
+ */
+static int microswim_shard_bind(const struct sockaddr_in* addr, bool group, int size) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (size > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    int enable = 1;
+    if ((group && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) ||
+        bind(fd, (const struct sockaddr*)addr, sizeof(*addr)) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Copies the delta into the next free cell of the queue.
+ *
+ * @return true if the delta is queued, false if the queue is full.
+ */
+static bool microswim_shards_push(microswim_shards_t* shards, const microswim_delta_t* delta) {
+    size_t position = __atomic_load_n(&shards->tail, __ATOMIC_RELAXED);
+    microswim_shard_cell_t* cell;
+
+    for (;;) {
+        cell = &shards->cells[position & (SHARD_QUEUE - 1)];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t difference = (ptrdiff_t)(sequence - position);
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(
+                    &shards->tail, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = __atomic_load_n(&shards->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    // NOTE: only the datagram's bytes and its terminating null byte are copied.
+    memcpy(&cell->delta, delta, offsetof(microswim_delta_t, buffer) + (size_t)delta->length + 1);
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * @brief Receives datagrams on the worker's socket in batches and queues them decoded, until
+ * the workers are stopped.
+ */
+static void* microswim_shard_run(void* argument) {
+    microswim_shard_t* shard = argument;
+    microswim_shards_t* shards = shard->shards;
+    struct pollfd fds[2] = {
+        { .fd = shard->socket, .events = POLLIN },
+        { .fd = shards->stop, .events = POLLIN },
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            MICROSWIM_LOG_ERROR("(microswim_shard_run) poll failed: %d %s", errno, strerror(errno));
+            return NULL;
+        }
+
+        if (fds[1].revents != 0) {
+            return NULL;
+        }
+
+        // NOTE: the owner may have made the first socket non-blocking, the others block.
+        int result = recvmmsg(shard->socket, shard->headers, IO_BATCH, MSG_DONTWAIT, NULL);
+        if (result < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                MICROSWIM_LOG_ERROR("(microswim_shard_run) recvmmsg failed: %d %s", errno, strerror(errno));
+            }
+            continue;
+        }
+
+        size_t queued = 0;
+        for (int i = 0; i < result; i++) {
+            microswim_delta_t* delta = &shard->deltas[i];
+            delta->length = (ssize_t)shard->headers[i].msg_len;
+            delta->buffer[delta->length] = '\0';
+
+            if (!microswim_message_delta_decode(shards->ms, delta)) {
+                continue;
+            }
+
+            if (microswim_shards_push(shards, delta)) {
+                queued++;
+            } else {
+                __atomic_add_fetch(&shards->dropped, 1, __ATOMIC_RELAXED);
+            }
+        }
+
+        if (queued > 0) {
+            uint64_t signal = 1;
+            if (write(shards->event, &signal, sizeof(signal)) < 0) {
+                MICROSWIM_LOG_ERROR("(microswim_shard_run) write failed: %d %s", errno, strerror(errno));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Starts `count` receive workers on the instance's address, whose socket has to be
+ * set up already.
+ *
+ * The instance's socket is bound anew as the first socket of the `SO_REUSEPORT` group, since
+ * it was bound without the option. The instance keeps sending from it and owns it as before,
+ * while its first worker receives on it.
+ *
+ * @return The workers, or NULL if they could not be started, in which case the instance keeps
+ * receiving on its own socket.
+ */
+microswim_shards_t* microswim_shards_create(microswim_arena_t* arena, microswim_t* ms, size_t count) {
+    if (count == 0) {
+        return NULL;
+    }
+
+    microswim_shards_t* shards =
+        microswim_arena_reallocate(arena, NULL, 0, sizeof(microswim_shards_t));
+    if (shards == NULL) {
+        MICROSWIM_LOG_WARN("Unable to allocate the receive workers");
+        return NULL;
+    }
+
+    memset(shards, 0, sizeof(*shards));
+    shards->ms = ms;
+    shards->event = -1;
+    shards->stop = -1;
+
+    shards->cells = microswim_arena_reallocate(arena, NULL, 0, SHARD_QUEUE * sizeof(microswim_shard_cell_t));
+    shards->workers = microswim_arena_reallocate(arena, NULL, 0, count * sizeof(microswim_shard_t));
+    if (shards->cells == NULL || shards->workers == NULL) {
+        errno = ENOMEM;
+        goto unavailable;
+    }
+
+    for (size_t i = 0; i < SHARD_QUEUE; i++) {
+        shards->cells[i].sequence = i;
+    }
+
+    shards->event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    shards->stop = eventfd(0, EFD_CLOEXEC);
+    if (shards->event < 0 || shards->stop < 0) {
+        goto unavailable;
+    }
+
+    // NOTE: every socket of the group gets the receive buffer of the instance's socket.
+    int size = 0;
+    socklen_t length = sizeof(size);
+    if (getsockopt(ms->socket, SOL_SOCKET, SO_RCVBUF, &size, &length) != 0) {
+        size = 0;
+    }
+
+    close(ms->socket);
+    ms->socket = -1;
+
+    memset(shards->workers, 0, count * sizeof(microswim_shard_t));
+    for (size_t i = 0; i < count; i++) {
+        microswim_shard_t* shard = &shards->workers[i];
+        shard->shards = shards;
+        shard->socket = microswim_shard_bind(&ms->self.addr, true, size);
+        shards->worker_count++;
+        if (shard->socket < 0) {
+            goto unavailable;
+        }
+
+        if (i == 0) {
+            ms->socket = shard->socket;
+        }
+
+        for (size_t j = 0; j < IO_BATCH; j++) {
+            // NOTE: one byte of BUFFER_SIZE is kept for the terminating null byte.
+            shard->parts[j].iov_base = shard->deltas[j].buffer;
+            shard->parts[j].iov_len = BUFFER_SIZE - 1;
+            shard->headers[j].msg_hdr.msg_iov = &shard->parts[j];
+            shard->headers[j].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int result = pthread_create(&shards->workers[i].thread, NULL, microswim_shard_run, &shards->workers[i]);
+        if (result != 0) {
+            errno = result;
+            goto unavailable;
+        }
+
+        shards->workers[i].running = true;
+    }
+
+    return shards;
+
+unavailable:
+    MICROSWIM_LOG_WARN("The receive workers are unavailable, receiving on the instance's thread: %d %s", errno, strerror(errno));
+    microswim_shards_destroy(arena, shards);
+    if (ms->socket < 0) {
+        ms->socket = microswim_shard_bind(&ms->self.addr, false, 0);
+        if (ms->socket < 0) {
+            MICROSWIM_LOG_ERROR("Unable to bind the socket anew: %d %s", errno, strerror(errno));
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stops the workers and closes their sockets but the instance's, dropping the deltas
+ * not applied yet.
+ */
+void microswim_shards_destroy(microswim_arena_t* arena, microswim_shards_t* shards) {
+    if (shards == NULL) {
+        return;
+    }
+
+    if (shards->stop >= 0) {
+        uint64_t signal = 1;
+        if (write(shards->stop, &signal, sizeof(signal)) < 0) {
+            MICROSWIM_LOG_ERROR("(microswim_shards_destroy) write failed: %d %s", errno, strerror(errno));
+        }
+    }
+
+    for (size_t i = 0; i < shards->worker_count; i++) {
+        microswim_shard_t* shard = &shards->workers[i];
+        if (shard->running) {
+            pthread_join(shard->thread, NULL);
+        }
+
+        if (i > 0 && shard->socket >= 0) {
+            close(shard->socket);
+        }
+    }
+
+    if (shards->stop >= 0) {
+        close(shards->stop);
+    }
+
+    if (shards->event >= 0) {
+        close(shards->event);
+    }
+
+    microswim_arena_release(arena, shards->workers);
+    microswim_arena_release(arena, shards->cells);
+    microswim_arena_release(arena, shards);
+}
+
+/**
+ * @brief The file descriptor which becomes readable when deltas have been queued.
+ */
+int microswim_shards_descriptor(const microswim_shards_t* shards) {
+    return shards->event;
+}
+
+/**
+ * @brief The number of decoded datagrams dropped because the queue was full.
+ */
+size_t microswim_shards_dropped(const microswim_shards_t* shards) {
+    return __atomic_load_n(&shards->dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Hands out up to `count` queued deltas, which stay in the queue until
+ * `microswim_shards_recycle` is called.
+ *
+ * @return The number of deltas handed out, less than `count` once none is left.
+ */
+size_t microswim_shards_receive(microswim_shards_t* shards, microswim_delta_t** deltas, size_t count) {
+    // NOTE: the signal is consumed before the queue is looked at, so that a delta queued after
+    // the last one handed out signals anew.
+    uint64_t signals;
+    if (read(shards->event, &signals, sizeof(signals)) < 0 && errno != EAGAIN) {
+        MICROSWIM_LOG_ERROR("(microswim_shards_receive) read failed: %d %s", errno, strerror(errno));
+    }
+
+    size_t handed = shards->taken;
+    for (; handed < count; handed++) {
+        size_t position = shards->head + handed;
+        microswim_shard_cell_t* cell = &shards->cells[position & (SHARD_QUEUE - 1)];
+        if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != position + 1) {
+            break;
+        }
+
+        deltas[handed - shards->taken] = &cell->delta;
+    }
+
+    count = handed - shards->taken;
+    shards->taken = handed;
+    return count;
+}
+
+/**
+ * @brief Frees the cells of the deltas handed out for the workers to queue further deltas in.
+ */
+void microswim_shards_recycle(microswim_shards_t* shards) {
+    for (size_t i = 0; i < shards->taken; i++) {
+        size_t position = shards->head + i;
+        microswim_shard_cell_t* cell = &shards->cells[position & (SHARD_QUEUE - 1)];
+        __atomic_store_n(&cell->sequence, position + SHARD_QUEUE, __ATOMIC_RELEASE);
+    }
+
+    shards->head += shards->taken;
+    shards->taken = 0;
+}
+
+#elif !defined(RIOT_OS)
+// NOTE: Without the receive workers compiled in, the instance receives on its own thread.
+microswim_shards_t* microswim_shards_create(microswim_arena_t* arena, microswim_t* ms, size_t count) {
+    (void)arena;
+    (void)ms;
+    (void)count;
+    return NULL;
+}
+
+void microswim_shards_destroy(microswim_arena_t* arena, microswim_shards_t* shards) {
+    (void)arena;
+    (void)shards;
+}
+
+int microswim_shards_descriptor(const microswim_shards_t* shards) {
+    (void)shards;
+    return -1;
+}
+
+size_t microswim_shards_dropped(const microswim_shards_t* shards) {
+    (void)shards;
+    return 0;
+}
+
+size_t microswim_shards_receive(microswim_shards_t* shards, microswim_delta_t** deltas, size_t count) {
+    (void)shards;
+    (void)deltas;
+    (void)count;
+    return 0;
+}
+
+void microswim_shards_recycle(microswim_shards_t* shards) {
+    (void)shards;
+}
+#endif
@@ -0,0 +1,112 @@
+#include "slab.h"
+#include "arena.h"
+#include "microswim.h"
+#include "microswim_log.h"
+
+/**
+ * @brief Hands out a slot for a member stored at `position` of the `table`.
+ *
+ * Released slots are reused first. The slot table is grown otherwise, up to
+ * one slot for each member of both the member and the confirmed member arrays.
+ *
+ * @return The handle of the member, or a zeroed handle if no slot is available.
+ */
+microswim_handle_t
+    microswim_slab_acquire(microswim_t* ms, microswim_slab_table_t table, size_t position) {
+    microswim_handle_t handle = { 0 };
+    size_t slot = ms->free_slot;
+
+    if (slot != SLAB_SLOT_NONE) {
+        ms->free_slot = ms->slots[slot].position;
+    } else {
+        microswim_slot_t* slots = microswim_arena_grow(
+            &ms->arena, ms->slots, &ms->slot_capacity, sizeof(microswim_slot_t), ms->slot_count + 1,
+            2 * ms->config.maximum_members);
+        if (slots == NULL) {
+            MICROSWIM_LOG_ERROR("Cannot hand out more than %zu member slots\n", ms->slot_capacity);
+            return handle;
+        }
+
+        ms->slots = slots;
+        slot = ms->slot_count++;
+    }
+
+    microswim_slot_t* s = &ms->slots[slot];
+    // NOTE: generation 0 is skipped, so that a zeroed handle never resolves.
+    if (++s->generation == 0) {
+        s->generation = 1;
+    }
+    s->table = table;
+    s->position = position;
+    s->timer = TIMER_NONE;
+    s->update = UPDATE_NONE;
+    s->codec = 0;
+
+    handle.slot = (uint32_t)slot;
+    handle.generation = s->generation;
+
+    return handle;
+}
+
+/**
+ * @brief Records that the member behind the handle now lives at `position` of the `table`.
+ */
+void microswim_slab_relocate(
+    microswim_t* ms, microswim_handle_t handle, microswim_slab_table_t table, size_t position) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, handle);
+    if (slot != NULL) {
+        slot->table = table;
+        slot->position = position;
+    }
+}
+
+/**
+ * @brief Returns the slot to the free list.
+ *
+ * Bumping the generation makes every outstanding copy of the handle stale.
+ */
+void microswim_slab_release(microswim_t* ms, microswim_handle_t handle) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, handle);
+    if (slot == NULL) {
+        return;
+    }
+
+    if (++slot->generation == 0) {
+        slot->generation = 1;
+    }
+    slot->table = SLAB_FREE;
+    slot->position = ms->free_slot;
+    ms->free_slot = handle.slot;
+}
+
+/**
+ * @return A pointer to the slot behind the handle, or NULL if the handle is stale.
+ */
+microswim_slot_t* microswim_slab_slot(microswim_t* ms, microswim_handle_t handle) {
+    if (handle.slot >= ms->slot_count) {
+        return NULL;
+    }
+
+    microswim_slot_t* slot = &ms->slots[handle.slot];
+    if (slot->generation != handle.generation || slot->table == SLAB_FREE) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+/**
+ * @return A pointer to the member behind the handle, or NULL if the handle is stale.
+ */
+microswim_member_t* microswim_slab_resolve(microswim_t* ms, microswim_handle_t handle) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, handle);
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    if (slot->table == SLAB_MEMBERS) {
+        return &ms->members[slot->position];
+    }
+
+    return &ms->confirmed[slot->position];
+}
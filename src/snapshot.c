@@ -0,0 +1,202 @@
+#include "snapshot.h"
+#include "arena.h"
+#include "id.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "record.h"
+#include <string.h>
+
+// NOTE: One buffer is published, one may be held by slow readers, and the third one is left
+// for the next revision.
+#define SNAPSHOT_BUFFERS 3
+
+/**
+ * @brief The published snapshots of an instance.
+ *
+ * Only the thread which drives the instance writes to them. A buffer is refilled only while
+ * it is not the published one and no reader holds it: readers register in `readers` before
+ * they check that the buffer they picked is still `current`, so the writer either sees them
+ * or they see the buffer has been replaced and pick again.
+ */
+struct microswim_snapshots {
+    microswim_snapshot_t snapshots[SNAPSHOT_BUFFERS];
+    microswim_update_record_t* records[SNAPSHOT_BUFFERS];
+    size_t capacities[SNAPSHOT_BUFFERS];
+    size_t readers[SNAPSHOT_BUFFERS]; // NOTE: Accessed atomically
+    size_t current;                   // NOTE: Index of the published snapshot, accessed atomically
+};
+
+/**
+ * @brief Appends the records of the identified members of the array to the buffer.
+ *
+ * @return The number of records appended.
+ */
+static size_t microswim_snapshot_copy(
+    microswim_update_record_t* records, const microswim_member_t* members, size_t count) {
+    size_t copied = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (microswim_id_is_nil(&members[i].uuid)) {
+            continue;
+        }
+
+        microswim_record_from_member(&records[copied++], &members[i]);
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Copies the membership of the instance into the snapshot buffer at `index`.
+ *
+ * @return true if the buffer holds the current revision, false if it could not be grown.
+ */
+static bool microswim_snapshot_fill(microswim_t* ms, size_t index) {
+    microswim_snapshots_t* snapshots = ms->snapshots;
+
+    size_t count = ms->member_count + ms->confirmed_count;
+    microswim_update_record_t* records = microswim_arena_grow(
+        &ms->arena, snapshots->records[index], &snapshots->capacities[index],
+        sizeof(microswim_update_record_t), count, 2 * ms->config.maximum_members);
+    if (records == NULL) {
+        return false;
+    }
+
+    snapshots->records[index] = records;
+
+    microswim_snapshot_t* snapshot = &snapshots->snapshots[index];
+    snapshot->revision = ms->revision;
+    snapshot->records = records;
+    snapshot->member_count = microswim_snapshot_copy(records, ms->members, ms->member_count);
+    snapshot->confirmed_count = microswim_snapshot_copy(
+        records + snapshot->member_count, ms->confirmed, ms->confirmed_count);
+
+    return true;
+}
+
+/**
+ * @brief Starts publishing snapshots of the membership for reader threads.
+ *
+ * It has to be called before any reader may look at the instance, which publishes the first
+ * snapshot right away. `microswim_loop` publishes the later ones, hosts driving the instance
+ * themselves call `microswim_snapshot_publish`.
+ *
+ * @return true if snapshots are published, false if they could not be allocated.
+ */
+bool microswim_snapshots_enable(microswim_t* ms) {
+    if (ms->snapshots != NULL) {
+        return true;
+    }
+
+    microswim_snapshots_t* snapshots =
+        microswim_arena_reallocate(&ms->arena, NULL, 0, sizeof(microswim_snapshots_t));
+    if (snapshots == NULL) {
+        MICROSWIM_LOG_ERROR("Unable to allocate the membership snapshots\n");
+        return false;
+    }
+
+    memset(snapshots, 0, sizeof(*snapshots));
+    ms->snapshots = snapshots;
+
+    if (!microswim_snapshot_fill(ms, 0)) {
+        microswim_snapshots_disable(ms);
+        return false;
+    }
+
+    __atomic_store_n(&snapshots->current, 0, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+/**
+ * @brief Stops publishing snapshots and releases them.
+ *
+ * No reader may hold or acquire a snapshot of the instance any more.
+ */
+void microswim_snapshots_disable(microswim_t* ms) {
+    microswim_snapshots_t* snapshots = ms->snapshots;
+    if (snapshots == NULL) {
+        return;
+    }
+
+    ms->snapshots = NULL;
+    for (size_t i = SNAPSHOT_BUFFERS; i > 0; i--) {
+        microswim_arena_release(&ms->arena, snapshots->records[i - 1]);
+    }
+    microswim_arena_release(&ms->arena, snapshots);
+}
+
+/**
+ * @brief Publishes a snapshot of the membership, if it has changed since the last one.
+ *
+ * It is called from the thread which drives the instance, and never waits for the readers:
+ * while they hold both buffers which are not published, the snapshot is published by a later
+ * call instead.
+ *
+ * @return true if the published snapshot is up to date, false otherwise.
+ */
+bool microswim_snapshot_publish(microswim_t* ms) {
+    microswim_snapshots_t* snapshots = ms->snapshots;
+    if (snapshots == NULL) {
+        return false;
+    }
+
+    size_t current = __atomic_load_n(&snapshots->current, __ATOMIC_RELAXED);
+    if (snapshots->snapshots[current].revision == ms->revision) {
+        return true;
+    }
+
+    for (size_t i = 1; i < SNAPSHOT_BUFFERS; i++) {
+        size_t index = (current + i) % SNAPSHOT_BUFFERS;
+        if (__atomic_load_n(&snapshots->readers[index], __ATOMIC_SEQ_CST) != 0) {
+            continue;
+        }
+
+        if (!microswim_snapshot_fill(ms, index)) {
+            return false;
+        }
+
+        __atomic_store_n(&snapshots->current, index, __ATOMIC_SEQ_CST);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Takes hold of the published snapshot, which stays untouched until it is released.
+ *
+ * It takes no lock and may be called from any thread. A reader holding a snapshot for long
+ * only delays the publication of later ones, never the protocol.
+ *
+ * @return The published snapshot, or NULL if the instance publishes none.
+ */
+const microswim_snapshot_t* microswim_snapshot_acquire(microswim_t* ms) {
+    microswim_snapshots_t* snapshots = ms->snapshots;
+    if (snapshots == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        size_t index = __atomic_load_n(&snapshots->current, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&snapshots->readers[index], 1, __ATOMIC_SEQ_CST);
+
+        // NOTE: The buffer may have been replaced, and refilled, before the reader registered.
+        if (__atomic_load_n(&snapshots->current, __ATOMIC_SEQ_CST) == index) {
+            return &snapshots->snapshots[index];
+        }
+
+        __atomic_sub_fetch(&snapshots->readers[index], 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Lets go of a snapshot taken by `microswim_snapshot_acquire`.
+ */
+void microswim_snapshot_release(microswim_t* ms, const microswim_snapshot_t* snapshot) {
+    microswim_snapshots_t* snapshots = ms->snapshots;
+    if (snapshots == NULL || snapshot == NULL) {
+        return;
+    }
+
+    size_t index = (size_t)(snapshot - snapshots->snapshots);
+    __atomic_sub_fetch(&snapshots->readers[index], 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,164 @@
+#include "timer.h"
+#include "arena.h"
+#include "member.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include "ping.h"
+#include "ping_req.h"
+
+/**
+ * @brief Returns the field of the owner that records the position of its timer.
+ */
+static size_t* microswim_timer_owner(microswim_t* ms, microswim_timer_t* timer) {
+    switch (timer->type) {
+        case TIMER_PING:
+            return &ms->pings[timer->owner].timer;
+        case TIMER_PING_REQ:
+            return &ms->ping_reqs[timer->owner].timer;
+        case TIMER_SUSPICION:
+        default:
+            return &ms->slots[timer->owner].timer;
+    }
+}
+
+static void microswim_timer_place(microswim_t* ms, size_t position, microswim_timer_t timer) {
+    ms->timers[position] = timer;
+    *microswim_timer_owner(ms, &ms->timers[position]) = position;
+}
+
+static void microswim_timer_sift_up(microswim_t* ms, size_t position) {
+    microswim_timer_t timer = ms->timers[position];
+
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (ms->timers[parent].deadline <= timer.deadline) {
+            break;
+        }
+
+        microswim_timer_place(ms, position, ms->timers[parent]);
+        position = parent;
+    }
+
+    microswim_timer_place(ms, position, timer);
+}
+
+static void microswim_timer_sift_down(microswim_t* ms, size_t position) {
+    microswim_timer_t timer = ms->timers[position];
+
+    for (;;) {
+        size_t child = 2 * position + 1;
+        if (child >= ms->timer_count) {
+            break;
+        }
+
+        if (child + 1 < ms->timer_count &&
+            ms->timers[child + 1].deadline < ms->timers[child].deadline) {
+            child++;
+        }
+
+        if (timer.deadline <= ms->timers[child].deadline) {
+            break;
+        }
+
+        microswim_timer_place(ms, position, ms->timers[child]);
+        position = child;
+    }
+
+    microswim_timer_place(ms, position, timer);
+}
+
+/**
+ * @brief Schedules the timer of the owner to fire at `deadline`.
+ *
+ * If the owner already has a timer (`timer` is not TIMER_NONE), it is moved to the
+ * new deadline instead. The position of the timer is kept up to date in the owner
+ * as the heap is reordered.
+ *
+ * @return true if the timer was scheduled, false if the timer heap is full.
+ */
+bool microswim_timer_schedule(
+    microswim_t* ms, size_t timer, microswim_timer_type_t type, size_t owner, uint64_t deadline) {
+    if (timer != TIMER_NONE) {
+        uint64_t previous = ms->timers[timer].deadline;
+        ms->timers[timer].deadline = deadline;
+        if (deadline < previous) {
+            microswim_timer_sift_up(ms, timer);
+        } else {
+            microswim_timer_sift_down(ms, timer);
+        }
+
+        return true;
+    }
+
+    microswim_timer_t* timers = microswim_arena_grow(
+        &ms->arena, ms->timers, &ms->timer_capacity, sizeof(microswim_timer_t), ms->timer_count + 1,
+        2 * ms->config.maximum_pings + ms->config.maximum_members);
+    if (timers == NULL) {
+        MICROSWIM_LOG_ERROR("Cannot schedule more than %zu timers\n", ms->timer_capacity);
+        return false;
+    }
+
+    ms->timers = timers;
+    ms->timers[ms->timer_count].deadline = deadline;
+    ms->timers[ms->timer_count].type = type;
+    ms->timers[ms->timer_count].owner = owner;
+    microswim_timer_sift_up(ms, ms->timer_count++);
+
+    return true;
+}
+
+/**
+ * @brief Cancels the timer at `timer` and marks its owner as having no timer.
+ */
+void microswim_timer_cancel(microswim_t* ms, size_t timer) {
+    if (timer == TIMER_NONE || timer >= ms->timer_count) {
+        return;
+    }
+
+    *microswim_timer_owner(ms, &ms->timers[timer]) = TIMER_NONE;
+
+    size_t last = --ms->timer_count;
+    if (timer == last) {
+        return;
+    }
+
+    uint64_t deadline = ms->timers[timer].deadline;
+    microswim_timer_place(ms, timer, ms->timers[last]);
+    if (ms->timers[timer].deadline < deadline) {
+        microswim_timer_sift_up(ms, timer);
+    } else {
+        microswim_timer_sift_down(ms, timer);
+    }
+}
+
+/**
+ * @return The earliest deadline of all the scheduled timers, or UINT64_MAX if there are none.
+ */
+uint64_t microswim_timers_next(microswim_t* ms) {
+    return (ms->timer_count > 0) ? ms->timers[0].deadline : UINT64_MAX;
+}
+
+/**
+ * @brief Fires every timer whose deadline is not later than `now`.
+ *
+ * Only the timers that fire are visited. A timer is removed from the heap before its
+ * owner handles it, so the owner is free to schedule a new one.
+ */
+void microswim_timers_expire(microswim_t* ms, uint64_t now) {
+    while (ms->timer_count > 0 && ms->timers[0].deadline <= now) {
+        microswim_timer_t timer = ms->timers[0];
+        microswim_timer_cancel(ms, 0);
+
+        switch (timer.type) {
+            case TIMER_PING:
+                microswim_ping_expire(ms, &ms->pings[timer.owner], now);
+                break;
+            case TIMER_PING_REQ:
+                microswim_ping_req_remove(ms, &ms->ping_reqs[timer.owner]);
+                break;
+            case TIMER_SUSPICION:
+                microswim_member_expire(ms, timer.owner);
+                break;
+        }
+    }
+}
@@ -1,64 +1,222 @@
 #include "update.h"
+#include "arena.h"
+#include "hash.h"
 #include "microswim.h"
 #include "microswim_log.h"
+#include "slab.h"
 #include <stdlib.h>
 
+static void microswim_update_place(microswim_t* ms, size_t position, microswim_update_t update) {
+    ms->updates[position] = update;
+
+    microswim_slot_t* slot = microswim_slab_slot(ms, update.member);
+    if (slot != NULL) {
+        slot->update = position;
+    }
+}
+
+static void microswim_update_sift_up(microswim_t* ms, size_t position) {
+    microswim_update_t update = ms->updates[position];
+
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (ms->updates[parent].count <= update.count) {
+            break;
+        }
+
+        microswim_update_place(ms, position, ms->updates[parent]);
+        position = parent;
+    }
+
+    microswim_update_place(ms, position, update);
+}
+
+static void microswim_update_sift_down(microswim_t* ms, size_t position) {
+    microswim_update_t update = ms->updates[position];
+
+    for (;;) {
+        size_t child = 2 * position + 1;
+        if (child >= ms->update_count) {
+            break;
+        }
+
+        if (child + 1 < ms->update_count &&
+            ms->updates[child + 1].count < ms->updates[child].count) {
+            child++;
+        }
+
+        if (update.count <= ms->updates[child].count) {
+            break;
+        }
+
+        microswim_update_place(ms, position, ms->updates[child]);
+        position = child;
+    }
+
+    microswim_update_place(ms, position, update);
+}
+
+/**
+ * @brief Returns the slot of the member, looking it up by UUID if the member is a copy.
+ */
+static microswim_slot_t* microswim_update_slot(microswim_t* ms, microswim_member_t* member) {
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot != NULL) {
+        return slot;
+    }
+
+    microswim_hash_entry_t* entry = microswim_hash_find(ms, &member->uuid);
+    if (entry == NULL || entry->slot == HASH_INDEX_NONE) {
+        return NULL;
+    }
+
+    return &ms->slots[entry->slot];
+}
+
+/**
+ * @brief Returns how many times an update is piggybacked before it is retired.
+ *
+ * SWIM disseminates every update λ·log(n) times, which is enough for it to reach the
+ * whole group with high probability.
+ */
+static size_t microswim_updates_limit(microswim_t* ms) {
+    size_t bits = 1;
+    for (size_t n = ms->member_count + 1; n > 2; n = (n + 1) / 2) {
+        bits++;
+    }
+
+    return RETRANSMIT_MULTIPLIER * bits;
+}
+
 /**
- * @brief Adds an update to the central update array, referencing the supplied member.
+ * @brief Queues the latest state of the supplied member for dissemination.
+ *
+ * The updates form a min-heap ordered by how many times they have been sent. If the
+ * member already has an update queued, it is reset in place so that the new state is
+ * disseminated from scratch. Members without a UUID are not queued, since their
+ * updates could not be told apart by the recipients.
+ *
+ * @return A pointer to the update, or NULL if it could not be queued.
  */
 microswim_update_t* microswim_update_add(microswim_t* ms, microswim_member_t* member) {
-    if (ms->update_count > MAXIMUM_UPDATES) {
-        MICROSWIM_LOG_ERROR("Cannot add more than %d updates\n", MAXIMUM_UPDATES);
+    if (microswim_id_is_nil(&member->uuid)) {
         return NULL;
     }
 
-    ms->updates[ms->update_count].member = member;
+    microswim_slot_t* slot = microswim_slab_slot(ms, member->handle);
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    if (slot->update != UPDATE_NONE) {
+        size_t position = slot->update;
+        ms->updates[position].count = 0;
+        microswim_update_sift_up(ms, position);
+
+        return &ms->updates[slot->update];
+    }
+
+    microswim_update_t* updates = microswim_arena_grow(
+        &ms->arena, ms->updates, &ms->update_capacity, sizeof(microswim_update_t),
+        ms->update_count + 1, ms->config.maximum_updates);
+    if (updates == NULL) {
+        MICROSWIM_LOG_ERROR("Cannot add more than %zu updates\n", ms->update_capacity);
+        return NULL;
+    }
+
+    ms->updates = updates;
+
+    ms->updates[ms->update_count].member = member->handle;
     ms->updates[ms->update_count].count = 0;
+    microswim_update_sift_up(ms, ms->update_count++);
 
-    return &ms->updates[ms->update_count++];
+    return &ms->updates[slot->update];
 }
 
 /**
- * @brief Finds update referencing the supplied member from the central update array.
+ * @brief Finds the update queued for the supplied member.
  */
 microswim_update_t* microswim_update_find(microswim_t* ms, microswim_member_t* member) {
-    for (size_t i = 0; i < ms->update_count; i++) {
-        if (strncmp((char*)ms->updates[i].member->uuid, (char*)member->uuid, UUID_SIZE) == 0) {
-            return &ms->updates[i];
-        }
+    microswim_slot_t* slot = microswim_update_slot(ms, member);
+    if (slot == NULL || slot->update == UPDATE_NONE) {
+        return NULL;
     }
 
-    return NULL;
+    return &ms->updates[slot->update];
 }
 
-static void microswim_sort_updates_by_count(microswim_update_t* updates, size_t count) {
-    for (size_t i = 1; i < count; ++i) {
-        microswim_update_t key = updates[i];
-        size_t j = i;
+/**
+ * @brief Removes the update from the queue.
+ *
+ * The last update takes the place of the removed one and is then moved to restore the
+ * heap order.
+ *
+ * @return A pointer to the update now at the position of the removed one, or NULL if there is none.
+ */
+microswim_update_t* microswim_update_remove(microswim_t* ms, microswim_update_t* update) {
+    size_t index = (size_t)(update - ms->updates);
+    size_t last = --ms->update_count;
 
-        while (j > 0 && updates[j - 1].count > key.count) {
-            updates[j] = updates[j - 1];
-            j--;
-        }
+    microswim_slot_t* slot = microswim_slab_slot(ms, update->member);
+    if (slot != NULL) {
+        slot->update = UPDATE_NONE;
+    }
+
+    if (index == last) {
+        return NULL;
+    }
 
-        updates[j] = key;
+    size_t count = ms->updates[index].count;
+    microswim_update_place(ms, index, ms->updates[last]);
+    if (ms->updates[index].count < count) {
+        microswim_update_sift_up(ms, index);
+    } else {
+        microswim_update_sift_down(ms, index);
     }
+
+    return &ms->updates[index];
 }
 
 /**
- * @brief Selects and retrieves the least used updates.
+ * @brief Takes the least disseminated update off the top of the queue.
+ *
+ * The taken updates have to be handed back with `microswim_updates_restore` once it is
+ * known which of them have been sent. Taking them out first keeps the same update from
+ * being selected twice for one message.
+ *
+ * @return true if an update was taken, false if the queue is empty.
  */
-size_t microswim_updates_retrieve(microswim_t* ms, microswim_update_t* updates[MAXIMUM_MEMBERS_IN_AN_UPDATE]) {
-    microswim_sort_updates_by_count(ms->updates, ms->update_count);
-    size_t count = 0;
-
-    for (size_t j = 0; (j < ms->update_count && j < MAXIMUM_MEMBERS_IN_AN_UPDATE); j++) {
-        if (ms->updates[j].member->uuid[0] != '\0') {
-            updates[count] = &ms->updates[j];
-            ms->updates[j].count++;
-            count++;
+bool microswim_updates_take(microswim_t* ms, microswim_update_t* update) {
+    while (ms->update_count > 0) {
+        *update = ms->updates[0];
+        microswim_update_remove(ms, &ms->updates[0]);
+
+        if (microswim_slab_resolve(ms, update->member) != NULL) {
+            return true;
         }
     }
 
-    return count;
+    return false;
+}
+
+/**
+ * @brief Puts the taken updates back into the queue.
+ *
+ * The first `sent` updates have their count incremented, and are retired instead once
+ * they have been sent often enough. The remaining ones are put back untouched.
+ */
+void microswim_updates_restore(
+    microswim_t* ms, microswim_update_t* updates, size_t count, size_t sent) {
+    size_t limit = microswim_updates_limit(ms);
+
+    for (size_t i = 0; i < count; i++) {
+        microswim_update_t update = updates[i];
+        if (i < sent && ++update.count >= limit) {
+            continue;
+        }
+
+        // NOTE: the capacity cannot be exceeded, since the updates have just been taken out.
+        ms->updates[ms->update_count] = update;
+        microswim_update_sift_up(ms, ms->update_count++);
+    }
 }
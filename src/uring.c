@@ -0,0 +1,457 @@
+#include "uring.h"
+#include "arena.h"
+#include "microswim.h"
+#include "microswim_log.h"
+#include <errno.h>
+#include <string.h>
+
+#if !defined(RIOT_OS) && defined(MICROSWIM_IO_URING) && defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_GROUP 0
+
+// NOTE: A provided buffer holds the header of the multishot receive and the datagram, and keeps
+// one more byte for the terminating null byte.
+#define URING_BUFFER_SIZE (sizeof(struct io_uring_recvmsg_out) + BUFFER_SIZE)
+
+/**
+ * @brief One io_uring with its submission and completion rings mapped.
+ */
+typedef struct {
+    int fd;
+    void* rings; // NOTE: The submission and the completion rings share one mapping
+    size_t rings_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    size_t submissions; // NOTE: Entries queued but not submitted yet
+} microswim_ring_t;
+
+/**
+ * NOTE: The sends and the receive have a ring each, so that the completions of the sends can
+ * be waited for and consumed without holding back datagrams, and the receive ring's file
+ * descriptor is readable exactly while datagrams are waiting.
+ */
+struct microswim_uring {
+    int socket;
+    microswim_ring_t send;
+    microswim_ring_t receive;
+    struct io_uring_buf_ring* buffers; // NOTE: Followed by the memory of the buffers
+    size_t buffers_size;
+    unsigned char* memory;
+    uint16_t buffer_tail;
+    uint16_t handed[IO_URING_BUFFERS]; // NOTE: Buffers handed out, until they are recycled
+    size_t handed_count;
+    size_t sending; // NOTE: Sends queued but not completed yet
+    size_t system_calls;
+    bool receiving; // NOTE: Whether the multishot receive is armed
+    struct msghdr header;
+};
+
+static bool microswim_ring_setup(microswim_ring_t* ring, unsigned entries, unsigned completions) {
+    struct io_uring_params params = { 0 };
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = completions;
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0 || !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        return false;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->rings_size = (sq_size > cq_size) ? sq_size : cq_size;
+    ring->rings = mmap(
+        NULL, ring->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(
+        NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQES);
+    if (ring->rings == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        return false;
+    }
+
+    unsigned char* rings = ring->rings;
+    ring->sq_head = (unsigned*)(rings + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(rings + params.sq_off.tail);
+    ring->sq_array = (unsigned*)(rings + params.sq_off.array);
+    ring->sq_mask = *(unsigned*)(rings + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned*)(rings + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(rings + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(rings + params.cq_off.cqes);
+
+    return true;
+}
+
+static void microswim_ring_teardown(microswim_ring_t* ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+
+    if (ring->rings != NULL && ring->rings != MAP_FAILED) {
+        munmap(ring->rings, ring->rings_size);
+    }
+
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+}
+
+/**
+ * @brief Submits the queued entries and waits for `complete` completions.
+ *
+ * @return The number of entries submitted, or -1 on failure.
+ */
+static int microswim_uring_enter(microswim_uring_t* uring, microswim_ring_t* ring, unsigned complete) {
+    long result;
+    do {
+        uring->system_calls++;
+        result = syscall(
+            __NR_io_uring_enter, ring->fd, (unsigned)ring->submissions, complete,
+            IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        MICROSWIM_LOG_ERROR("(microswim_uring_enter) io_uring_enter failed: %d %s", errno, strerror(errno));
+        return -1;
+    }
+
+    ring->submissions -= ((size_t)result < ring->submissions) ? (size_t)result : ring->submissions;
+    return (int)result;
+}
+
+/**
+ * @brief Takes the next free submission entry, or NULL if the submission ring is full.
+ */
+static struct io_uring_sqe* microswim_ring_entry(microswim_ring_t* ring) {
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries) {
+        return NULL;
+    }
+
+    struct io_uring_sqe* sqe = &ring->sqes[tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+
+    return sqe;
+}
+
+static void microswim_ring_push(microswim_ring_t* ring) {
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+    ring->submissions++;
+}
+
+static void microswim_uring_arm(microswim_uring_t* uring) {
+    struct io_uring_sqe* sqe = microswim_ring_entry(&uring->receive);
+    if (sqe == NULL) {
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = uring->socket;
+    sqe->addr = (uint64_t)(uintptr_t)&uring->header;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_GROUP;
+    microswim_ring_push(&uring->receive);
+
+    uring->receiving = true;
+}
+
+static void microswim_uring_provide(microswim_uring_t* uring, uint16_t id) {
+    struct io_uring_buf* buffer = &uring->buffers->bufs[uring->buffer_tail & (IO_URING_BUFFERS - 1)];
+    buffer->addr = (uint64_t)(uintptr_t)(uring->memory + (size_t)id * URING_BUFFER_SIZE);
+    buffer->len = URING_BUFFER_SIZE - 1;
+    buffer->bid = id;
+    uring->buffer_tail++;
+}
+
+/**
+ * @brief Sets up the io_uring for the socket, with a multishot receive armed on it.
+ *
+ * @return The io_uring, or NULL if the kernel lacks io_uring, provided buffer rings or
+ * multishot receives, or denies them, in which case the socket is left to the socket calls.
+ */
+microswim_uring_t* microswim_uring_create(microswim_arena_t* arena, int socket) {
+    microswim_uring_t* uring =
+        microswim_arena_reallocate(arena, NULL, 0, sizeof(microswim_uring_t));
+    if (uring == NULL) {
+        MICROSWIM_LOG_WARN("Unable to allocate the io_uring");
+        return NULL;
+    }
+
+    memset(uring, 0, sizeof(*uring));
+    uring->socket = socket;
+    uring->send.fd = -1;
+    uring->receive.fd = -1;
+
+    if (!microswim_ring_setup(&uring->send, IO_BATCH, 2 * IO_BATCH) ||
+        !microswim_ring_setup(&uring->receive, 1, IO_URING_BUFFERS)) {
+        goto unavailable;
+    }
+
+    // NOTE: the kernel wants the ring of the provided buffers page aligned.
+    uring->buffers_size = IO_URING_BUFFERS * (sizeof(struct io_uring_buf) + URING_BUFFER_SIZE);
+    uring->buffers = mmap(
+        NULL, uring->buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buffers == MAP_FAILED) {
+        goto unavailable;
+    }
+
+    uring->memory = (unsigned char*)uring->buffers + IO_URING_BUFFERS * sizeof(struct io_uring_buf);
+
+    struct io_uring_buf_reg registration = { 0 };
+    registration.ring_addr = (uint64_t)(uintptr_t)uring->buffers;
+    registration.ring_entries = IO_URING_BUFFERS;
+    registration.bgid = URING_GROUP;
+    if (syscall(__NR_io_uring_register, uring->receive.fd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+        goto unavailable;
+    }
+
+    for (size_t i = 0; i < IO_URING_BUFFERS; i++) {
+        microswim_uring_provide(uring, (uint16_t)i);
+    }
+    __atomic_store_n(&uring->buffers->tail, uring->buffer_tail, __ATOMIC_RELEASE);
+
+    microswim_uring_arm(uring);
+    if (microswim_uring_enter(uring, &uring->receive, 0) < 0) {
+        goto unavailable;
+    }
+
+    // NOTE: a kernel without multishot receives fails the submission straight away.
+    unsigned head = *uring->receive.cq_head;
+    if (head != __atomic_load_n(uring->receive.cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe* cqe = &uring->receive.cqes[head & uring->receive.cq_mask];
+        if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+            errno = -cqe->res;
+            goto unavailable;
+        }
+    }
+
+    return uring;
+
+unavailable:
+    MICROSWIM_LOG_WARN("io_uring is unavailable, falling back to the socket calls: %d %s", errno, strerror(errno));
+    microswim_uring_destroy(arena, uring);
+    return NULL;
+}
+
+/**
+ * @brief Closes the io_uring, cancelling the receive and dropping the datagrams not handled yet.
+ */
+void microswim_uring_destroy(microswim_arena_t* arena, microswim_uring_t* uring) {
+    if (uring == NULL) {
+        return;
+    }
+
+    microswim_ring_teardown(&uring->receive);
+    microswim_ring_teardown(&uring->send);
+
+    if (uring->buffers != NULL && uring->buffers != MAP_FAILED) {
+        munmap(uring->buffers, uring->buffers_size);
+    }
+
+    microswim_arena_release(arena, uring);
+}
+
+/**
+ * @brief The file descriptor which is readable while received datagrams are waiting.
+ */
+int microswim_uring_descriptor(const microswim_uring_t* uring) {
+    return uring->receive.fd;
+}
+
+size_t microswim_uring_system_calls(const microswim_uring_t* uring) {
+    return uring->system_calls;
+}
+
+/**
+ * @brief Queues the message described by `header`, which is read by `microswim_uring_submit`.
+ *
+ * @return true if the message is queued, false if IO_BATCH messages are queued already.
+ */
+bool microswim_uring_send(microswim_uring_t* uring, struct msghdr* header) {
+    struct io_uring_sqe* sqe = microswim_ring_entry(&uring->send);
+    if (sqe == NULL) {
+        return false;
+    }
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = uring->socket;
+    sqe->addr = (uint64_t)(uintptr_t)header;
+    sqe->len = 1;
+    // NOTE: a datagram the socket has no room for is dropped, as `sendmmsg` would drop it.
+    sqe->msg_flags = MSG_DONTWAIT;
+    microswim_ring_push(&uring->send);
+
+    uring->sending++;
+    return true;
+}
+
+/**
+ * @brief Submits the queued messages and waits until they are sent, with one `io_uring_enter`
+ * as a rule, after which their buffers may be reused.
+ *
+ * @return The number of messages sent.
+ */
+size_t microswim_uring_submit(microswim_uring_t* uring) {
+    microswim_ring_t* ring = &uring->send;
+    size_t sent = 0;
+
+    while (uring->sending > 0) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail && microswim_uring_enter(uring, ring, (unsigned)uring->sending) < 0) {
+            // NOTE: the completions of whatever was submitted are consumed by the next submit.
+            uring->sending = 0;
+            break;
+        }
+
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+            if (cqe->res >= 0) {
+                sent++;
+            } else {
+                MICROSWIM_LOG_ERROR("(microswim_uring_submit) sendmsg failed: %d %s", -cqe->res, strerror(-cqe->res));
+            }
+            uring->sending -= (uring->sending > 0) ? 1 : 0;
+        }
+
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return sent;
+}
+
+/**
+ * @brief Hands out up to `count` received datagrams, which stay in the provided buffers until
+ * `microswim_uring_recycle` is called.
+ *
+ * @return The number of datagrams handed out, less than `count` once none is left.
+ */
+size_t microswim_uring_receive(
+    microswim_uring_t* uring, microswim_datagram_t* datagrams, size_t count) {
+    microswim_ring_t* ring = &uring->receive;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    size_t offset =
+        sizeof(struct io_uring_recvmsg_out) + uring->header.msg_namelen + uring->header.msg_controllen;
+    size_t handed = 0;
+
+    for (; head != tail && handed < count; head++) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            uring->receiving = false;
+        }
+
+        if (cqe->res < 0) {
+            // NOTE: the multishot receive ends when it runs out of buffers, it is armed again
+            // once they are recycled.
+            if (cqe->res != -ENOBUFS) {
+                MICROSWIM_LOG_ERROR("(microswim_uring_receive) recvmsg failed: %d %s", -cqe->res, strerror(-cqe->res));
+            }
+            continue;
+        }
+
+        if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+            continue;
+        }
+
+        uint16_t id = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        unsigned char* buffer = uring->memory + (size_t)id * URING_BUFFER_SIZE;
+        struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)buffer;
+        // NOTE: a truncated datagram keeps the bytes which fit, as `recvfrom` would keep them.
+        size_t length = ((size_t)cqe->res > offset) ? (size_t)cqe->res - offset : 0;
+        if (out->payloadlen < length) {
+            length = out->payloadlen;
+        }
+
+        buffer[offset + length] = '\0';
+        datagrams[handed].buffer = buffer + offset;
+        datagrams[handed].length = (ssize_t)length;
+        uring->handed[uring->handed_count++] = id;
+        handed++;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return handed;
+}
+
+/**
+ * @brief Gives the buffers handed out back to the kernel, and arms the receive again if it
+ * ended for want of buffers.
+ */
+void microswim_uring_recycle(microswim_uring_t* uring) {
+    for (size_t i = 0; i < uring->handed_count; i++) {
+        microswim_uring_provide(uring, uring->handed[i]);
+    }
+    uring->handed_count = 0;
+    __atomic_store_n(&uring->buffers->tail, uring->buffer_tail, __ATOMIC_RELEASE);
+
+    if (!uring->receiving) {
+        microswim_uring_arm(uring);
+        microswim_uring_enter(uring, &uring->receive, 0);
+    }
+}
+
+#elif !defined(RIOT_OS)
+// NOTE: Without io_uring support compiled in, the batched I/O stays on the socket calls.
+microswim_uring_t* microswim_uring_create(microswim_arena_t* arena, int socket) {
+    (void)arena;
+    (void)socket;
+    return NULL;
+}
+
+void microswim_uring_destroy(microswim_arena_t* arena, microswim_uring_t* uring) {
+    (void)arena;
+    (void)uring;
+}
+
+int microswim_uring_descriptor(const microswim_uring_t* uring) {
+    (void)uring;
+    return -1;
+}
+
+size_t microswim_uring_system_calls(const microswim_uring_t* uring) {
+    (void)uring;
+    return 0;
+}
+
+bool microswim_uring_send(microswim_uring_t* uring, struct msghdr* header) {
+    (void)uring;
+    (void)header;
+    return false;
+}
+
+size_t microswim_uring_submit(microswim_uring_t* uring) {
+    (void)uring;
+    return 0;
+}
+
+size_t microswim_uring_receive(
+    microswim_uring_t* uring, microswim_datagram_t* datagrams, size_t count) {
+    (void)uring;
+    (void)datagrams;
+    (void)count;
+    return 0;
+}
+
+void microswim_uring_recycle(microswim_uring_t* uring) {
+    (void)uring;
+}
+#endif